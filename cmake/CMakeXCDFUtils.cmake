@@ -12,7 +12,7 @@ FUNCTION (XCDF_ADD_LIBRARY)
 
   # Build and install library
   ADD_LIBRARY (${XCDF_ADD_LIBRARY_TARGET} SHARED ${${_lib}_SOURCES})
-  TARGET_LINK_LIBRARIES (${XCDF_ADD_LIBRARY_TARGET} z m)
+  TARGET_LINK_LIBRARIES (${XCDF_ADD_LIBRARY_TARGET} z m ${CMAKE_THREAD_LIBS_INIT})
   INSTALL (TARGETS ${XCDF_ADD_LIBRARY_TARGET} LIBRARY DESTINATION lib)
 
   # Install headers
@@ -54,7 +54,7 @@ FUNCTION (XCDF_ADD_EXECUTABLE)
   NO_DOTFILE_GLOB (${_exe}_SOURCES ${XCDF_ADD_EXECUTABLE_SOURCES})
 
   ADD_EXECUTABLE (${_exename} ${${_exe}_SOURCES})
-  TARGET_LINK_LIBRARIES (${_exename} xcdf z m)
+  TARGET_LINK_LIBRARIES (${_exename} xcdf z m ${CMAKE_THREAD_LIBS_INIT})
   IF (XCDF_ADD_EXECUTABLE_EXE_NAME)
     SET_TARGET_PROPERTIES(${_exename} PROPERTIES OUTPUT_NAME "${XCDF_ADD_EXECUTABLE_EXE_NAME}")
   ENDIF (XCDF_ADD_EXECUTABLE_EXE_NAME)
@@ -33,7 +33,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstring>
 #include <stdint.h>
 
-#define XCDF_VERSION 3
+#define XCDF_VERSION 5
+
+// Files without encoded fields are written with the previous version so
+// that older readers can still open them
+#define XCDF_FIELD_ENCODING_VERSION 4
+
+// Block data shuffled before deflate
+#define XCDF_SHUFFLE_VERSION 5
 
 #define XCDF_DATUM_WIDTH_BYTES 8
 #define XCDF_DATUM_WIDTH_BITS  64
@@ -45,7 +52,8 @@ enum XCDFFrameType {
   XCDF_BLOCK_HEADER   = 0x160E17E4,
   XCDF_BLOCK_DATA     = 0x37DF239D,
   XCDF_FILE_TRAILER   = 0xBD340AF6,
-  XCDF_DEFLATED_FRAME = 0x7E4A26B7
+  XCDF_DEFLATED_FRAME = 0x7E4A26B7,
+  XCDF_SHUFFLED_FRAME = 0x5B91E3C2
 };
 
 inline bool XCDFFrameTypeValid(uint32_t type) {
@@ -61,6 +69,42 @@ enum XCDFFieldType {
     XCDF_FLOATING_POINT      = 2
 };
 
+enum XCDFFieldEncoding {
+    XCDF_ENCODING_PLAIN      = 0,
+    XCDF_ENCODING_DELTA      = 1,
+    XCDF_ENCODING_MINI_BLOCK = 2,
+    XCDF_ENCODING_DICTIONARY = 3,
+    XCDF_ENCODING_RUN_LENGTH = 4,
+    XCDF_ENCODING_XOR        = 5
+};
+
+inline bool XCDFFieldEncodingValid(char encoding) {
+  return (encoding == XCDF_ENCODING_PLAIN ||
+          encoding == XCDF_ENCODING_DELTA ||
+          encoding == XCDF_ENCODING_MINI_BLOCK ||
+          encoding == XCDF_ENCODING_DICTIONARY ||
+          encoding == XCDF_ENCODING_RUN_LENGTH ||
+          encoding == XCDF_ENCODING_XOR);
+}
+
+// Flag on the block header size of a field marking a delta-encoded block,
+// and the width of the difference width that starts the block data
+#define XCDF_DELTA_BLOCK_FLAG 0x80
+#define XCDF_DELTA_WIDTH_BITS 7
+
+// Number of values sharing a frame of reference in mini-block encoding
+#define XCDF_MINI_BLOCK_SIZE 128
+#define XCDF_MINI_BLOCK_WIDTH_BITS 7
+
+// Width of the number of entries in a dictionary-encoded block
+#define XCDF_DICTIONARY_SIZE_BITS 16
+
+// Width of the run length width in a run-length encoded block
+#define XCDF_RUN_WIDTH_BITS 7
+
+// Width of the leading zero count and size of an XOR-encoded value
+#define XCDF_XOR_WIDTH_BITS 6
+
 const std::string NO_PARENT = "";
 
 class XCDFException {
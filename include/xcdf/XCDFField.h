@@ -71,6 +71,16 @@ class ConstXCDFField {
 
     T GetResolution() const {return FieldData()->GetResolution();}
 
+    /// Get the encoding used to store the field inside each block
+    XCDFFieldEncoding GetEncoding() const {return FieldData()->GetEncoding();}
+
+    /// Check if the global range of the field is known
+    bool GlobalsSet() const {return FieldData()->GlobalsSet();}
+
+    /// Get the global range of the field
+    T GetGlobalMin() const {return FieldData()->GetGlobalMin();}
+    T GetGlobalMax() const {return FieldData()->GetGlobalMax();}
+
     /// Get the number of entries in the field in the current event
     unsigned GetSize() const {return FieldData()->GetSize();}
 
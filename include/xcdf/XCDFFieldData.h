@@ -36,7 +36,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cmath>
 #include <stdint.h>
 #include <deque>
+#include <vector>
+#include <algorithm>
 #include <functional>
+#include <limits>
 
 /*!
  * @class XCDFFieldData
@@ -76,6 +79,16 @@ namespace {
       target = value;
     }
   }
+
+  /*
+   *  Check that a value is neither NaN nor infinite
+   */
+  template <typename T>
+  bool IsFinite(const T) {return true;}
+
+  inline bool IsFinite(const double value) {
+    return !std::isnan(value) && !std::isinf(value);
+  }
 }
 
 template <typename T>
@@ -95,9 +108,24 @@ class XCDFFieldData : public XCDFFieldDataBase {
                                    maxSet_(false),
                                    globalMinSet_(false),
                                    globalMaxSet_(false),
+                                   boundMin_(0),
+                                   boundMax_(0),
+                                   boundMinSet_(false),
+                                   boundMaxSet_(false),
                                    activeSize_(SIZE_UNSET),
                                    totalBytes_(0),
-                                   bitsProcessed_(0) { }
+                                   bitsProcessed_(0),
+                                   blockValues_(0),
+                                   previous_(0),
+                                   deltaBlock_(false),
+                                   deltaWidth_(0),
+                                   miniBlockWidth_(0),
+                                   dictionaryWidth_(0),
+                                   runWidth_(0),
+                                   runRemaining_(0),
+                                   hasExceptions_(false),
+                                   xorLeading_(0),
+                                   xorTrailing_(0) { }
 
     virtual ~XCDFFieldData() { }
 
@@ -108,9 +136,14 @@ class XCDFFieldData : public XCDFFieldDataBase {
      */
     virtual void ZeroAlign();
 
-    /// Set the active size of the field, as when reading back a file.
-    virtual void SetActiveSize(const uint32_t activeSize) {
-      activeSize_ = activeSize;
+    /// Set the active size of the field from the block header size, as
+    /// when reading back a file.  Sizes with a flag the field doesn't use
+    /// are kept as they are, so they are seen to be invalid.
+    virtual void SetActiveSize(const uint32_t headerSize) {
+      deltaBlock_ = IsDeltaHeaderSize(headerSize);
+      activeSize_ = deltaBlock_ ? headerSize & ~XCDF_DELTA_BLOCK_FLAG :
+                                  headerSize;
+      blockValues_ = 0;
     }
 
     void Add(const T value) {
@@ -119,8 +152,13 @@ class XCDFFieldData : public XCDFFieldDataBase {
       activeSize_ = SIZE_UNSET;
 
       // Check the current value against min/max
-      CheckActiveMin(value);
-      CheckActiveMax(value);
+      if (IsRangeValue(value)) {
+        CheckActiveMin(value);
+        CheckActiveMax(value);
+      } else {
+        CheckGlobalMin(value);
+        CheckGlobalMax(value);
+      }
       AddDirect(value);
     }
 
@@ -137,6 +175,7 @@ class XCDFFieldData : public XCDFFieldDataBase {
       minSet_ = false;
       maxSet_ = false;
       activeSize_ = SIZE_UNSET;
+      blockValues_ = 0;
     }
 
     virtual void CalculateGlobals() {
@@ -152,6 +191,7 @@ class XCDFFieldData : public XCDFFieldDataBase {
     virtual bool GlobalsSet() const {return globalMinSet_ && globalMaxSet_;}
 
     virtual void ClearBitsProcessed() {bitsProcessed_ = 0;}
+    virtual void AddBitsProcessed(uint64_t bits) {bitsProcessed_ += bits;}
     virtual uint64_t GetBitsProcessed() const {return bitsProcessed_;}
 
     virtual uint64_t GetStashSize() const {return stash_.size();}
@@ -166,10 +206,36 @@ class XCDFFieldData : public XCDFFieldDataBase {
 
         // Make activeSize_ mutable so this method is const
         activeSize_ = CalcActiveSize();
+        blockValues_ = 0;
+        deltaBlock_ = false;
+        if (encoding_ == XCDF_ENCODING_DELTA) {
+          PlanDelta();
+        }
+        if (IsEncodedBlock() && encoding_ == XCDF_ENCODING_MINI_BLOCK) {
+          PlanMiniBlocks();
+        }
+        if (IsEncodedBlock() && encoding_ == XCDF_ENCODING_DICTIONARY) {
+          PlanDictionary();
+        }
+        if (IsEncodedBlock() && encoding_ == XCDF_ENCODING_RUN_LENGTH) {
+          PlanRuns();
+        }
+        if (encoding_ == XCDF_ENCODING_XOR) {
+          PlanExceptions();
+        }
       }
       return activeSize_;
     }
 
+    /*
+     * Get the size written to the block header: the active size, flagged
+     * if the block is delta-encoded
+     */
+    virtual uint32_t GetHeaderSize() const {
+      uint32_t size = GetActiveSize();
+      return deltaBlock_ ? size | XCDF_DELTA_BLOCK_FLAG : size;
+    }
+
     /*
      * Get the resolution of the field cast as a uint64_t
      */
@@ -193,6 +259,27 @@ class XCDFFieldData : public XCDFFieldDataBase {
       minSet_ = true;
     }
 
+    /*
+     *  Set the active min and size of a block whose values are written
+     *  already encoded with DumpRawValue(), as when copying blocks
+     *  between files.  The min is counted only once a value is written.
+     */
+    virtual void SetRawBlockHeader(uint64_t rawActiveMin,
+                                   uint32_t activeSize) {
+      activeMin_ = XCDFSafeTypePun<uint64_t, T>(rawActiveMin);
+      activeSize_ = activeSize;
+    }
+
+    /*
+     *  Dump a value encoded in the units of the active block header
+     */
+    virtual void DumpRawValue(XCDFBlockData& data, uint64_t datum) {
+      minSet_ = true;
+      CheckActiveMax(CalculateTypeValue(datum));
+      data.AddDatum(datum, activeSize_);
+      bitsProcessed_ += activeSize_;
+    }
+
     /*
      *  Get the global range of the field
      */
@@ -200,6 +287,34 @@ class XCDFFieldData : public XCDFFieldDataBase {
       return std::pair<T, T>(globalMin_, globalMax_);
     }
 
+    /*
+     *  Widen the field bounds to cover a block, given only its header.
+     *  The block min is exact, and the max is the largest value the
+     *  active size can represent.  XOR-encoded floating point blocks may
+     *  hold NaN and infinite values outside the header range, so they
+     *  are unbounded on both sides.
+     */
+    virtual void CheckBlockBounds(uint64_t rawActiveMin,
+                                  uint32_t headerSize) {
+      T min = XCDFSafeTypePun<uint64_t, T>(rawActiveMin);
+      uint32_t activeSize = IsDeltaHeaderSize(headerSize) ?
+                            headerSize & ~XCDF_DELTA_BLOCK_FLAG : headerSize;
+      std::pair<T, T> bounds = CalcBlockBounds(min, activeSize);
+      if (encoding_ == XCDF_ENCODING_XOR &&
+                               std::numeric_limits<T>::has_infinity) {
+        bounds = CalcBlockBounds(min, XCDF_DATUM_WIDTH_BITS);
+      }
+      DoCheck(bounds.first, boundMin_, boundMinSet_, std::less<T>());
+      DoCheck(bounds.second, boundMax_, boundMaxSet_, std::greater<T>());
+    }
+
+    /*
+     *  Get the bounds of the field from the block headers
+     */
+    std::pair<T, T> GetGlobalBounds() const {
+      return std::pair<T, T>(boundMin_, boundMax_);
+    }
+
     /*
      * Get the minimum value seen by the field
      */
@@ -283,6 +398,12 @@ class XCDFFieldData : public XCDFFieldDataBase {
     bool globalMinSet_;
     bool globalMaxSet_;
 
+    /// Bounds on the field values from the block headers
+    T boundMin_;
+    T boundMax_;
+    bool boundMinSet_;
+    bool boundMaxSet_;
+
     /// Number of bits needed for this field in the current block
     mutable uint32_t activeSize_;
 
@@ -297,6 +418,44 @@ class XCDFFieldData : public XCDFFieldDataBase {
     /// Bits we've processed; used to determine total bytes
     uint64_t bitsProcessed_;
 
+    /// Number of values encoded in the current block
+    mutable uint64_t blockValues_;
+
+    /// Previous value in the current block of a delta-encoded field
+    uint64_t previous_;
+
+    /// Whether the current block of a delta-encoded field stores
+    /// differences, and their width
+    mutable bool deltaBlock_;
+    mutable unsigned deltaWidth_;
+
+    /// Offset from the active min and width of each mini-block, chosen
+    /// when writing, and of the current mini-block
+    mutable std::vector<std::pair<uint64_t, unsigned> > miniBlocks_;
+    uint64_t miniBlockMin_;
+    unsigned miniBlockWidth_;
+
+    /// Sorted distinct offsets from the active min in the current block
+    /// of a dictionary-encoded field, and the width of their codes.  An
+    /// empty dictionary means the block is written plain.
+    mutable std::vector<uint64_t> dictionary_;
+    mutable unsigned dictionaryWidth_;
+
+    /// Lengths of the runs in the current block of a run-length encoded
+    /// field, chosen when writing, the width of the lengths, and the
+    /// number of values left in the current run.  A zero width means the
+    /// block is written plain.
+    mutable std::vector<uint64_t> runs_;
+    mutable unsigned runWidth_;
+    uint64_t runRemaining_;
+
+    /// Whether the current block of an XOR-encoded field holds NaN or
+    /// infinite values, and the leading and trailing zero counts of the
+    /// last XOR written in full
+    mutable bool hasExceptions_;
+    unsigned xorLeading_;
+    unsigned xorTrailing_;
+
     void CheckActiveMin(const T value) {
       DoCheck(value, activeMin_, minSet_, std::less<T>());
     }
@@ -317,10 +476,33 @@ class XCDFFieldData : public XCDFFieldDataBase {
      *  Load a value from the XCDFBlockData
      */
     T LoadValue(XCDFBlockData& data) {
-      T value = CalculateTypeValue(data.GetDatum(activeSize_));
+      if (encoding_ == XCDF_ENCODING_XOR) {
+        T value = LoadXor(data);
+        if (IsRangeValue(value)) {
+          CheckActiveMax(value);
+        } else {
+          CheckGlobalMin(value);
+          CheckGlobalMax(value);
+        }
+        return value;
+      }
+
+      uint64_t datum;
+      if (!IsEncodedBlock()) {
+        datum = data.GetDatum(activeSize_);
+        bitsProcessed_ += activeSize_;
+      } else if (encoding_ == XCDF_ENCODING_DELTA) {
+        datum = LoadDelta(data);
+      } else if (encoding_ == XCDF_ENCODING_MINI_BLOCK) {
+        datum = LoadMiniBlock(data);
+      } else if (encoding_ == XCDF_ENCODING_DICTIONARY) {
+        datum = LoadDictionary(data);
+      } else {
+        datum = LoadRun(data);
+      }
+      T value = CalculateTypeValue(datum);
       // We only have the active min.  We need to rediscover the max.
       CheckActiveMax(value);
-      bitsProcessed_ += activeSize_;
       return value;
     }
 
@@ -328,10 +510,587 @@ class XCDFFieldData : public XCDFFieldDataBase {
      *  Dump a value to the XCDFBlockData
      */
     void DumpValue(XCDFBlockData& data, T datum) {
-      data.AddDatum(CalculateIntegerValue(datum), GetActiveSize());
+      GetActiveSize();
+      if (encoding_ == XCDF_ENCODING_XOR) {
+        DumpXor(data, datum);
+      } else if (!IsEncodedBlock()) {
+        data.AddDatum(CalculateIntegerValue(datum), activeSize_);
+        bitsProcessed_ += activeSize_;
+      } else if (encoding_ == XCDF_ENCODING_DELTA) {
+        DumpDelta(data, CalculateIntegerValue(datum));
+      } else if (encoding_ == XCDF_ENCODING_MINI_BLOCK) {
+        DumpMiniBlock(data, CalculateIntegerValue(datum));
+      } else if (encoding_ == XCDF_ENCODING_DICTIONARY) {
+        DumpDictionary(data, CalculateIntegerValue(datum));
+      } else {
+        DumpRun(data, CalculateIntegerValue(datum));
+      }
+    }
+
+    /*
+     *  Blocks of constant values or that need all 64 bits are written
+     *  plain whatever the field encoding, so the block header size tells
+     *  the reader which was used.  Delta-encoded fields also write plain
+     *  the blocks where differences take no fewer bits, and flag the
+     *  header size of the others.
+     */
+    bool IsEncodedBlock() const {
+      return encoding_ != XCDF_ENCODING_PLAIN && activeSize_ > 0 &&
+             activeSize_ < XCDF_DATUM_WIDTH_BITS &&
+             (encoding_ != XCDF_ENCODING_DELTA || deltaBlock_);
+    }
+
+    // The delta flag is only valid on sizes that can be encoded
+    bool IsDeltaHeaderSize(uint32_t headerSize) const {
+      uint32_t size = headerSize & ~XCDF_DELTA_BLOCK_FLAG;
+      return encoding_ == XCDF_ENCODING_DELTA &&
+             (headerSize & XCDF_DELTA_BLOCK_FLAG) &&
+             size > 0 && size < XCDF_DATUM_WIDTH_BITS;
+    }
+
+    /*
+     *  Each value of the current block takes exactly activeSize_ bits
+     */
+    virtual bool IsFixedWidthBlock() const {
+      return encoding_ != XCDF_ENCODING_XOR && !IsEncodedBlock();
+    }
+
+    /*
+     *  Delta encoding stores the width of the differences and the first
+     *  value of the block, then the zigzag-encoded difference of each
+     *  value from the one before, in resolution units.
+     */
+
+    static uint64_t ZigZag(uint64_t delta) {
+      return (delta << 1) ^ static_cast<uint64_t>(
+                                  static_cast<int64_t>(delta) >> 63);
+    }
+
+    static uint64_t UnZigZag(uint64_t datum) {
+      return (datum >> 1) ^ (~(datum & 1) + 1);
+    }
+
+    void DumpDelta(XCDFBlockData& data, uint64_t datum) {
+      if (blockValues_++ > 0) {
+        data.AddDatum(ZigZag(datum - previous_), deltaWidth_);
+        bitsProcessed_ += deltaWidth_;
+      } else {
+        data.AddDatum(deltaWidth_, XCDF_DELTA_WIDTH_BITS);
+        data.AddDatum(datum, activeSize_);
+        bitsProcessed_ += XCDF_DELTA_WIDTH_BITS + activeSize_;
+      }
+      previous_ = datum;
+    }
+
+    uint64_t LoadDelta(XCDFBlockData& data) {
+      if (blockValues_++ > 0) {
+        previous_ += UnZigZag(data.GetDatum(deltaWidth_));
+        bitsProcessed_ += deltaWidth_;
+      } else {
+        deltaWidth_ = data.GetDatum(XCDF_DELTA_WIDTH_BITS);
+        if (deltaWidth_ > XCDF_DATUM_WIDTH_BITS) {
+          XCDFFatal("Corrupt file: Field " << GetName() <<
+                    " has invalid delta width " << deltaWidth_);
+        }
+        previous_ = data.GetDatum(activeSize_);
+        bitsProcessed_ += XCDF_DELTA_WIDTH_BITS + activeSize_;
+      }
+      return previous_;
+    }
+
+    /*
+     *  Find the width of the differences in the write cache, and store
+     *  the block as differences only if that takes fewer bits than plain
+     *  packing
+     */
+    void PlanDelta() const {
+
+      if (activeSize_ == 0 || activeSize_ >= XCDF_DATUM_WIDTH_BITS) {
+        return;
+      }
+
+      uint64_t bits = 0;
+      uint64_t previous = 0;
+      for (typename std::deque<T>::const_iterator it = stash_.begin();
+                                                  it != stash_.end(); ++it) {
+        uint64_t datum = CalculateIntegerValue(*it);
+        if (it != stash_.begin()) {
+          bits |= ZigZag(datum - previous);
+        }
+        previous = datum;
+      }
+
+      uint64_t n = stash_.size();
+      deltaWidth_ = BitCount(bits);
+      deltaBlock_ = XCDF_DELTA_WIDTH_BITS + activeSize_ +
+                    (n - 1) * deltaWidth_ < n * activeSize_;
+    }
+
+    /*
+     *  Mini-block encoding splits the values of the block into groups of
+     *  XCDF_MINI_BLOCK_SIZE, each with its own frame of reference: the
+     *  group min as an offset from the active min, and a bit width, so
+     *  an outlier only widens its own group.  The width is chosen so that
+     *  the few values that don't fit are cheaper written as exceptions:
+     *  an escape code of all ones followed by the offset in full.
+     */
+    void DumpMiniBlock(XCDFBlockData& data, uint64_t datum) {
+      if (blockValues_ % XCDF_MINI_BLOCK_SIZE == 0) {
+        const std::pair<uint64_t, unsigned>& miniBlock =
+                              miniBlocks_[blockValues_ / XCDF_MINI_BLOCK_SIZE];
+        miniBlockMin_ = miniBlock.first;
+        miniBlockWidth_ = miniBlock.second;
+        data.AddDatum(miniBlockMin_, activeSize_);
+        data.AddDatum(miniBlockWidth_, XCDF_MINI_BLOCK_WIDTH_BITS);
+        bitsProcessed_ += activeSize_ + XCDF_MINI_BLOCK_WIDTH_BITS;
+      }
+      ++blockValues_;
+
+      uint64_t offset = datum - miniBlockMin_;
+      if (HasEscape()) {
+        uint64_t escape = GetEscape();
+        if (offset >= escape) {
+          data.AddDatum(escape, miniBlockWidth_);
+          data.AddDatum(offset, activeSize_);
+          bitsProcessed_ += miniBlockWidth_ + activeSize_;
+          return;
+        }
+      }
+      data.AddDatum(offset, miniBlockWidth_);
+      bitsProcessed_ += miniBlockWidth_;
+    }
+
+    uint64_t LoadMiniBlock(XCDFBlockData& data) {
+      if (blockValues_ % XCDF_MINI_BLOCK_SIZE == 0) {
+        miniBlockMin_ = data.GetDatum(activeSize_);
+        miniBlockWidth_ = data.GetDatum(XCDF_MINI_BLOCK_WIDTH_BITS);
+        bitsProcessed_ += activeSize_ + XCDF_MINI_BLOCK_WIDTH_BITS;
+        if (miniBlockWidth_ > activeSize_) {
+          XCDFFatal("Corrupt file: Field " << GetName() <<
+                    " has mini-block width " << miniBlockWidth_ <<
+                    " larger than block width " << activeSize_);
+        }
+      }
+      ++blockValues_;
+
+      uint64_t offset = data.GetDatum(miniBlockWidth_);
+      bitsProcessed_ += miniBlockWidth_;
+      if (HasEscape() && offset == GetEscape()) {
+        offset = data.GetDatum(activeSize_);
+        bitsProcessed_ += activeSize_;
+      }
+      return miniBlockMin_ + offset;
+    }
+
+    // A zero width holds only the group min, and a full width needs no
+    // exceptions
+    bool HasEscape() const {
+      return miniBlockWidth_ > 0 && miniBlockWidth_ < activeSize_;
+    }
+
+    uint64_t GetEscape() const {
+      return (static_cast<uint64_t>(1) << miniBlockWidth_) - 1;
+    }
+
+    /*
+     *  Choose the frame of reference of each mini-block from the values
+     *  in the write cache, minimizing the bits written for the group.
+     */
+    void PlanMiniBlocks() const {
+
+      miniBlocks_.clear();
+      typename std::deque<T>::const_iterator it = stash_.begin();
+      while (it != stash_.end()) {
+
+        std::vector<uint64_t> offsets;
+        offsets.reserve(XCDF_MINI_BLOCK_SIZE);
+        uint64_t min = CalculateIntegerValue(*it);
+        for (; it != stash_.end() &&
+               offsets.size() < XCDF_MINI_BLOCK_SIZE; ++it) {
+          offsets.push_back(CalculateIntegerValue(*it));
+          if (offsets.back() < min) {
+            min = offsets.back();
+          }
+        }
+
+        // Count the values needing each number of bits, including room
+        // for the escape code
+        uint64_t counts[XCDF_DATUM_WIDTH_BITS + 2] = {0};
+        for (unsigned i = 0; i < offsets.size(); ++i) {
+          uint64_t offset = offsets[i] - min;
+          counts[offset == std::numeric_limits<uint64_t>::max() ?
+                     XCDF_DATUM_WIDTH_BITS + 1 : BitCount(offset + 1)]++;
+        }
+
+        // Values needing more than w bits are escaped at width w
+        uint64_t n = offsets.size();
+        unsigned width = activeSize_;
+        uint64_t bits = n * activeSize_;
+        uint64_t exceptions = 0;
+        for (unsigned b = activeSize_; b <= XCDF_DATUM_WIDTH_BITS + 1; ++b) {
+          exceptions += counts[b];
+        }
+        for (unsigned w = activeSize_ - 1; w > 0; --w) {
+          uint64_t cost = n * w + exceptions * activeSize_;
+          if (cost < bits) {
+            width = w;
+            bits = cost;
+          }
+          exceptions += counts[w];
+        }
+        if (counts[1] == n) {
+          width = 0;
+        }
+        miniBlocks_.push_back(std::make_pair(min, width));
+      }
+    }
+
+    /*
+     *  Dictionary encoding stores the distinct values of the block once,
+     *  before the first value, then the index of each value in that list.
+     *  It is used for the blocks where it takes fewer bits than plain
+     *  packing; the others start with an empty dictionary.
+     */
+    void DumpDictionary(XCDFBlockData& data, uint64_t datum) {
+      if (blockValues_++ == 0) {
+        data.AddDatum(dictionary_.size(), XCDF_DICTIONARY_SIZE_BITS);
+        bitsProcessed_ += XCDF_DICTIONARY_SIZE_BITS;
+        for (unsigned i = 0; i < dictionary_.size(); ++i) {
+          data.AddDatum(dictionary_[i], activeSize_);
+        }
+        bitsProcessed_ += dictionary_.size() * activeSize_;
+      }
+
+      if (dictionary_.empty()) {
+        data.AddDatum(datum, activeSize_);
+        bitsProcessed_ += activeSize_;
+        return;
+      }
+      uint64_t code = std::lower_bound(dictionary_.begin(),
+                                       dictionary_.end(), datum) -
+                                                      dictionary_.begin();
+      data.AddDatum(code, dictionaryWidth_);
+      bitsProcessed_ += dictionaryWidth_;
+    }
+
+    uint64_t LoadDictionary(XCDFBlockData& data) {
+      if (blockValues_++ == 0) {
+        dictionary_.resize(data.GetDatum(XCDF_DICTIONARY_SIZE_BITS));
+        bitsProcessed_ += XCDF_DICTIONARY_SIZE_BITS;
+        for (unsigned i = 0; i < dictionary_.size(); ++i) {
+          dictionary_[i] = data.GetDatum(activeSize_);
+        }
+        bitsProcessed_ += dictionary_.size() * activeSize_;
+        dictionaryWidth_ = dictionary_.empty() ? 0 :
+                              BitCount(dictionary_.size() - 1);
+      }
+
+      if (dictionary_.empty()) {
+        bitsProcessed_ += activeSize_;
+        return data.GetDatum(activeSize_);
+      }
+      uint64_t code = data.GetDatum(dictionaryWidth_);
+      bitsProcessed_ += dictionaryWidth_;
+      if (code >= dictionary_.size()) {
+        XCDFFatal("Corrupt file: Field " << GetName() << " has code " <<
+                  code << " outside dictionary of " << dictionary_.size());
+      }
+      return dictionary_[code];
+    }
+
+    /*
+     *  Collect the distinct values in the write cache, and keep them as
+     *  the dictionary only if that takes fewer bits than plain packing
+     */
+    void PlanDictionary() const {
+
+      dictionary_.clear();
+      dictionary_.reserve(stash_.size());
+      for (typename std::deque<T>::const_iterator it = stash_.begin();
+                                                  it != stash_.end(); ++it) {
+        dictionary_.push_back(CalculateIntegerValue(*it));
+      }
+      std::sort(dictionary_.begin(), dictionary_.end());
+      dictionary_.erase(std::unique(dictionary_.begin(), dictionary_.end()),
+                        dictionary_.end());
+
+      uint64_t n = stash_.size();
+      dictionaryWidth_ = BitCount(dictionary_.size() - 1);
+      if (dictionary_.size() >> XCDF_DICTIONARY_SIZE_BITS ||
+          dictionary_.size() * activeSize_ + n * dictionaryWidth_ >=
+                                                         n * activeSize_) {
+        dictionary_.clear();
+      }
+    }
+
+    /*
+     *  Run-length encoding stores each run of equal values as its length
+     *  and the value, so mostly-zero or mostly-constant fields take a few
+     *  bits per change rather than per value.  Values inside a run are
+     *  not read at all.  Blocks where runs are not shorter than plain
+     *  packing are written plain.
+     */
+    void DumpRun(XCDFBlockData& data, uint64_t datum) {
+      if (blockValues_++ == 0) {
+        data.AddDatum(runWidth_, XCDF_RUN_WIDTH_BITS);
+        bitsProcessed_ += XCDF_RUN_WIDTH_BITS;
+        runRemaining_ = 0;
+      }
+
+      if (runWidth_ == 0) {
+        data.AddDatum(datum, activeSize_);
+        bitsProcessed_ += activeSize_;
+        return;
+      }
+      if (runRemaining_ == 0) {
+        uint64_t length = runs_[runs_.size() - 1];
+        runs_.pop_back();
+        data.AddDatum(length - 1, runWidth_);
+        data.AddDatum(datum, activeSize_);
+        bitsProcessed_ += runWidth_ + activeSize_;
+        runRemaining_ = length;
+      }
+      --runRemaining_;
+    }
+
+    uint64_t LoadRun(XCDFBlockData& data) {
+      if (blockValues_++ == 0) {
+        runWidth_ = data.GetDatum(XCDF_RUN_WIDTH_BITS);
+        bitsProcessed_ += XCDF_RUN_WIDTH_BITS;
+        runRemaining_ = 0;
+        if (runWidth_ > XCDF_DATUM_WIDTH_BITS) {
+          XCDFFatal("Corrupt file: Field " << GetName() <<
+                    " has invalid run length width " << runWidth_);
+        }
+      }
+
+      if (runWidth_ == 0) {
+        bitsProcessed_ += activeSize_;
+        return data.GetDatum(activeSize_);
+      }
+      if (runRemaining_ == 0) {
+        runRemaining_ = data.GetDatum(runWidth_) + 1;
+        previous_ = data.GetDatum(activeSize_);
+        bitsProcessed_ += runWidth_ + activeSize_;
+      }
+      --runRemaining_;
+      return previous_;
+    }
+
+    /*
+     *  Find the runs of equal values in the write cache and the length
+     *  width that takes the fewest bits, splitting longer runs
+     */
+    void PlanRuns() const {
+
+      std::vector<uint64_t> lengths;
+      uint64_t previous = 0;
+      uint64_t maxLength = 1;
+      for (typename std::deque<T>::const_iterator it = stash_.begin();
+                                                  it != stash_.end(); ++it) {
+        uint64_t datum = CalculateIntegerValue(*it);
+        if (it != stash_.begin() && datum == previous) {
+          maxLength = std::max(maxLength, ++lengths.back());
+        } else {
+          lengths.push_back(1);
+        }
+        previous = datum;
+      }
+
+      runWidth_ = 0;
+      uint64_t bits = stash_.size() * activeSize_;
+      unsigned maxWidth = std::max(1u, BitCount(maxLength - 1));
+      for (unsigned w = 1; w <= maxWidth; ++w) {
+        uint64_t cost = 0;
+        for (unsigned i = 0; i < lengths.size(); ++i) {
+          cost += (((lengths[i] - 1) >> w) + 1) * (w + activeSize_);
+        }
+        if (cost < bits) {
+          runWidth_ = w;
+          bits = cost;
+        }
+      }
+
+      // Store the runs in reverse so they can be popped in order
+      runs_.clear();
+      if (runWidth_ > 0) {
+        uint64_t maxRun = static_cast<uint64_t>(1) << runWidth_;
+        for (unsigned i = lengths.size(); i-- > 0;) {
+          uint64_t length = lengths[i];
+          if (length % maxRun) {
+            runs_.push_back(length % maxRun);
+          }
+          for (uint64_t j = 0; j < length / maxRun; ++j) {
+            runs_.push_back(maxRun);
+          }
+        }
+      }
+    }
+
+    /*
+     *  XOR encoding keeps NaN and infinite values out of the block range,
+     *  so they don't force the block to 64 bits.  They still go into the
+     *  global range directly, as they would in a plain field.  Blocks that
+     *  hold them flag each value, and write the NaN or infinity in full.
+     *  Blocks that need 64 bits anyway, such as full-precision fields,
+     *  store the XOR of each value with the previous one, coding only the
+     *  bits between its leading and trailing zeros.
+     */
+    bool IsRangeValue(const T value) const {
+      return encoding_ != XCDF_ENCODING_XOR || IsFinite(value);
+    }
+
+    void DumpXor(XCDFBlockData& data, T datum) {
+      if (activeSize_ == XCDF_DATUM_WIDTH_BITS) {
+        DumpXorBits(data, CalculateIntegerValue(datum));
+        return;
+      }
+
+      if (blockValues_++ == 0) {
+        data.AddDatum(hasExceptions_, 1);
+        bitsProcessed_ += 1;
+      }
+      if (hasExceptions_) {
+        bool exception = !IsFinite(datum);
+        data.AddDatum(exception, 1);
+        bitsProcessed_ += 1;
+        if (exception) {
+          data.AddDatum(XCDFSafeTypePun<T, uint64_t>(datum),
+                        XCDF_DATUM_WIDTH_BITS);
+          bitsProcessed_ += XCDF_DATUM_WIDTH_BITS;
+          return;
+        }
+      }
+      data.AddDatum(CalculateIntegerValue(datum), activeSize_);
       bitsProcessed_ += activeSize_;
     }
 
+    T LoadXor(XCDFBlockData& data) {
+      if (activeSize_ == XCDF_DATUM_WIDTH_BITS) {
+        return CalculateTypeValue(LoadXorBits(data));
+      }
+
+      if (blockValues_++ == 0) {
+        hasExceptions_ = data.GetDatum(1);
+        bitsProcessed_ += 1;
+      }
+      if (hasExceptions_) {
+        bitsProcessed_ += 1;
+        if (data.GetDatum(1)) {
+          bitsProcessed_ += XCDF_DATUM_WIDTH_BITS;
+          return XCDFSafeTypePun<uint64_t, T>(
+                                     data.GetDatum(XCDF_DATUM_WIDTH_BITS));
+        }
+      }
+      bitsProcessed_ += activeSize_;
+      return CalculateTypeValue(data.GetDatum(activeSize_));
+    }
+
+    /*
+     *  Each XOR is written as a 0 bit if it is zero, as 10 and its
+     *  meaningful bits if they fit within the zeros of the last XOR
+     *  written in full, or as 11, the leading zero count, the number of
+     *  meaningful bits less one, and the bits.
+     */
+    void DumpXorBits(XCDFBlockData& data, uint64_t datum) {
+      if (blockValues_++ == 0) {
+        data.AddDatum(datum, XCDF_DATUM_WIDTH_BITS);
+        bitsProcessed_ += XCDF_DATUM_WIDTH_BITS;
+        previous_ = datum;
+        xorLeading_ = XCDF_DATUM_WIDTH_BITS;
+        xorTrailing_ = 0;
+        return;
+      }
+
+      uint64_t bits = datum ^ previous_;
+      previous_ = datum;
+      if (bits == 0) {
+        data.AddDatum(0, 1);
+        bitsProcessed_ += 1;
+        return;
+      }
+
+      data.AddDatum(1, 1);
+      unsigned leading = XCDF_DATUM_WIDTH_BITS - BitCount(bits);
+      unsigned trailing = 0;
+      while (!((bits >> trailing) & 1)) {
+        ++trailing;
+      }
+      if (leading >= xorLeading_ && trailing >= xorTrailing_) {
+        unsigned size = XCDF_DATUM_WIDTH_BITS - xorLeading_ - xorTrailing_;
+        data.AddDatum(0, 1);
+        data.AddDatum(bits >> xorTrailing_, size);
+        bitsProcessed_ += 2 + size;
+      } else {
+        unsigned size = XCDF_DATUM_WIDTH_BITS - leading - trailing;
+        data.AddDatum(1, 1);
+        data.AddDatum(leading, XCDF_XOR_WIDTH_BITS);
+        data.AddDatum(size - 1, XCDF_XOR_WIDTH_BITS);
+        data.AddDatum(bits >> trailing, size);
+        bitsProcessed_ += 2 + 2 * XCDF_XOR_WIDTH_BITS + size;
+        xorLeading_ = leading;
+        xorTrailing_ = trailing;
+      }
+    }
+
+    uint64_t LoadXorBits(XCDFBlockData& data) {
+      if (blockValues_++ == 0) {
+        previous_ = data.GetDatum(XCDF_DATUM_WIDTH_BITS);
+        bitsProcessed_ += XCDF_DATUM_WIDTH_BITS;
+        xorLeading_ = XCDF_DATUM_WIDTH_BITS;
+        xorTrailing_ = 0;
+        return previous_;
+      }
+
+      bitsProcessed_ += 1;
+      if (!data.GetDatum(1)) {
+        return previous_;
+      }
+
+      bitsProcessed_ += 1;
+      if (data.GetDatum(1)) {
+        xorLeading_ = data.GetDatum(XCDF_XOR_WIDTH_BITS);
+        unsigned size = data.GetDatum(XCDF_XOR_WIDTH_BITS) + 1;
+        bitsProcessed_ += 2 * XCDF_XOR_WIDTH_BITS;
+        if (xorLeading_ + size > XCDF_DATUM_WIDTH_BITS) {
+          XCDFFatal("Corrupt file: Field " << GetName() <<
+                    " has invalid XOR width " << size);
+        }
+        xorTrailing_ = XCDF_DATUM_WIDTH_BITS - xorLeading_ - size;
+      } else if (xorLeading_ == XCDF_DATUM_WIDTH_BITS) {
+        XCDFFatal("Corrupt file: Field " << GetName() <<
+                  " reuses XOR width before setting it");
+      }
+
+      unsigned size = XCDF_DATUM_WIDTH_BITS - xorLeading_ - xorTrailing_;
+      previous_ ^= data.GetDatum(size) << xorTrailing_;
+      bitsProcessed_ += size;
+      return previous_;
+    }
+
+    /*
+     *  Check the write cache for NaN and infinite values
+     */
+    void PlanExceptions() const {
+      hasExceptions_ = false;
+      for (typename std::deque<T>::const_iterator it = stash_.begin();
+                                                  it != stash_.end(); ++it) {
+        if (!IsFinite(*it)) {
+          hasExceptions_ = true;
+          return;
+        }
+      }
+    }
+
+    static unsigned BitCount(uint64_t bits) {
+      unsigned bitCount = 0;
+      while (bits != 0) {
+        bitCount++;
+        bits = bits >> 1;
+      }
+      return bitCount;
+    }
+
     /*
      *  Add a datum without resetting min/max
      */
@@ -354,6 +1113,26 @@ class XCDFFieldData : public XCDFFieldDataBase {
       return static_cast<uint64_t>((datum - activeMin_) / resolution_);
     }
 
+    /*
+     *  Get the smallest and largest values a block with the given active
+     *  min and size can hold, saturating at the limits of the type.
+     */
+    std::pair<T, T> CalcBlockBounds(T min, uint32_t size) const {
+
+      uint64_t units = ~static_cast<uint64_t>(0);
+      if (size < XCDF_DATUM_WIDTH_BITS) {
+        units = (static_cast<uint64_t>(1) << size) - 1;
+      }
+      T max = std::numeric_limits<T>::max();
+      uint64_t room = static_cast<uint64_t>(max) - static_cast<uint64_t>(min);
+      uint64_t res = static_cast<uint64_t>(resolution_);
+      if (res == 0 || units > room / res) {
+        return std::pair<T, T>(min, max);
+      }
+      return std::pair<T, T>(min, static_cast<T>(
+                           static_cast<uint64_t>(min) + res * units));
+    }
+
     /*
      *  Calculate the number of bits needed to represent the field, considering
      *  only the max and min.
@@ -426,6 +1205,22 @@ XCDFFieldData<double>::CalculateTypeValue(uint64_t datum) const {
   return activeMin_ + resolution_ * datum;
 }
 
+    /*
+     *  Specialization for floating point.  Blocks written with all 64 bits
+     *  hold raw doubles, so only infinite bounds are safe.
+     */
+template <>
+inline std::pair<double, double>
+XCDFFieldData<double>::CalcBlockBounds(double min, uint32_t size) const {
+
+  double inf = std::numeric_limits<double>::infinity();
+  if (size >= XCDF_DATUM_WIDTH_BITS || !IsFinite(min)) {
+    return std::pair<double, double>(-inf, inf);
+  }
+  return std::pair<double, double>(min, min + resolution_ *
+                          ((static_cast<uint64_t>(1) << size) - 1));
+}
+
     /*
      *  Get the #resolution units between active min and current datum.
      */
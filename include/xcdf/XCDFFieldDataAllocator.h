@@ -245,6 +245,29 @@ GetFloatingPointFieldRange(const XCDFFieldDataBase& base) {
   return static_cast<const XCDFFieldData<double>* >(&base)->GetGlobalRange();
 }
 
+inline
+std::pair<uint64_t, uint64_t>
+GetUnsignedIntegerFieldBounds(const XCDFFieldDataBase& base) {
+  CheckConvertible<uint64_t>(base);
+  return static_cast<const XCDFFieldData<uint64_t>* >(
+                                           &base)->GetGlobalBounds();
+}
+
+inline
+std::pair<int64_t, int64_t>
+GetSignedIntegerFieldBounds(const XCDFFieldDataBase& base) {
+  CheckConvertible<int64_t>(base);
+  return static_cast<const XCDFFieldData<int64_t>* >(
+                                           &base)->GetGlobalBounds();
+}
+
+inline
+std::pair<double, double>
+GetFloatingPointFieldBounds(const XCDFFieldDataBase& base) {
+  CheckConvertible<double>(base);
+  return static_cast<const XCDFFieldData<double>* >(&base)->GetGlobalBounds();
+}
+
 }
 
 #endif // XCDF_FIELD_DATA_ALLOCATOR_INCLUDED_H
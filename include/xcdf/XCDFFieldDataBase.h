@@ -47,7 +47,8 @@ class XCDFFieldDataBase {
 
     XCDFFieldDataBase(const XCDFFieldType type,
                       const std::string& name) : type_(type),
-                                                 name_(name) { }
+                                                 name_(name),
+                                           encoding_(XCDF_ENCODING_PLAIN) { }
 
     virtual ~XCDFFieldDataBase() { }
 
@@ -62,6 +63,7 @@ class XCDFFieldDataBase {
     virtual void Shrink() = 0;
     virtual void Reset() = 0;
     virtual uint32_t GetActiveSize() const = 0;
+    virtual uint32_t GetHeaderSize() const = 0;
     virtual uint64_t GetRawResolution() const = 0;
     virtual unsigned GetSize() const = 0;
     virtual unsigned GetExpectedSize() const = 0;
@@ -74,13 +76,24 @@ class XCDFFieldDataBase {
     virtual void SetRawGlobalMax(uint64_t rawGlobalMax) = 0;
     virtual void SetTotalBytes(uint64_t totalBytes) = 0;
     virtual void ClearBitsProcessed() = 0;
+    virtual void AddBitsProcessed(uint64_t bits) = 0;
     virtual void CalculateGlobals() = 0;
     virtual bool GlobalsSet() const = 0;
+    virtual void SetRawBlockHeader(uint64_t rawActiveMin,
+                                   uint32_t activeSize) = 0;
+    virtual void DumpRawValue(XCDFBlockData& data, uint64_t datum) = 0;
+    virtual void CheckBlockBounds(uint64_t rawActiveMin,
+                                  uint32_t activeSize) = 0;
+    virtual bool IsFixedWidthBlock() const = 0;
 
     XCDFFieldType GetType() const {return type_;}
 
     const std::string& GetName() const {return name_;}
 
+    /// Encoding applied to the field values inside each block
+    XCDFFieldEncoding GetEncoding() const {return encoding_;}
+    void SetEncoding(const XCDFFieldEncoding encoding) {encoding_ = encoding;}
+
     virtual bool HasParent() const {return false;}
 
     /// Use the empty string to denote no parent.
@@ -113,6 +126,9 @@ class XCDFFieldDataBase {
 
     /// Name of the field
     std::string name_;
+
+    /// Encoding of the field values
+    XCDFFieldEncoding encoding_;
 };
 
 typedef XCDFPtr<XCDFFieldDataBase> XCDFFieldDataBasePtr;
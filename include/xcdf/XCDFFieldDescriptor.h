@@ -27,6 +27,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef XCDF_FIELD_DESCRIPTOR_INCLUDED_H
 #define XCDF_FIELD_DESCRIPTOR_INCLUDED_H
 
+#include <xcdf/XCDFDefs.h>
+
 #include <string>
 #include <stdint.h>
 
@@ -37,7 +39,8 @@ class XCDFFieldDescriptor {
     XCDFFieldDescriptor() : name_ (""),
                             type_(0xFF),
                             rawResolution_(0),
-                            parentName_("") { }
+                            parentName_(""),
+                            encoding_(XCDF_ENCODING_PLAIN) { }
 
     ~XCDFFieldDescriptor() { }
 
@@ -45,12 +48,14 @@ class XCDFFieldDescriptor {
     char type_;
     uint64_t rawResolution_;
     std::string parentName_;
+    char encoding_;
 
     bool operator==(const XCDFFieldDescriptor& fd) const {
       return name_ == fd.name_ &&
              type_ == fd.type_ &&
              rawResolution_ == fd.rawResolution_ &&
-             parentName_ == fd.parentName_;
+             parentName_ == fd.parentName_ &&
+             encoding_ == fd.encoding_;
     }
 
     bool operator!=(const XCDFFieldDescriptor& fd) const {
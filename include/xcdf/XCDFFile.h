@@ -51,8 +51,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <map>
 #include <ostream>
 #include <istream>
+#include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <cfloat>
+#include <cmath>
 
 /*!
  * @class XCDFFile
@@ -161,9 +164,92 @@ class XCDFFile {
     /// Seek to the given event in the file by absolute position
     bool Seek(uint64_t absoluteEventPos);
 
+    /*
+     *   Copy the unread events of the current block, or else of the next
+     *   block with events, into destination without decoding them.  The
+     *   fields of this file are not updated.  Return the number of events
+     *   copied, or 0 if no further events can be read.
+     */
+    uint64_t CopyBlock(XCDFFile& destination);
+
+    /// Check if CopyBlock() can copy into destination: the destination
+    /// fields must be a subset of the fields in this file, with the same
+    /// types, resolutions and parents, and in the same order.
+    bool IsBlockCopyCompatible(const XCDFFile& destination) const {
+      std::vector<int> map;
+      return GetBlockCopyMap(destination, map);
+    }
+
+    /*
+     *   Copy all blocks of this file into destination frame by frame.
+     *   Block data frames are written as read, compressed payload
+     *   included, and only the block table entries are rebuilt.  The
+     *   field globals and byte counts are taken from the file trailers.
+     *   Return the number of events copied.
+     */
+    uint64_t CopyFrames(XCDFFile& destination);
+
+    /*
+     *   Verify the remaining frames of the file without decoding events.
+     *   Frame checksums and frame ordering are checked as each frame is
+     *   read, and the blocks found are compared with the block table and
+     *   event count in the file trailers.  With inflate set, compressed
+     *   block data is also inflated and checked for size.  Errors are
+     *   reported with XCDFFatal.  Return the number of events in the file.
+     */
+    uint64_t CheckFrames(bool inflate = false);
+
+    /// Check if CopyFrames() can copy into destination: nothing may have
+    /// been read from this file, both files must have the same
+    /// version and fields, and the field globals must be available
+    /// from the trailer(s).  If the block table was not loaded (streamed
+    /// input), the trailers are not read until the copy ends, so
+    /// require a file version that stores globals.
+    bool IsFrameCopyCompatible(const XCDFFile& destination) const {
+      return IsReadable() && destination.IsWritable() && !recover_ &&
+             eventCount_ == 0 && blockEventCount_ == 0 &&
+             fileHeader_ == destination.fileHeader_ &&
+             (blockTableComplete_ ? haveV3Globals_ :
+                                    fileHeader_.GetVersion() > 2);
+    }
+
     /// Return the total number of events in the file
     uint64_t GetEventCount();
 
+    /// Fill the number of the first event in each block from the block
+    /// table.  Returns false if the block table is not available.
+    bool GetBlockStartEvents(std::vector<uint64_t>& starts) const {
+
+      starts.clear();
+      if (!IsReadable() || !blockTableComplete_) {
+        return false;
+      }
+
+      for (std::vector<XCDFBlockEntry>::const_iterator
+                          it = fileTrailer_.BlockEntriesBegin();
+                          it != fileTrailer_.BlockEntriesEnd(); ++it) {
+        starts.push_back(it->nextEventNumber_);
+      }
+      return true;
+    }
+
+    /// Fill the file offset of each block from the block table.  Returns
+    /// false if the block table is not available.
+    bool GetBlockOffsets(std::vector<uint64_t>& offsets) const {
+
+      offsets.clear();
+      if (!IsReadable() || !blockTableComplete_) {
+        return false;
+      }
+
+      for (std::vector<XCDFBlockEntry>::const_iterator
+                          it = fileTrailer_.BlockEntriesBegin();
+                          it != fileTrailer_.BlockEntriesEnd(); ++it) {
+        offsets.push_back(it->filePtr_);
+      }
+      return true;
+    }
+
     /// Return the number of the current event
     uint64_t GetCurrentEventNumber() const {
 
@@ -183,6 +269,14 @@ class XCDFFile {
     /// Return the number of the current block
     uint64_t GetCurrentBlockNumber() const {return blockCount_;}
 
+    /// Return a number that changes each time an event is read or the
+    /// field data is reloaded or cleared (Rewind, Seek, new blocks), for
+    /// caching values computed from the event.  Return 0 if the file is
+    /// not being read, as the fields may then change at any time.
+    uint64_t GetEventStamp() const {
+      return IsReadable() ? eventStamp_ : 0;
+    }
+
     /// Return the file to a state where calling Read() gives the
     /// starting event, if possible.
     bool Rewind();
@@ -267,6 +361,56 @@ class XCDFFile {
       return (*FindFieldByName(name, true))->IsFloatingPointField();
     }
 
+    /*
+     *  Set the encoding used to store a field inside each block.  Delta
+     *  encoding suits fields that are monotonic or vary slowly from event
+     *  to event, such as times or counters.  Must be set before the first
+     *  event is written.
+     */
+    void SetFieldEncoding(const std::string& name,
+                          const XCDFFieldEncoding encoding) {
+
+      XCDFFieldDataBase& field = **FindFieldByName(name, true);
+      if (isAppend_) {
+        if (field.GetEncoding() != encoding) {
+          XCDFFatal("Unable to change encoding of field " <<
+                                               name << " in append");
+        }
+        return;
+      }
+      CheckModifiable();
+      field.SetEncoding(encoding);
+      fileHeader_.SetFieldEncoding(name, encoding);
+    }
+
+    /*
+     *  Shuffle the block data before deflate so that the same bits of
+     *  every event are stored together, which compresses slowly-varying
+     *  fields much better.  Blocks with vector or variable-width encoded
+     *  fields are not shuffled.  Files written with shuffling need a
+     *  newer version of the library to read.
+     */
+    void SetShuffle(const bool shuffle) {
+
+      if (isAppend_) {
+        if (fileHeader_.GetShuffle() != shuffle) {
+          XCDFFatal("Unable to change shuffling in append");
+        }
+        return;
+      }
+      CheckModifiable();
+      fileHeader_.SetShuffle(shuffle);
+    }
+
+    bool GetShuffle() const {return fileHeader_.GetShuffle();}
+
+    /*
+     *  Get the encoding used to store a field inside each block
+     */
+    XCDFFieldEncoding GetFieldEncoding(const std::string& name) const {
+      return (*FindFieldByName(name, true))->GetEncoding();
+    }
+
     /*
      *  Provide explicit GetField routines rather than a templated
      */
@@ -309,10 +453,17 @@ class XCDFFile {
     FieldDescriptorsEnd() const {return fileHeader_.FieldDescriptorsEnd();}
 
     uint64_t GetFieldBytes(const std::string& name) {
-      CheckGlobals();
-      return (*FindFieldByName(name, true))->GetTotalBytes();
+      const XCDFFieldDataBase& field = **FindFieldByName(name, true);
+      if (!IsHeaderCounted(field) || !UseHeaderGlobals()) {
+        CheckGlobals();
+      }
+      return field.GetTotalBytes();
     }
 
+    /// Load the field global ranges and byte counts, reading through
+    /// the file if they are not available from the trailer
+    void LoadGlobals() {CheckGlobals();}
+
     std::pair<uint64_t, uint64_t>
     GetUnsignedIntegerFieldRange(const std::string& name) {
       CheckGlobals();
@@ -334,6 +485,72 @@ class XCDFFile {
                                                **FindFieldByName(name, true));
     }
 
+    /// Get bounds on the values of a field.  If the file trailer has no
+    /// usable globals, the bounds come from the block headers without
+    /// reading the events: they enclose the field range, but the max may
+    /// be loose.  Otherwise they are the exact range.
+    std::pair<uint64_t, uint64_t>
+    GetUnsignedIntegerFieldBounds(const std::string& name) {
+      if (!UseHeaderGlobals()) {
+        return GetUnsignedIntegerFieldRange(name);
+      }
+      return XCDFFieldDataAllocator::GetUnsignedIntegerFieldBounds(
+                                               **FindFieldByName(name, true));
+    }
+
+    std::pair<int64_t, int64_t>
+    GetSignedIntegerFieldBounds(const std::string& name) {
+      if (!UseHeaderGlobals()) {
+        return GetSignedIntegerFieldRange(name);
+      }
+      return XCDFFieldDataAllocator::GetSignedIntegerFieldBounds(
+                                               **FindFieldByName(name, true));
+    }
+
+    std::pair<double, double>
+    GetFloatingPointFieldBounds(const std::string& name) {
+      if (!UseHeaderGlobals()) {
+        return GetFloatingPointFieldRange(name);
+      }
+      return XCDFFieldDataAllocator::GetFloatingPointFieldBounds(
+                                               **FindFieldByName(name, true));
+    }
+
+    /// True if the field bounds were taken from the block headers
+    /// rather than being the exact ranges
+    bool GlobalRangesAreBounds() const {
+      return !haveV3Globals_ && haveHeaderGlobals_;
+    }
+
+    /// Get the size in bytes (1, 2, 4 or 8) of the narrowest in-memory
+    /// type that holds every value of a field without loss, judging by the
+    /// field bounds.  Integer fields fit the integer of that size and
+    /// signedness.  Floating point fields fit a float (4 bytes) if their
+    /// bounds are finite and rounding to float moves no value by more than
+    /// half the field resolution.
+    unsigned GetFieldValueSize(const std::string& name) {
+
+      if (IsUnsignedIntegerField(name)) {
+        uint64_t max = GetUnsignedIntegerFieldBounds(name).second;
+        return max <= 0xffULL ? 1 :
+               max <= 0xffffULL ? 2 :
+               max <= 0xffffffffULL ? 4 : 8;
+      }
+
+      if (IsSignedIntegerField(name)) {
+        std::pair<int64_t, int64_t> b = GetSignedIntegerFieldBounds(name);
+        return b.first >= -0x80LL && b.second <= 0x7fLL ? 1 :
+               b.first >= -0x8000LL && b.second <= 0x7fffLL ? 2 :
+               b.first >= -0x80000000LL && b.second <= 0x7fffffffLL ? 4 : 8;
+      }
+
+      // Float spacing at x is at most x * FLT_EPSILON
+      double res = GetFloatingPointField(name).GetResolution();
+      std::pair<double, double> b = GetFloatingPointFieldBounds(name);
+      double max = std::max(std::fabs(b.first), std::fabs(b.second));
+      return res > 0. && max <= FLT_MAX && max * FLT_EPSILON <= res ? 4 : 8;
+    }
+
 
     /// Set the maximum number of events contained in a block
     void SetBlockSize(const uint64_t blockSize) {blockSize_ = blockSize;}
@@ -351,6 +568,22 @@ class XCDFFile {
       return thresholdByteCount_;
     }
 
+    /// Set a target size (in bytes) for compressed blocks, or 0 to disable
+    /// (default).  After the first block, blocks end when their data is
+    /// expected to compress to the target, judging by the compression of
+    /// the previous block, instead of after a fixed number of events.  The
+    /// threshold byte count still limits the memory used by a block.
+    void SetTargetBlockBytes(const uint64_t bytes) {targetBlockBytes_ = bytes;}
+
+    /// Get the target size (in bytes) of compressed blocks
+    uint64_t GetTargetBlockBytes() const {return targetBlockBytes_;}
+
+    /// Set the size (in bytes) of the buffer used to read files opened by
+    /// name (default: 4 MB).  Takes effect immediately.
+    void SetInputBufferSize(const size_t size) {
+      streamHandler_.SetInputBufferSize(size);
+    }
+
     /// Disable ability to do fast seek operations (usually never necessary)
     void DisableBlockTable() {fileTrailer_.DisableBlockTable();}
 
@@ -619,13 +852,21 @@ class XCDFFile {
     // Configurable parameters
     uint64_t blockSize_;
     uint64_t thresholdByteCount_;
+    uint64_t targetBlockBytes_;
     bool zeroAlign_;
 
+    // Compressed bytes per byte of write cache in the last block written
+    double blockCompressionRatio_;
+
     // Counters
     uint64_t eventCount_;
     uint64_t blockCount_;
     uint32_t blockEventCount_;
 
+    // Incremented on each event read.  Never reset, so values cached in an
+    // earlier file opened by this object are not reused.
+    uint64_t eventStamp_;
+
     // Internal state controllers
     bool isModifiable_;
     bool blockTableComplete_;
@@ -639,12 +880,14 @@ class XCDFFile {
     // State of field global data
     bool unusableGlobalsFromFile_;
     bool haveV3Globals_;
+    bool haveHeaderGlobals_;
 
     // I/O frame.  Allocate only one copy for efficiency.
     XCDFFrame currentFrame_;
     std::streampos currentFileStartOffset_;
     std::streampos currentFrameStartOffset_;
     std::streampos currentFrameEndOffset_;
+    std::streampos currentBlockStartOffset_;
 
     // Frame object pool.  Allocate only one copy for efficiency.
     XCDFFileHeader  fileHeader_;
@@ -657,12 +900,22 @@ class XCDFFile {
 
     void Init();
     void WriteFrame();
-    void ReadFrame();
+    void ReadFrame(bool inflate = true);
     void WriteBlock();
+    uint64_t GetStashBytes() const;
+    uint32_t GetBlockRecordBits() const;
     void WriteEvent();
     void ReadEvent();
-    bool ReadNextBlock();
+    bool ReadNextBlock(bool unpackData = true);
+    void AdviseNextBlock();
+
+    static bool BlockStartsAfter(uint64_t offset,
+                                 const XCDFBlockEntry& entry) {
+      return offset < entry.filePtr_;
+    }
     bool GetNextBlockWithEvents();
+    bool GetBlockCopyMap(const XCDFFile& destination,
+                         std::vector<int>& map) const;
     bool DoSeek(const std::streampos& pos);
     void ReadFileHeaders();
     void LoadFileHeader(XCDFFileHeader& header);
@@ -670,6 +923,22 @@ class XCDFFile {
     void CopyTrailer(const XCDFFileTrailer& trailer);
     void SetGlobals(const XCDFFileTrailer& trailer);
     void CheckGlobals();
+    bool LoadHeaderGlobals();
+    void AddHeaderGlobals(const XCDFBlockHeader& header,
+                          std::vector<uint64_t>& bits);
+    void RestoreEvent(uint64_t eventCount);
+
+    /// Globals come from the block headers if the trailer has none
+    bool UseHeaderGlobals() {
+      return !haveV3Globals_ && LoadHeaderGlobals();
+    }
+
+    /// Byte counts of scalar plain fields follow from the block
+    /// headers alone
+    static bool IsHeaderCounted(const XCDFFieldDataBase& field) {
+      return !field.HasParent() &&
+             field.GetEncoding() == XCDF_ENCODING_PLAIN;
+    }
     bool NextFrameExists();
     bool OpenAppend(const char* filename);
     bool PrepareAppend(const char* filename,
@@ -815,4 +1084,8 @@ class XCDFFile {
     }
 };
 
+inline uint64_t GetXCDFEventStamp(const XCDFFile& f) {
+  return f.GetEventStamp();
+}
+
 #endif // XCDF_FILE_INCLUDED_H
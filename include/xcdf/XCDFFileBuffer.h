@@ -0,0 +1,336 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_FILE_BUFFER_INCLUDED_H
+#define XCDF_FILE_BUFFER_INCLUDED_H
+
+#include <xcdf/config.h>
+
+#ifdef XCDF_HAVE_PREAD
+
+#include <istream>
+#include <streambuf>
+#include <algorithm>
+#include <cerrno>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Default size of the input file buffer: 4 MB
+#define XCDF_DEFAULT_INPUT_BUFFER_SIZE 4194304
+
+// Size of the first read after opening or seeking: 64 kB
+#define XCDF_MIN_INPUT_FILL_SIZE 65536
+
+/*!
+ * @class XCDFFileBuffer
+ * @brief Read-only stream buffer for a file, using a large buffer filled
+ * with pread().  Seeks inside the buffered data only move the get pointer,
+ * so seeking back to a frame does not discard the buffer.  Reads start
+ * small after opening or seeking elsewhere, so reading headers and
+ * trailers stays cheap, and double on each sequential refill up to the
+ * buffer size.  The kernel is told that the file is read sequentially,
+ * and each refill asks it to read ahead the next refill's worth.
+ * Files that cannot be seeked (FIFOs, pipes) are read sequentially with
+ * read() instead, and cannot be seeked.
+ */
+
+class XCDFFileBuffer : public std::streambuf {
+
+  public:
+
+    XCDFFileBuffer() : fd_(-1),
+                       sequential_(false),
+                       offset_(0),
+                       bufferSize_(XCDF_DEFAULT_INPUT_BUFFER_SIZE),
+                       fillSize_(0),
+                       buffer_(NULL) { }
+
+    ~XCDFFileBuffer() {Close();}
+
+    bool Open(const char* fileName) {
+
+      Close();
+      fd_ = open(fileName, O_RDONLY);
+      if (fd_ < 0) {
+        return false;
+      }
+
+      // Only regular files can be read at arbitrary offsets
+      struct stat st;
+      sequential_ = fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode);
+
+      buffer_ = new char[bufferSize_];
+      Discard();
+#ifdef XCDF_HAVE_POSIX_FADVISE
+      if (!sequential_) {
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+      }
+#endif
+      return true;
+    }
+
+    void Close() {
+
+      if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+      }
+      delete[] buffer_;
+      buffer_ = NULL;
+      setg(NULL, NULL, NULL);
+      offset_ = 0;
+      fillSize_ = 0;
+      sequential_ = false;
+    }
+
+    bool IsOpen() const {return fd_ >= 0;}
+
+    /// Set the size of the buffer.  Buffered data is discarded, but the
+    /// read position is kept.
+    void SetBufferSize(size_t size) {
+
+      bufferSize_ = size > 0 ? size : 1;
+      if (!IsOpen()) {
+        return;
+      }
+
+      // Sequential input cannot be read again, so keep unread data
+      size_t unread = sequential_ ? egptr() - gptr() : 0;
+      char* buffer = new char[std::max(bufferSize_, unread)];
+      traits_type::copy(buffer, gptr(), unread);
+      offset_ = GetPosition();
+      delete[] buffer_;
+      buffer_ = buffer;
+      Discard();
+      setg(buffer_, buffer_, buffer_ + unread);
+    }
+
+    size_t GetBufferSize() const {return bufferSize_;}
+
+    /// Tell the kernel that a range of the file will be read soon
+    void WillNeed(uint64_t offset, uint64_t length) {
+#ifdef XCDF_HAVE_POSIX_FADVISE
+      if (IsOpen() && !sequential_ && length > 0) {
+        posix_fadvise(fd_, offset, length, POSIX_FADV_WILLNEED);
+      }
+#endif
+    }
+
+  protected:
+
+    virtual int_type underflow() {
+
+      if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+      }
+      if (!IsOpen()) {
+        return traits_type::eof();
+      }
+
+      offset_ = GetPosition();
+      ssize_t n = ReadAt(buffer_, fillSize_, offset_);
+      setg(buffer_, buffer_, buffer_ + (n > 0 ? n : 0));
+      if (n <= 0) {
+        return traits_type::eof();
+      }
+      fillSize_ = std::min(2 * fillSize_, bufferSize_);
+      WillNeed(offset_ + n, fillSize_);
+      return traits_type::to_int_type(*gptr());
+    }
+
+    virtual std::streamsize xsgetn(char* s, std::streamsize n) {
+
+      std::streamsize done = 0;
+      while (done < n) {
+
+        std::streamsize available = egptr() - gptr();
+        if (available > 0) {
+
+          // Copy from the buffer
+          std::streamsize count = n - done < available ? n - done : available;
+          traits_type::copy(s + done, gptr(), count);
+          setg(eback(), gptr() + count, egptr());
+          done += count;
+
+        } else if (static_cast<size_t>(n - done) >= fillSize_) {
+
+          // Large reads go straight to the destination
+          offset_ = GetPosition();
+          ssize_t count = ReadAt(s + done, n - done, offset_);
+          if (count <= 0) {
+            break;
+          }
+          offset_ += count;
+          setg(buffer_, buffer_, buffer_);
+          fillSize_ = bufferSize_;
+          done += count;
+
+        } else if (underflow() == traits_type::eof()) {
+          break;
+        }
+      }
+      return done;
+    }
+
+    virtual pos_type seekoff(off_type off,
+                             std::ios_base::seekdir dir,
+                             std::ios_base::openmode which) {
+
+      off_type base = 0;
+      if (dir == std::ios_base::cur) {
+        base = GetPosition();
+      } else if (dir == std::ios_base::end) {
+        struct stat st;
+        if (!IsOpen() || sequential_ || fstat(fd_, &st) != 0) {
+          return pos_type(off_type(-1));
+        }
+        base = st.st_size;
+      }
+      return seekpos(pos_type(base + off), which);
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which) {
+
+      off_type target = off_type(pos);
+      if (!IsOpen() || !(which & std::ios_base::in) || target < 0) {
+        return pos_type(off_type(-1));
+      }
+
+      // Sequential input can only report its position.  Allowing seeks
+      // inside the buffer would make seeking succeed or fail depending
+      // on how much happens to be buffered.
+      if (sequential_) {
+        return target == GetPosition() ? pos : pos_type(off_type(-1));
+      }
+
+      // Keep the buffer if the target is inside it
+      if (target >= offset_ && target <= offset_ + (egptr() - eback())) {
+        setg(eback(), eback() + (target - offset_), egptr());
+      } else {
+        offset_ = target;
+        Discard();
+      }
+      return pos;
+    }
+
+  private:
+
+    int fd_;
+    bool sequential_;              // read() in order instead of pread()
+    off_type offset_;              // file offset of the start of the buffer
+    size_t bufferSize_;
+    size_t fillSize_;              // bytes read by the next refill
+    char* buffer_;
+
+    XCDFFileBuffer(const XCDFFileBuffer&);
+    XCDFFileBuffer& operator=(const XCDFFileBuffer&);
+
+    off_type GetPosition() const {return offset_ + (gptr() - eback());}
+
+    // Drop the buffered data and start again with a small refill
+    void Discard() {
+      setg(buffer_, buffer_, buffer_);
+      fillSize_ = std::min(static_cast<size_t>(XCDF_MIN_INPUT_FILL_SIZE),
+                           bufferSize_);
+    }
+
+    // Read up to size bytes at offset, retrying interrupted and short reads.
+    // Sequential input is always read at the current position, which is
+    // the end of the buffered data.
+    ssize_t ReadAt(char* s, size_t size, off_type offset) {
+
+      size_t done = 0;
+      while (done < size) {
+        ssize_t n = sequential_ ?
+                    read(fd_, s + done, size - done) :
+                    pread(fd_, s + done, size - done, offset + done);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+
+        // Nothing has been read from the descriptor yet, so it is
+        // still positioned at the start of the input
+        if (n < 0 && errno == ESPIPE && !sequential_ && offset + done == 0) {
+          sequential_ = true;
+          continue;
+        }
+        if (n < 0) {
+          return done > 0 ? done : -1;
+        }
+        if (n == 0) {
+          break;
+        }
+        done += n;
+      }
+      return done;
+    }
+};
+
+/*!
+ * @class XCDFInputFileStream
+ * @brief Input stream reading a file through an XCDFFileBuffer
+ */
+
+class XCDFInputFileStream : public std::istream {
+
+  public:
+
+    XCDFInputFileStream() : std::istream(NULL) {init(&buffer_);}
+
+    bool Open(const char* fileName) {
+      clear();
+      if (!buffer_.Open(fileName)) {
+        setstate(std::ios_base::failbit);
+        return false;
+      }
+      return true;
+    }
+
+    void Close() {
+      buffer_.Close();
+      clear();
+    }
+
+    bool IsOpen() const {return buffer_.IsOpen();}
+
+    void SetBufferSize(size_t size) {buffer_.SetBufferSize(size);}
+    size_t GetBufferSize() const {return buffer_.GetBufferSize();}
+
+    void WillNeed(uint64_t offset, uint64_t length) {
+      buffer_.WillNeed(offset, length);
+    }
+
+  private:
+
+    XCDFFileBuffer buffer_;
+};
+
+#endif // XCDF_HAVE_PREAD
+
+#endif // XCDF_FILE_BUFFER_INCLUDED_H
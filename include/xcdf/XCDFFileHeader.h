@@ -47,7 +47,8 @@ class XCDFFileHeader {
   public:
 
     XCDFFileHeader() : fileTrailerPtr_(0),
-                       version_(XCDF_VERSION) { }
+                       version_(XCDF_FIELD_ENCODING_VERSION - 1),
+                       shuffle_(false) { }
 
     ~XCDFFileHeader() { }
 
@@ -65,8 +66,28 @@ class XCDFFileHeader {
       fieldDescriptors_.insert(
                     std::upper_bound(fieldDescriptors_.begin(),
                                      fieldDescriptors_.end(), d), d);
+      UpdateVersion();
     }
 
+    /// Set the encoding of a field.  Encoded fields need a newer version.
+    void SetFieldEncoding(const std::string& name,
+                          const XCDFFieldEncoding encoding) {
+      for (std::vector<XCDFFieldDescriptor>::iterator
+                         it = fieldDescriptors_.begin();
+                         it != fieldDescriptors_.end(); ++it) {
+        if (it->name_ == name) {
+          it->encoding_ = encoding;
+        }
+      }
+      UpdateVersion();
+    }
+
+    /// Shuffle block data before deflate.  Needs a newer version.
+    void SetShuffle(const bool shuffle) {
+      shuffle_ = shuffle;
+      UpdateVersion();
+    }
+    bool GetShuffle() const {return shuffle_;}
 
     bool HasAliasDescriptor(const XCDFAliasDescriptor& d) {
       return std::find(aliasDescriptors_.begin(),
@@ -105,6 +126,10 @@ class XCDFFileHeader {
         XCDFFatal("Unable to read file of version " << version_);
       }
       fileTrailerPtr_ = frame.GetUnsigned64();
+      shuffle_ = false;
+      if (version_ >= XCDF_SHUFFLE_VERSION) {
+        shuffle_ = frame.GetChar() != 0;
+      }
 
       uint32_t nFields = frame.GetUnsigned32();
       fieldDescriptors_.reserve(nFields);
@@ -114,6 +139,14 @@ class XCDFFileHeader {
         descriptor.type_ = frame.GetChar();
         descriptor.rawResolution_ = frame.GetUnsigned64();
         descriptor.parentName_ = frame.GetString();
+        if (version_ >= XCDF_FIELD_ENCODING_VERSION) {
+          descriptor.encoding_ = frame.GetChar();
+          if (!XCDFFieldEncodingValid(descriptor.encoding_)) {
+            XCDFFatal("Unknown encoding " <<
+                      static_cast<int>(descriptor.encoding_) <<
+                      " for field " << descriptor.name_);
+          }
+        }
         fieldDescriptors_.push_back(descriptor);
       }
 
@@ -135,6 +168,9 @@ class XCDFFileHeader {
       frame.SetType(XCDF_FILE_HEADER);
       frame.PutUnsigned32(version_);
       frame.PutUnsigned64(fileTrailerPtr_);
+      if (version_ >= XCDF_SHUFFLE_VERSION) {
+        frame.PutChar(shuffle_);
+      }
 
       frame.PutUnsigned32(fieldDescriptors_.size());
       for (std::vector<XCDFFieldDescriptor>::const_iterator
@@ -144,6 +180,9 @@ class XCDFFileHeader {
         frame.PutChar(it->type_);
         frame.PutUnsigned64(it->rawResolution_);
         frame.PutString(it->parentName_);
+        if (version_ >= XCDF_FIELD_ENCODING_VERSION) {
+          frame.PutChar(it->encoding_);
+        }
       }
 
       frame.PutUnsigned32(aliasDescriptors_.size());
@@ -160,6 +199,7 @@ class XCDFFileHeader {
 
       // Aliases do not affect the equivalence of headers
       return version_ == fh.version_ &&
+             shuffle_ == fh.shuffle_ &&
              fieldDescriptors_ == fh.fieldDescriptors_;
     }
 
@@ -169,8 +209,25 @@ class XCDFFileHeader {
 
     uint64_t fileTrailerPtr_;
     uint32_t version_;
+    bool shuffle_;
     std::vector<XCDFFieldDescriptor> fieldDescriptors_;
     std::vector<XCDFAliasDescriptor> aliasDescriptors_;
+
+    /// Write the oldest version able to hold the field encodings
+    /// and block shuffling
+    void UpdateVersion() {
+      version_ = XCDF_FIELD_ENCODING_VERSION - 1;
+      for (std::vector<XCDFFieldDescriptor>::const_iterator
+                         it = fieldDescriptors_.begin();
+                         it != fieldDescriptors_.end(); ++it) {
+        if (it->encoding_ != XCDF_ENCODING_PLAIN) {
+          version_ = XCDF_FIELD_ENCODING_VERSION;
+        }
+      }
+      if (shuffle_) {
+        version_ = XCDF_SHUFFLE_VERSION;
+      }
+    }
 };
 
 #endif // XCDF_FILE_HEADER_INCLUDED_H
@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <ostream>
 #include <istream>
+#include <algorithm>
 
 #include <zlib.h>
 #include <stdint.h>
@@ -61,6 +62,9 @@ class XCDFFrame {
   public:
 
     XCDFFrame() : type_(XCDF_NONE),
+                  deflated_(false),
+                  shuffled_(false),
+                  shuffleBits_(0),
                   machineIsBigEndian_(TestBigEndian()) { }
 
     ~XCDFFrame() { }
@@ -70,13 +74,30 @@ class XCDFFrame {
     XCDFFrameType GetType() const {return type_;}
     void SetType(const XCDFFrameType type) {type_ = type;}
 
+    /// Shuffle the payload before deflate, given the size in bits of the
+    /// records that make it up.  Cleared with the frame.
+    void SetShuffle(const uint32_t recordBits) {shuffleBits_ = recordBits;}
+
+    /*
+     *  Write the frame.  A frame read with Read(i, false) still holds its
+     *  compressed payload, and is written as it was read.
+     */
     void Write(std::ostream& o, bool deflate) {
 
-      if (deflate) {
+      bool shuffle = false;
+      if (deflated_) {
+        deflate = true;
+        shuffle = shuffled_;
+      } else if (deflate) {
+        if (shuffleBits_ > 0) {
+          buffer_.Shuffle(shuffleBits_);
+          shuffle = true;
+        }
         buffer_.Deflate();
       }
 
-      uint32_t deflatedType = XCDF_DEFLATED_FRAME;
+      uint32_t deflatedType = shuffle ? XCDF_SHUFFLED_FRAME :
+                                        XCDF_DEFLATED_FRAME;
       uint32_t type = type_;
       uint32_t size = buffer_.GetSize();
       uint32_t checksum = buffer_.CalculateChecksum();
@@ -104,11 +125,12 @@ class XCDFFrame {
                 buffer_.GetSize());
       }
 
-      buffer_.Clear();
+      Clear();
     }
 
-    // Verify frame type before allocating and reading data
-    void Read(std::istream& i) {
+    // Verify frame type before allocating and reading data.  If inflate
+    // is false, a deflated payload is kept compressed for copying.
+    void Read(std::istream& i, bool inflate = true) {
 
       uint32_t type, size, checksum;
       i.read(reinterpret_cast<char*>(&type), 4);
@@ -122,7 +144,9 @@ class XCDFFrame {
       }
 
       bool deflated = false;
-      if (static_cast<XCDFFrameType>(type) == XCDF_DEFLATED_FRAME) {
+      bool shuffled = static_cast<XCDFFrameType>(type) == XCDF_SHUFFLED_FRAME;
+      if (static_cast<XCDFFrameType>(type) == XCDF_DEFLATED_FRAME ||
+                                                               shuffled) {
         deflated = true;
         i.read(reinterpret_cast<char*>(&type), 4);
         if (IsBigEndian()) {
@@ -143,7 +167,7 @@ class XCDFFrame {
 
       // If size field is corrupt, this could potentially allocate 4GB.
       // Ignore.  Checksum should fail and program should end.
-      buffer_.Clear();
+      Clear();
       buffer_.Resize(size);
       if (size > 0) {
         i.read(reinterpret_cast<char*>(buffer_.GetBuffer()), size);
@@ -159,10 +183,39 @@ class XCDFFrame {
       }
 
       if (deflated) {
+        if (inflate) {
+          buffer_.Inflate();
+          if (shuffled) {
+            buffer_.Unshuffle();
+          }
+        } else {
+          deflated_ = true;
+          shuffled_ = shuffled;
+        }
+      }
+    }
+
+    /// Inflate a payload kept compressed by Read(i, false)
+    void Inflate() {
+      if (deflated_) {
         buffer_.Inflate();
+        if (shuffled_) {
+          buffer_.Unshuffle();
+        }
+        deflated_ = false;
+        shuffled_ = false;
       }
     }
 
+    /// Exchange contents with another frame
+    void Swap(XCDFFrame& other) {
+      std::swap(type_, other.type_);
+      std::swap(deflated_, other.deflated_);
+      std::swap(shuffled_, other.shuffled_);
+      std::swap(shuffleBits_, other.shuffleBits_);
+      buffer_.Swap(other.buffer_);
+    }
+
     void PutChar(char datum) {
       buffer_.Insert(1, reinterpret_cast<uint8_t*>(&datum));
     }
@@ -211,7 +264,12 @@ class XCDFFrame {
       return reinterpret_cast<const char*>(buffer_.Get(size));
     }
 
-    void Clear() {buffer_.Clear();}
+    void Clear() {
+      buffer_.Clear();
+      deflated_ = false;
+      shuffled_ = false;
+      shuffleBits_ = 0;
+    }
 
     const char* GetData() {
       if (buffer_.GetSize() == 0) {
@@ -229,6 +287,9 @@ class XCDFFrame {
 
     XCDFFrameType type_;
     XCDFFrameBuffer buffer_;
+    bool deflated_;
+    bool shuffled_;
+    uint32_t shuffleBits_;
     bool machineIsBigEndian_;
 
     void ConvertEndian(uint32_t& datum) const {
@@ -29,8 +29,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <xcdf/XCDFDefs.h>
 #include <xcdf/XCDFDeflate.h>
+#include <xcdf/XCDFShuffle.h>
 
 #include <vector>
+#include <algorithm>
 #include <stdint.h>
 
 /*!
@@ -86,6 +88,20 @@ class XCDFFrameBuffer {
       readIndex_ = 0;
     }
 
+    void Shuffle(uint32_t recordBits) {
+      std::vector<uint8_t> shuffled;
+      ShuffleVector(data_, shuffled, recordBits);
+      data_.swap(shuffled);
+      readIndex_ = 0;
+    }
+
+    void Unshuffle() {
+      std::vector<uint8_t> unshuffled;
+      UnshuffleVector(data_, unshuffled);
+      data_.swap(unshuffled);
+      readIndex_ = 0;
+    }
+
     uint32_t CalculateChecksum() {
 
       uint32_t value = adler32(0L, NULL, 0);
@@ -96,6 +112,11 @@ class XCDFFrameBuffer {
       return value;
     }
 
+    void Swap(XCDFFrameBuffer& other) {
+      data_.swap(other.data_);
+      std::swap(readIndex_, other.readIndex_);
+    }
+
     void Reserve(uint32_t size) {data_.reserve(size);}
     void Resize(uint32_t size) {data_.resize(size);}
     uint32_t GetSize() const {return data_.size();}
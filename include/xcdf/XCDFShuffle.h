@@ -0,0 +1,236 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_SHUFFLE_INCLUDED_H
+#define XCDF_SHUFFLE_INCLUDED_H
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <xcdf/XCDFDefs.h>
+
+/*
+ *  Prefilters applied to block data before deflate.  Block data holds a
+ *  sequence of records of a fixed number of bits, one per event.  Gathering
+ *  the same byte (or bit) of every record together turns the slowly-varying
+ *  high bits of each field into long runs that zlib compresses well.  The
+ *  shuffled payload starts with the record size in bits (little-endian),
+ *  followed by the shuffled data, the same size as the input.
+ *
+ *  Records of whole bytes are byte-shuffled, so byte j of every record is
+ *  stored together.  Otherwise the bits are transposed, 8 records at a time
+ *  (8 records of n bits are n bytes), so bit j of every record is stored
+ *  together.  Trailing data that does not fill a group is stored as is.
+ */
+
+#define XCDF_SHUFFLE_HEADER_BYTES 4
+
+/*
+ *  Transpose an 8x8 bit matrix stored one row per byte, so that bit j of
+ *  byte k becomes bit k of byte j.
+ */
+inline uint64_t TransposeBits8x8(uint64_t x) {
+
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  x = x ^ t ^ (t << 28);
+  return x;
+}
+
+inline void ShuffleBytes(const uint8_t* in, uint8_t* out,
+                         uint64_t nRecords, unsigned recordBytes) {
+
+  for (unsigned j = 0; j < recordBytes; ++j) {
+    uint8_t* plane = out + j * nRecords;
+    for (uint64_t i = 0; i < nRecords; ++i) {
+      plane[i] = in[i * recordBytes + j];
+    }
+  }
+}
+
+inline void UnshuffleBytes(const uint8_t* in, uint8_t* out,
+                           uint64_t nRecords, unsigned recordBytes) {
+
+  for (unsigned j = 0; j < recordBytes; ++j) {
+    const uint8_t* plane = in + j * nRecords;
+    for (uint64_t i = 0; i < nRecords; ++i) {
+      out[i * recordBytes + j] = plane[i];
+    }
+  }
+}
+
+/*
+ *  Each group of 8 records is read bit by bit into rows of 8 bits, one
+ *  word per 8 bits of the record with one byte per record, so a transpose
+ *  gives 8 bits of each of 8 bit planes.
+ */
+inline void TransposeBits(const uint8_t* in, uint8_t* out,
+                          uint64_t nGroups, unsigned recordBits) {
+
+  unsigned nFull = recordBits / 8;
+  unsigned nRows = (recordBits + 7) / 8;
+  unsigned lastWidth = recordBits % 8;
+  std::vector<uint64_t> rows(nRows);
+  for (uint64_t g = 0; g < nGroups; ++g) {
+
+    const uint8_t* group = in + g * recordBits;
+    std::fill(rows.begin(), rows.end(), 0);
+    uint64_t bits = 0;
+    unsigned nBits = 0;
+    for (unsigned k = 0; k < 8; ++k) {
+      for (unsigned r = 0; r < nFull; ++r) {
+        bits |= static_cast<uint64_t>(*group++) << nBits;
+        rows[r] |= (bits & 0xFF) << (8 * k);
+        bits >>= 8;
+      }
+      if (nFull < nRows) {
+        if (nBits < lastWidth) {
+          bits |= static_cast<uint64_t>(*group++) << nBits;
+          nBits += 8;
+        }
+        rows[nFull] |= (bits & ((1U << lastWidth) - 1)) << (8 * k);
+        bits >>= lastWidth;
+        nBits -= lastWidth;
+      }
+    }
+
+    for (unsigned r = 0; r < nRows; ++r) {
+      uint64_t x = TransposeBits8x8(rows[r]);
+      unsigned width = std::min(recordBits - 8 * r, 8U);
+      uint8_t* plane = out + 8 * r * nGroups + g;
+      for (unsigned j = 0; j < width; ++j) {
+        plane[j * nGroups] = static_cast<uint8_t>(x >> (8 * j));
+      }
+    }
+  }
+}
+
+inline void UntransposeBits(const uint8_t* in, uint8_t* out,
+                            uint64_t nGroups, unsigned recordBits) {
+
+  unsigned nFull = recordBits / 8;
+  unsigned nRows = (recordBits + 7) / 8;
+  unsigned lastWidth = recordBits % 8;
+  std::vector<uint64_t> rows(nRows);
+  for (uint64_t g = 0; g < nGroups; ++g) {
+
+    for (unsigned r = 0; r < nRows; ++r) {
+      unsigned width = std::min(recordBits - 8 * r, 8U);
+      const uint8_t* plane = in + 8 * r * nGroups + g;
+      uint64_t x = 0;
+      for (unsigned j = 0; j < width; ++j) {
+        x |= static_cast<uint64_t>(plane[j * nGroups]) << (8 * j);
+      }
+      rows[r] = TransposeBits8x8(x);
+    }
+
+    uint8_t* group = out + g * recordBits;
+    uint64_t bits = 0;
+    unsigned nBits = 0;
+    for (unsigned k = 0; k < 8; ++k) {
+      for (unsigned r = 0; r < nFull; ++r) {
+        bits |= ((rows[r] >> (8 * k)) & 0xFF) << nBits;
+        *group++ = static_cast<uint8_t>(bits);
+        bits >>= 8;
+      }
+      if (nFull < nRows) {
+        bits |= ((rows[nFull] >> (8 * k)) & 0xFF) << nBits;
+        nBits += lastWidth;
+        if (nBits >= 8) {
+          *group++ = static_cast<uint8_t>(bits);
+          bits >>= 8;
+          nBits -= 8;
+        }
+      }
+    }
+  }
+}
+
+inline
+void ShuffleVector(const std::vector<uint8_t>& in,
+                   std::vector<uint8_t>& out, uint32_t recordBits) {
+
+  out.resize(XCDF_SHUFFLE_HEADER_BYTES + in.size());
+  for (unsigned i = 0; i < XCDF_SHUFFLE_HEADER_BYTES; ++i) {
+    out[i] = static_cast<uint8_t>(recordBits >> (8 * i));
+  }
+  if (in.size() == 0) {
+    return;
+  }
+
+  uint64_t done = 0;
+  uint8_t* data = &out[XCDF_SHUFFLE_HEADER_BYTES];
+  if (recordBits % 8 == 0) {
+    uint64_t nRecords = in.size() / (recordBits / 8);
+    ShuffleBytes(&in[0], data, nRecords, recordBits / 8);
+    done = nRecords * (recordBits / 8);
+  } else {
+    uint64_t nGroups = in.size() / recordBits;
+    TransposeBits(&in[0], data, nGroups, recordBits);
+    done = nGroups * recordBits;
+  }
+  std::copy(in.begin() + done, in.end(), data + done);
+}
+
+inline
+void UnshuffleVector(const std::vector<uint8_t>& in,
+                     std::vector<uint8_t>& out) {
+
+  if (in.size() < XCDF_SHUFFLE_HEADER_BYTES) {
+    XCDFFatal("Shuffled frame is missing its header");
+  }
+  uint32_t recordBits = 0;
+  for (unsigned i = 0; i < XCDF_SHUFFLE_HEADER_BYTES; ++i) {
+    recordBits |= static_cast<uint32_t>(in[i]) << (8 * i);
+  }
+  if (recordBits == 0) {
+    XCDFFatal("Shuffled frame has an invalid record size");
+  }
+
+  out.resize(in.size() - XCDF_SHUFFLE_HEADER_BYTES);
+  if (out.size() == 0) {
+    return;
+  }
+
+  uint64_t done = 0;
+  const uint8_t* data = &in[XCDF_SHUFFLE_HEADER_BYTES];
+  if (recordBits % 8 == 0) {
+    uint64_t nRecords = out.size() / (recordBits / 8);
+    UnshuffleBytes(data, &out[0], nRecords, recordBits / 8);
+    done = nRecords * (recordBits / 8);
+  } else {
+    uint64_t nGroups = out.size() / recordBits;
+    UntransposeBits(data, &out[0], nGroups, recordBits);
+    done = nGroups * recordBits;
+  }
+  std::copy(data + done, data + out.size(), out.begin() + done);
+}
+
+#endif // XCDF_SHUFFLE_INCLUDED_H
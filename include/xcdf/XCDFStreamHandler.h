@@ -28,10 +28,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define XCDF_STREAM_HANDLER_INCLUDED_H
 
 #include <xcdf/XCDFPtr.h>
+#include <xcdf/XCDFFileBuffer.h>
 
 #include <ostream>
 #include <istream>
 #include <fstream>
+#include <cstddef>
+#include <stdint.h>
 
 /*!
  * @class XCDFStreamHandler
@@ -77,6 +80,22 @@ class XCDFStreamHandler {
 
     void Close() {streams_->Close();}
 
+    /// Set the size of the buffer used to read input files
+    void SetInputBufferSize(size_t size) {
+#ifdef XCDF_HAVE_PREAD
+      streams_->inputFileStream_.SetBufferSize(size);
+#endif
+    }
+
+    /// Hint that a range of the input file will be read soon
+    void WillNeed(uint64_t offset, uint64_t length) {
+#ifdef XCDF_HAVE_PREAD
+      if (streams_->istream_ == &streams_->inputFileStream_) {
+        streams_->inputFileStream_.WillNeed(offset, length);
+      }
+#endif
+    }
+
   private:
 
     class StreamsContainer {
@@ -113,8 +132,12 @@ class XCDFStreamHandler {
         void OpenInputFileStream(const char* fileName) {
 
           CloseInputFileStream();
+#ifdef XCDF_HAVE_PREAD
+          inputFileStream_.Open(fileName);
+#else
           inputFileStream_.open(
              fileName, std::ifstream::in | std::ifstream::binary);
+#endif
           if (!(inputFileStream_.fail())) {
             istream_ = &inputFileStream_;
           }
@@ -122,10 +145,16 @@ class XCDFStreamHandler {
 
         void CloseInputFileStream() {
 
+#ifdef XCDF_HAVE_PREAD
+          if (inputFileStream_.IsOpen()) {
+            inputFileStream_.Close();
+          }
+#else
           if (inputFileStream_.is_open()) {
             inputFileStream_.close();
             inputFileStream_.clear();
           }
+#endif
         }
 
         void Close() {
@@ -141,7 +170,11 @@ class XCDFStreamHandler {
         std::ostream* ostream_;
         uint32_t referenceCount_;
 
+#ifdef XCDF_HAVE_PREAD
+        XCDFInputFileStream inputFileStream_;
+#else
         std::ifstream inputFileStream_;
+#endif
         std::ofstream outputFileStream_;
     };
 
@@ -28,17 +28,27 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define XCDF_FIELD_ALIAS_INCLUDED_H
 
 #include <xcdf/XCDFDefs.h>
+#include <xcdf/XCDFPtr.h>
 #include <xcdf/alias/XCDFFieldAliasBase.h>
 #include <xcdf/utility/NumericalExpression.h>
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 
+class XCDFFile;
+
+// Stamp of the event loaded in the file, or 0 if values can't be cached.
+// Defined in XCDFFile.h
+inline uint64_t GetXCDFEventStamp(const XCDFFile& f);
+
 /*!
  * @class XCDFFieldAlias
  * @author Jim Braun
  * @brief Wrapper class representing an expression derived from an
- * XCDFField object
+ * XCDFField object.  Values are evaluated when first accessed in an event
+ * and cached until the file loads another event.  Copies of an alias share
+ * the cache, so an alias used by several expressions is evaluated once.
  */
 
 template <typename T>
@@ -48,9 +58,12 @@ class XCDFFieldAlias : public XCDFFieldAliasBase {
 
     XCDFFieldAlias(const std::string& name,
                    const std::string& expression,
-                   const NumericalExpression<T>& ne) :
+                   const NumericalExpression<T>& ne,
+                   const XCDFFile& f) :
                               XCDFFieldAliasBase(name, expression),
-                              expression_(ne) { }
+                              expression_(ne),
+                              file_(&f),
+                              cache_(xcdf_shared(new Cache())) { }
 
     virtual XCDFFieldType GetType() const;
     const std::string& GetName() const {return name_;}
@@ -59,10 +72,22 @@ class XCDFFieldAlias : public XCDFFieldAliasBase {
     const Node<T>& GetHeadNode() const {return expression_.GetHeadNode();}
 
     /// Get the number of entries in the expression for the current event
-    unsigned GetSize() const {return expression_.GetSize();}
+    unsigned GetSize() const {
+      uint64_t stamp = GetXCDFEventStamp(*file_);
+      if (stamp != 0 && stamp == cache_->stamp_) {
+        return cache_->values_.size();
+      }
+      return expression_.GetSize();
+    }
 
     /// Get a value from the field
-    T At(const uint32_t index) const {return expression_.Evaluate(index);}
+    T At(const uint32_t index) const {
+      const std::vector<T>& values = GetValues();
+      if (index < values.size()) {
+        return values[index];
+      }
+      return expression_.Evaluate(index);
+    }
     T operator[](const uint32_t index) const {
       return At(index);
     }
@@ -70,9 +95,31 @@ class XCDFFieldAlias : public XCDFFieldAliasBase {
 
   private:
 
+    struct Cache {
+      Cache() : stamp_(0) { }
+      uint64_t stamp_;
+      std::vector<T> values_;
+    };
+
     std::string name_;
     std::string expString_;
     NumericalExpression<T> expression_;
+    const XCDFFile* file_;
+    XCDFPtr<Cache> cache_;
+
+    // Evaluate all entries for the current event, unless already cached
+    const std::vector<T>& GetValues() const {
+      uint64_t stamp = GetXCDFEventStamp(*file_);
+      if (stamp == 0 || stamp != cache_->stamp_) {
+        cache_->stamp_ = 0;
+        cache_->values_.resize(expression_.GetSize());
+        for (unsigned i = 0; i < cache_->values_.size(); ++i) {
+          cache_->values_[i] = expression_.Evaluate(i);
+        }
+        cache_->stamp_ = stamp;
+      }
+      return cache_->values_;
+    }
 };
 
 template<>
@@ -42,7 +42,7 @@ DoAllocateFieldAlias(const std::string& name,
 
   NumericalExpression<T> ne = NumericalExpression<T>(expression, f);
   return XCDFFieldAliasBasePtr(
-               new XCDFFieldAlias<T>(name, expression, ne));
+               new XCDFFieldAlias<T>(name, expression, ne, f));
 }
 
 inline
@@ -0,0 +1,305 @@
+
+/*
+Copyright (c) 2014, University of Maryland
+                    Jim Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef XCDF_UTILITY_CSV_WRITER_H_INCLUDED
+#define XCDF_UTILITY_CSV_WRITER_H_INCLUDED
+
+#include <xcdf/XCDFFile.h>
+#include <xcdf/XCDFDefs.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cmath>
+#include <cerrno>
+#include <stdint.h>
+#include <unistd.h>
+
+/*
+ *  Format delimited text into a reusable buffer and write it out in
+ *  large chunks.  Numbers are formatted as "std::setprecision(15)"
+ *  would, without going through the stream locale: integers (and
+ *  floating point values holding integers) digit by digit, other
+ *  floating point values with snprintf().
+ */
+class CSVWriter {
+
+  public:
+
+    static const size_t DEFAULT_FLUSH_SIZE = 1 << 20;
+
+    CSVWriter(char delimiter = ',') : delimiter_(delimiter) {
+      buffer_.reserve(DEFAULT_FLUSH_SIZE + 4096);
+    }
+
+    char GetDelimiter() const {return delimiter_;}
+
+    void PutDelimiter() {buffer_.push_back(delimiter_);}
+    void PutChar(char c) {buffer_.push_back(c);}
+    void PutString(const std::string& s) {buffer_.append(s);}
+    void EndLine() {buffer_.push_back('\n');}
+
+    void Put(uint64_t value) {
+      char digits[24];
+      char* end = digits + sizeof(digits);
+      char* p = end;
+      do {
+        *--p = '0' + static_cast<char>(value % 10);
+        value /= 10;
+      } while (value > 0);
+      buffer_.append(p, end - p);
+    }
+
+    void Put(int64_t value) {
+      if (value < 0) {
+        buffer_.push_back('-');
+        Put(static_cast<uint64_t>(0) - static_cast<uint64_t>(value));
+      } else {
+        Put(static_cast<uint64_t>(value));
+      }
+    }
+
+    void Put(double value) {
+
+      // Integers below 10^15 print in full with 15 significant digits
+      if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        if (value == 0. && 1. / value < 0.) {
+          buffer_.append("-0", 2);
+        } else {
+          Put(static_cast<int64_t>(value));
+        }
+        return;
+      }
+
+      if (PutShortDecimal(value)) {
+        return;
+      }
+
+      char digits[32];
+      int n = snprintf(digits, sizeof(digits), "%.15g", value);
+      buffer_.append(digits, n);
+    }
+
+    const std::string& GetBuffer() const {return buffer_;}
+    size_t GetSize() const {return buffer_.size();}
+    bool IsFull() const {return buffer_.size() >= DEFAULT_FLUSH_SIZE;}
+    void Clear() {buffer_.clear();}
+
+    /// Write the buffer to a file descriptor and clear it
+    void Flush(int fd) {
+
+      const char* p = buffer_.data();
+      size_t remaining = buffer_.size();
+      while (remaining > 0) {
+        ssize_t n = write(fd, p, remaining);
+        if (n < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          XCDFFatal("CSV write failed: " << strerror(errno));
+        }
+        p += n;
+        remaining -= n;
+      }
+      buffer_.clear();
+    }
+
+  private:
+
+    std::string buffer_;
+    char delimiter_;
+
+    /*
+     *  Values stored at a decimal resolution are usually the double
+     *  nearest a decimal n / 10^d with at most 15 digits.  Such a decimal
+     *  is exactly what "%.15g" prints, so find the smallest d and print
+     *  n directly.  Values below 10^-4 print in exponential form and
+     *  are left to snprintf().
+     */
+    bool PutShortDecimal(double value) {
+
+      double magnitude = std::fabs(value);
+      if (!(magnitude >= 1e-4 && magnitude < 1e15)) {
+        return false;
+      }
+
+      double scale = 1.;
+      for (unsigned d = 1; d < 16; ++d) {
+
+        scale *= 10.;
+        double scaled = magnitude * scale;
+        if (scaled >= 1e15) {
+          return false;
+        }
+
+        double n = std::floor(scaled + 0.5);
+        if (n / scale != magnitude) {
+          continue;
+        }
+
+        char digits[24];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        uint64_t integer = static_cast<uint64_t>(n);
+        for (unsigned i = 0; i < d; ++i) {
+          *--p = '0' + static_cast<char>(integer % 10);
+          integer /= 10;
+        }
+        *--p = '.';
+        do {
+          *--p = '0' + static_cast<char>(integer % 10);
+          integer /= 10;
+        } while (integer > 0);
+        if (value < 0.) {
+          *--p = '-';
+        }
+        buffer_.append(p, end - p);
+        return true;
+      }
+      return false;
+    }
+};
+
+/*
+ *  Write the CSV header describing each selected field, and record which
+ *  fields are selected, in file order, for CSVFieldDataVisitor.  An empty
+ *  set of names selects all fields.
+ */
+class CSVFieldNameVisitor {
+
+  public:
+
+    CSVFieldNameVisitor(const XCDFFile& file,
+                        CSVWriter& writer,
+                        const std::set<std::string>& names,
+                        std::vector<bool>& selected) : file_(file),
+                                                       writer_(writer),
+                                                       names_(names),
+                                                       selected_(selected),
+                                                       firstCall_(true) {
+      selected_.clear();
+    }
+
+    template <typename T>
+    void operator()(ConstXCDFField<T> field) {
+
+      const std::string& name = field.GetName();
+      bool selected = names_.empty() || names_.find(name) != names_.end();
+      selected_.push_back(selected);
+      if (!selected) {
+        return;
+      }
+
+      if (!firstCall_) {
+        writer_.PutDelimiter();
+      }
+      firstCall_ = false;
+
+      std::ostringstream s;
+      s << name;
+      if (file_.IsVectorField(name)) {
+        s << "[" << file_.GetFieldParentName(name) << "]";
+      }
+      s << "/";
+
+      if (file_.IsUnsignedIntegerField(name)) {
+        s << "U";
+      } else if (file_.IsSignedIntegerField(name)) {
+        s << "I";
+      } else {
+        s << "F";
+      }
+
+      s << "/" << std::setprecision(16) << field.GetResolution();
+      writer_.PutString(s.str());
+    }
+
+  private:
+
+    const XCDFFile& file_;
+    CSVWriter& writer_;
+    const std::set<std::string>& names_;
+    std::vector<bool>& selected_;
+    bool firstCall_;
+};
+
+/*
+ *  Write the values of the selected fields in the current event.  Vector
+ *  field entries are separated by ':'.  Call Reset() before each event.
+ */
+class CSVFieldDataVisitor {
+
+  public:
+
+    CSVFieldDataVisitor(CSVWriter& writer,
+                        const std::vector<bool>& selected) :
+                                                 writer_(writer),
+                                                 selected_(selected),
+                                                 index_(0),
+                                                 firstCall_(true) { }
+
+    template <typename T>
+    void operator()(ConstXCDFField<T> field) {
+
+      if (!selected_[index_++]) {
+        return;
+      }
+
+      if (!firstCall_) {
+        writer_.PutDelimiter();
+      }
+      firstCall_ = false;
+
+      for (typename ConstXCDFField<T>::ConstIterator
+                                        it = field.Begin();
+                                        it != field.End(); ++it) {
+
+        if (it != field.Begin()) {
+          writer_.PutChar(':');
+        }
+        writer_.Put(*it);
+      }
+    }
+
+    void Reset() {
+      index_ = 0;
+      firstCall_ = true;
+    }
+
+  private:
+
+    CSVWriter& writer_;
+    const std::vector<bool>& selected_;
+    unsigned index_;
+    bool firstCall_;
+};
+
+#endif // XCDF_UTILITY_CSV_WRITER_H_INCLUDED
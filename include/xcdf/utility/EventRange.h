@@ -0,0 +1,182 @@
+
+/*
+Copyright (c) 2014, University of Maryland
+                    Jim Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_UTILITY_EVENT_RANGE_H_INCLUDED
+#define XCDF_UTILITY_EVENT_RANGE_H_INCLUDED
+
+#include <xcdf/XCDFFile.h>
+#include <xcdf/XCDFDefs.h>
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <stdint.h>
+
+/*
+ *  A contiguous range of events [start, end) in one file.  An end of
+ *  2^64-1 means "to the end of the file".
+ */
+struct EventRange {
+
+  EventRange(const std::string& fileName,
+             uint64_t start,
+             uint64_t end) : fileName_(fileName),
+                             start_(start),
+                             end_(end) { }
+
+  std::string fileName_;
+  uint64_t start_;
+  uint64_t end_;
+};
+
+typedef std::vector<EventRange> EventRangeList;
+
+/*
+ *  Read the events of an EventRange from a file opened on the range
+ *  file.  The first Read() seeks to the start of the range through
+ *  the block table.
+ */
+class EventRangeReader {
+
+  public:
+
+    EventRangeReader(XCDFFile& f,
+                     const EventRange& range) : f_(f),
+                                                range_(range),
+                                                started_(false) { }
+
+    bool Read() {
+
+      // Number of the event that would be read next
+      uint64_t next = f_.GetCurrentEventNumber() + 1;
+      if (next >= range_.end_) {
+        return false;
+      }
+
+      if (!started_) {
+        started_ = true;
+        if (range_.start_ >= range_.end_) {
+          return false;
+        }
+        if (range_.start_ > 0) {
+          return f_.Seek(range_.start_);
+        }
+      }
+      return f_.Read();
+    }
+
+  private:
+
+    XCDFFile& f_;
+    EventRange range_;
+    bool started_;
+};
+
+/*
+ *  Split the events in a list of files into nParts contiguous parts of
+ *  roughly equal size.  Files are split on block boundaries using the
+ *  block table.  Files without a block table cannot be split and are
+ *  assigned whole, counting as a file of average size.  Parts are in
+ *  input order, so concatenating them gives back the input.
+ */
+inline std::vector<EventRangeList>
+PartitionEvents(const std::vector<std::string>& infiles, unsigned nParts) {
+
+  // Collect the splittable units: blocks, or whole files
+  std::vector<EventRange> units;
+  std::vector<uint64_t> weights;
+  std::vector<bool> unsplittable;
+  uint64_t splitEvents = 0;
+  unsigned nSplitFiles = 0;
+
+  XCDFFile f;
+  std::vector<uint64_t> starts;
+  for (std::vector<std::string>::const_iterator it = infiles.begin();
+                                                it != infiles.end(); ++it) {
+
+    f.Open(*it, "r");
+    if (f.GetBlockStartEvents(starts) && starts.size() > 0) {
+      uint64_t total = f.GetEventCount();
+      for (unsigned i = 0; i < starts.size(); ++i) {
+        uint64_t end = i + 1 < starts.size() ? starts[i + 1] : total;
+        units.push_back(EventRange(*it, starts[i], end));
+        weights.push_back(end - starts[i]);
+        unsplittable.push_back(false);
+      }
+      splitEvents += total;
+      ++nSplitFiles;
+    } else {
+      units.push_back(EventRange(*it, 0,
+                                 std::numeric_limits<uint64_t>::max()));
+      weights.push_back(0);
+      unsplittable.push_back(true);
+    }
+    f.Close();
+  }
+
+  uint64_t averageEvents = nSplitFiles > 0 ? splitEvents / nSplitFiles : 1;
+  uint64_t totalWeight = 0;
+  for (unsigned i = 0; i < units.size(); ++i) {
+    if (unsplittable[i]) {
+      weights[i] = averageEvents > 0 ? averageEvents : 1;
+    }
+    totalWeight += weights[i];
+  }
+
+  // Assign each unit to a part by the position of its midpoint, merging
+  // neighboring units of the same file into one range
+  if (nParts == 0) {
+    nParts = 1;
+  }
+  std::vector<EventRangeList> parts(nParts);
+  uint64_t position = 0;
+  for (unsigned i = 0; i < units.size(); ++i) {
+
+    unsigned part = 0;
+    if (totalWeight > 0) {
+      double mid = position + 0.5 * weights[i];
+      part = static_cast<unsigned>(mid * nParts / totalWeight);
+      if (part >= nParts) {
+        part = nParts - 1;
+      }
+    }
+    position += weights[i];
+
+    EventRangeList& list = parts[part];
+    if (!unsplittable[i] && list.size() > 0 &&
+        list.back().fileName_ == units[i].fileName_ &&
+        list.back().end_ == units[i].start_) {
+      list.back().end_ = units[i].end_;
+    } else {
+      list.push_back(units[i]);
+    }
+  }
+
+  return parts;
+}
+
+#endif // XCDF_UTILITY_EVENT_RANGE_H_INCLUDED
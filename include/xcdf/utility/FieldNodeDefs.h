@@ -79,6 +79,23 @@ class FieldNode : public Node<T> {
       return 0;
     }
 
+    // The field global range.  Only meaningful once the file globals
+    // are loaded with XCDFFile::LoadGlobals().
+    bool GetRange(double& min, double& max) const {
+      if (!field_.GlobalsSet()) {
+        return false;
+      }
+      min = field_.GetGlobalMin();
+      max = field_.GetGlobalMax();
+      return !(min > max);
+    }
+
+    void GetInputs(std::set<std::string>& inputs) const {
+      inputs.insert(field_.GetName());
+    }
+
+    bool IsVariable() const {return true;}
+
   private:
 
     ConstXCDFField<T> field_;
@@ -109,6 +126,16 @@ class AliasNode : public Node<T> {
       return alias_.GetHeadNode().GetParentIndex(index);
     }
 
+    bool GetRange(double& min, double& max) const {
+      return alias_.GetHeadNode().GetRange(min, max);
+    }
+
+    void GetInputs(std::set<std::string>& inputs) const {
+      alias_.GetHeadNode().GetInputs(inputs);
+    }
+
+    bool IsVariable() const {return true;}
+
   private:
 
     XCDFFieldAlias<T> alias_;
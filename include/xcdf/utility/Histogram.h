@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define XCDF_UTILITY_HISTOGRAM_H_INCLUDED
 
 #include <xcdf/XCDFDefs.h>
+#include <xcdf/config.h>
 #include <xcdf/utility/NumericalExpression.h>
 
 #include <vector>
@@ -38,6 +39,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <limits>
 #include <iostream>
 #include <iomanip>
+#include <cstdio>
+
+#ifdef XCDF_HAVE_SC_PHYS_PAGES
+#include <unistd.h>
+#endif
 
 class Histogram1D {
 
@@ -100,7 +106,26 @@ class Histogram1D {
       ++nEntries_;
     }
 
-    friend class Histogram2D;
+    // Add the contents of a histogram with identical binning
+    void Add(const Histogram1D& h) {
+
+      if (h.GetNBins() != GetNBins() ||
+          h.min_ != min_ || h.max_ != max_) {
+        XCDFFatal("Cannot add histograms with different binning");
+      }
+
+      for (unsigned i = 0; i < data_.size(); ++i) {
+        data_[i] += h.data_[i];
+        dataW2_[i] += h.dataW2_[i];
+      }
+      underflow_ += h.underflow_;
+      underflowW2_ += h.underflowW2_;
+      overflow_ += h.overflow_;
+      overflowW2_ += h.overflowW2_;
+      nEntries_ += h.nEntries_;
+    }
+
+    template <typename Storage> friend class BasicHistogram2D;
 
   private:
 
@@ -118,21 +143,259 @@ class Histogram1D {
     uint64_t nEntries_;
 };
 
-class Histogram2D {
+/*
+ *  Storage backends for the bins of a 2D histogram.  Each keeps the sum
+ *  of weights and the sum of squared weights of each bin, as well as
+ *  the number of entries.
+ */
+
+// Separate arrays of weights and squared weights
+class DenseHistogramStorage {
+
+  public:
+
+    DenseHistogramStorage(unsigned nbins) : data_(nbins, 0.),
+                                            dataW2_(nbins, 0.),
+                                            nEntries_(0) { }
+
+    unsigned GetNBins() const {return data_.size();}
+    uint64_t GetNEntries() const {return nEntries_;}
+    double GetData(unsigned i) const {return data_[i];}
+    double GetW2Sum(unsigned i) const {return dataW2_[i];}
+
+    void Fill(unsigned i, double weight) {
+      data_[i] += weight;
+      dataW2_[i] += weight*weight;
+    }
+
+    void AddEntry() {++nEntries_;}
+
+    void Add(const DenseHistogramStorage& s) {
+      for (unsigned i = 0; i < data_.size(); ++i) {
+        data_[i] += s.data_[i];
+        dataW2_[i] += s.dataW2_[i];
+      }
+      nEntries_ += s.nEntries_;
+    }
+
+  private:
+
+    std::vector<double> data_;
+    std::vector<double> dataW2_;
+    uint64_t nEntries_;
+};
+
+// Weights and squared weights interleaved, so a fill touches one cache line
+class InterleavedHistogramStorage {
+
+  public:
+
+    InterleavedHistogramStorage(unsigned nbins) : data_(2*nbins, 0.),
+                                                  nEntries_(0) { }
+
+    unsigned GetNBins() const {return data_.size() / 2;}
+    uint64_t GetNEntries() const {return nEntries_;}
+    double GetData(unsigned i) const {return data_[2*i];}
+    double GetW2Sum(unsigned i) const {return data_[2*i + 1];}
+
+    void Fill(unsigned i, double weight) {
+      double* bin = &data_[2*i];
+      bin[0] += weight;
+      bin[1] += weight*weight;
+    }
+
+    void AddEntry() {++nEntries_;}
+
+    void Add(const InterleavedHistogramStorage& s) {
+      for (unsigned i = 0; i < data_.size(); ++i) {
+        data_[i] += s.data_[i];
+      }
+      nEntries_ += s.nEntries_;
+    }
+
+  private:
+
+    std::vector<double> data_;
+    uint64_t nEntries_;
+};
+
+// Open-addressing hash table holding only the bins that have been filled
+class SparseHistogramStorage {
+
+  public:
+
+    SparseHistogramStorage(unsigned nbins) : nbins_(nbins),
+                                             nFilled_(0),
+                                             nEntries_(0) {
+      bins_.resize(64);
+    }
+
+    unsigned GetNBins() const {return nbins_;}
+    uint64_t GetNEntries() const {return nEntries_;}
+    unsigned GetNFilledBins() const {return nFilled_;}
+
+    double GetData(unsigned i) const {
+      const Bin* bin = Find(i);
+      return bin ? bin->data_ : 0.;
+    }
+
+    double GetW2Sum(unsigned i) const {
+      const Bin* bin = Find(i);
+      return bin ? bin->dataW2_ : 0.;
+    }
+
+    void Fill(unsigned i, double weight) {
+      Bin& bin = Insert(i);
+      bin.data_ += weight;
+      bin.dataW2_ += weight*weight;
+    }
+
+    void AddEntry() {++nEntries_;}
+
+    void Add(const SparseHistogramStorage& s) {
+      for (std::vector<Bin>::const_iterator it = s.bins_.begin();
+                                            it != s.bins_.end(); ++it) {
+        if (it->index_ != EMPTY) {
+          Bin& bin = Insert(it->index_);
+          bin.data_ += it->data_;
+          bin.dataW2_ += it->dataW2_;
+        }
+      }
+      nEntries_ += s.nEntries_;
+    }
+
+  private:
+
+    static const uint32_t EMPTY = 0xFFFFFFFF;
+
+    struct Bin {
+      Bin() : index_(EMPTY), data_(0.), dataW2_(0.) { }
+      uint32_t index_;
+      double data_;
+      double dataW2_;
+    };
+
+    std::vector<Bin> bins_;
+    unsigned nbins_;
+    unsigned nFilled_;
+    uint64_t nEntries_;
+
+    // Table size is a power of two; use a multiplicative hash
+    size_t Slot(uint32_t i) const {
+      return (i * 2654435761u) & (bins_.size() - 1);
+    }
+
+    const Bin* Find(uint32_t i) const {
+      for (size_t s = Slot(i); ; s = (s + 1) & (bins_.size() - 1)) {
+        if (bins_[s].index_ == i) {
+          return &bins_[s];
+        }
+        if (bins_[s].index_ == EMPTY) {
+          return NULL;
+        }
+      }
+    }
+
+    Bin& Insert(uint32_t i) {
+      for (size_t s = Slot(i); ; s = (s + 1) & (bins_.size() - 1)) {
+        if (bins_[s].index_ == i) {
+          return bins_[s];
+        }
+        if (bins_[s].index_ == EMPTY) {
+          // Keep the load factor below 1/2
+          if (2 * (nFilled_ + 1) > bins_.size()) {
+            Grow();
+            return Insert(i);
+          }
+          bins_[s].index_ = i;
+          ++nFilled_;
+          return bins_[s];
+        }
+      }
+    }
+
+    void Grow() {
+      std::vector<Bin> old(2 * bins_.size());
+      old.swap(bins_);
+      for (std::vector<Bin>::const_iterator it = old.begin();
+                                            it != old.end(); ++it) {
+        if (it->index_ != EMPTY) {
+          size_t s = Slot(it->index_);
+          while (bins_[s].index_ != EMPTY) {
+            s = (s + 1) & (bins_.size() - 1);
+          }
+          bins_[s] = *it;
+        }
+      }
+    }
+};
+
+// Interleaved bins updated with atomic compare-and-swap, so one
+// histogram can be filled from many threads at once
+class AtomicHistogramStorage {
+
+  public:
+
+    AtomicHistogramStorage(unsigned nbins) : data_(2*nbins, 0),
+                                             nEntries_(0) { }
+
+    unsigned GetNBins() const {return data_.size() / 2;}
+    uint64_t GetNEntries() const {return nEntries_;}
+    double GetData(unsigned i) const {
+      return XCDFSafeTypePun<uint64_t, double>(data_[2*i]);
+    }
+    double GetW2Sum(unsigned i) const {
+      return XCDFSafeTypePun<uint64_t, double>(data_[2*i + 1]);
+    }
+
+    void Fill(unsigned i, double weight) {
+      AtomicAdd(&data_[2*i], weight);
+      AtomicAdd(&data_[2*i + 1], weight*weight);
+    }
+
+    void AddEntry() {__sync_fetch_and_add(&nEntries_, 1);}
+
+    void Add(const AtomicHistogramStorage& s) {
+      for (unsigned i = 0; i < data_.size(); ++i) {
+        AtomicAdd(&data_[i], XCDFSafeTypePun<uint64_t, double>(s.data_[i]));
+      }
+      __sync_fetch_and_add(&nEntries_, s.nEntries_);
+    }
+
+  private:
+
+    // Doubles are stored as their bit patterns for compare-and-swap
+    std::vector<uint64_t> data_;
+    uint64_t nEntries_;
+
+    static void AtomicAdd(uint64_t* target, double value) {
+      uint64_t expected = *static_cast<volatile uint64_t*>(target);
+      for (;;) {
+        double sum = XCDFSafeTypePun<uint64_t, double>(expected) + value;
+        uint64_t current = __sync_val_compare_and_swap(target, expected,
+                             XCDFSafeTypePun<double, uint64_t>(sum));
+        if (current == expected) {
+          return;
+        }
+        expected = current;
+      }
+    }
+};
+
+template <typename Storage>
+class BasicHistogram2D {
 
   public:
 
-    Histogram2D(unsigned nbinsX, double minX, double maxX,
-                unsigned nbinsY, double minY, double maxY) :
-                                              data_(nbinsX*nbinsY, 0.),
-                                              dataW2_(nbinsX*nbinsY, 0.),
+    BasicHistogram2D(unsigned nbinsX, double minX, double maxX,
+                     unsigned nbinsY, double minY, double maxY) :
+                                              storage_(nbinsX*nbinsY),
                                               nbinsX_(nbinsX),
                                               nbinsY_(nbinsY),
                                               xMin_(minX),
                                               xMax_(maxX),
                                               yMin_(minY),
-                                              yMax_(maxY),
-                                              nEntries_(0) {
+                                              yMax_(maxY) {
 
       if (nbinsX == 0 || nbinsY == 0) {
         XCDFFatal("Histogram must have >0 bins");
@@ -145,14 +408,15 @@ class Histogram2D {
       yRinv_ = 1. / (maxY - minY);
     }
 
-    unsigned GetNBins() const {return data_.size();}
+    unsigned GetNBins() const {return storage_.GetNBins();}
     unsigned GetNBinsX() const {return nbinsX_;}
     unsigned GetNBinsY() const {return nbinsY_;}
     double GetXMinimum() const {return xMin_;}
     double GetXMaximum() const {return xMax_;}
     double GetYMinimum() const {return yMin_;}
     double GetYMaximum() const {return yMax_;}
-    uint64_t GetNEntries() const {return nEntries_;}
+    uint64_t GetNEntries() const {return storage_.GetNEntries();}
+    const Storage& GetStorage() const {return storage_;}
     std::pair<double, double> GetBinMinimum(unsigned i) const {
       return GetBinMinimum(i % nbinsX_, i / nbinsX_);
     }
@@ -169,14 +433,14 @@ class Histogram2D {
       double my = yMin_ + (j+0.5) / (yRinv_ * GetNBinsY());
       return std::pair<double, double>(mx, my);
     }
-    double GetData(unsigned i) const {return data_[i];}
-    double GetW2Sum(unsigned i) const {return dataW2_[i];}
+    double GetData(unsigned i) const {return storage_.GetData(i);}
+    double GetW2Sum(unsigned i) const {return storage_.GetW2Sum(i);}
     double operator[](unsigned i) const {return GetData(i);}
     double GetData(unsigned i, unsigned j) const {
-      return data_[j*nbinsX_ + i];
+      return storage_.GetData(j*nbinsX_ + i);
     }
     double GetW2Sum(unsigned i, unsigned j) const {
-      return dataW2_[j*nbinsX_ + i];
+      return storage_.GetW2Sum(j*nbinsX_ + i);
     }
 
     void Fill(double xValue, double yValue, double weight=1.) {
@@ -192,10 +456,20 @@ class Histogram2D {
         int64_t binnoX = static_cast<int64_t>(xdiff);
         int64_t binnoY = static_cast<int64_t>(ydiff);
         int64_t bb = binnoY * nbinsX_ + binnoX;
-        data_[bb] += weight;
-        dataW2_[bb] += weight*weight;
+        storage_.Fill(bb, weight);
       }
-      ++nEntries_;
+      storage_.AddEntry();
+    }
+
+    // Add the contents of a histogram with identical binning
+    void Add(const BasicHistogram2D& h) {
+
+      if (h.nbinsX_ != nbinsX_ || h.nbinsY_ != nbinsY_ ||
+          h.xMin_ != xMin_ || h.xMax_ != xMax_ ||
+          h.yMin_ != yMin_ || h.yMax_ != yMax_) {
+        XCDFFatal("Cannot add histograms with different binning");
+      }
+      storage_.Add(h.storage_);
     }
 
     Histogram1D ProfileX(unsigned i) {
@@ -207,8 +481,8 @@ class Histogram2D {
       for (unsigned i = 0; i < yBins.size(); ++i) {
         for (unsigned j = 0; j < nbinsX_; ++j) {
           unsigned ibn = yBins[i]*nbinsX_ + j;
-          out.data_[j] += data_[ibn];
-          out.dataW2_[j] += dataW2_[ibn];
+          out.data_[j] += storage_.GetData(ibn);
+          out.dataW2_[j] += storage_.GetW2Sum(ibn);
         }
       }
       return out;
@@ -223,8 +497,8 @@ class Histogram2D {
       for (unsigned i = 0; i < xBins.size(); ++i) {
         for (unsigned j = 0; j < nbinsY_; ++j) {
           unsigned ibn = j*nbinsX_ + xBins[i];
-          out.data_[j] += data_[ibn];
-          out.dataW2_[j] += dataW2_[ibn];
+          out.data_[j] += storage_.GetData(ibn);
+          out.dataW2_[j] += storage_.GetW2Sum(ibn);
         }
       }
       return out;
@@ -232,8 +506,7 @@ class Histogram2D {
 
   private:
 
-    std::vector<double> data_;
-    std::vector<double> dataW2_;
+    Storage storage_;
     unsigned nbinsX_;
     unsigned nbinsY_;
 
@@ -243,10 +516,10 @@ class Histogram2D {
     double yMax_;
     double xRinv_;
     double yRinv_;
-
-    uint64_t nEntries_;
 };
 
+typedef BasicHistogram2D<DenseHistogramStorage> Histogram2D;
+
 class RangeTest {
 
   public:
@@ -262,6 +535,16 @@ class RangeTest {
       }
     }
 
+    // Extend the range to include the range of another test
+    void Add(const RangeTest& rt) {
+      if (rt.min_ < min_) {
+        min_ = rt.min_;
+      }
+      if (rt.max_ > max_) {
+        max_ = rt.max_;
+      }
+    }
+
     // Use range [0,1] if no entries are made
     double GetMax() const {
       if (min_ > max_) {
@@ -284,6 +567,232 @@ class RangeTest {
     double min_;
 };
 
+/*
+ *  Buffer of fixed-width fill entries, e.g. (x, w) or (x, y, w).  Entries
+ *  are held in memory until they exceed a memory limit, and are then
+ *  spilled to an anonymous temporary file, so the buffer only touches the
+ *  disk when memory runs short.  All buffers in the process share one
+ *  memory budget, an eighth of the physical memory (1 GB if it is unknown)
+ *  by default, which SetMemoryBudget() can change.  Each buffer is limited
+ *  to an equal share of the budget, and its capacity is reserved up to
+ *  that share so vector growth cannot overshoot it.  Entries are read back
+ *  in chunks of a fixed number of entries.
+ */
+class FillBuffer {
+
+  public:
+
+    FillBuffer(unsigned width,
+               unsigned chunkEntries = 1 << 19) :
+                                    width_(width),
+                                    chunkSize_(width * chunkEntries),
+                                    spill_(NULL),
+                                    nSpilledValues_(0),
+                                    nReadValues_(0),
+                                    readingMemory_(false) {
+      __sync_fetch_and_add(&NBuffers(), 1);
+    }
+
+    ~FillBuffer() {
+      __sync_fetch_and_sub(&NBuffers(), 1);
+      if (spill_) {
+        fclose(spill_);
+      }
+    }
+
+    unsigned GetWidth() const {return width_;}
+
+    /// Set the number of bytes held in memory by all buffers together
+    static void SetMemoryBudget(uint64_t bytes) {MemoryBudget() = bytes;}
+    static uint64_t GetMemoryBudget() {return MemoryBudget();}
+
+    /// Number of bytes this buffer may hold in memory before spilling
+    uint64_t GetMemoryLimit() const {
+      uint64_t nBuffers = NBuffers();
+      return nBuffers > 0 ? MemoryBudget() / nBuffers : MemoryBudget();
+    }
+
+    void Push(const double* entry) {
+      if (data_.size() + width_ > data_.capacity()) {
+        Reserve();
+      }
+      data_.insert(data_.end(), entry, entry + width_);
+    }
+
+    // Iterate through the buffer one chunk at a time.  Returns false
+    // after the last chunk and starts again from the beginning on the
+    // next call.
+    bool NextChunk(const double*& begin, const double*& end) {
+
+      if (nReadValues_ < nSpilledValues_) {
+        if (nReadValues_ == 0) {
+          fseek(spill_, 0, SEEK_SET);
+        }
+        size_t n = nSpilledValues_ - nReadValues_ < chunkSize_ ?
+                       nSpilledValues_ - nReadValues_ : chunkSize_;
+        readBuffer_.resize(n);
+        if (fread(&readBuffer_[0], sizeof(double), n, spill_) != n) {
+          XCDFFatal("Unable to read histogram fill buffer");
+        }
+        nReadValues_ += n;
+        begin = &readBuffer_[0];
+        end = begin + n;
+        return true;
+      }
+
+      if (!readingMemory_ && data_.size() > 0) {
+        readingMemory_ = true;
+        begin = &data_[0];
+        end = begin + data_.size();
+        return true;
+      }
+
+      nReadValues_ = 0;
+      readingMemory_ = false;
+      return false;
+    }
+
+  private:
+
+    unsigned width_;
+    size_t chunkSize_;
+    std::vector<double> data_;
+    std::vector<double> readBuffer_;
+    FILE* spill_;
+    uint64_t nSpilledValues_;
+    uint64_t nReadValues_;
+    bool readingMemory_;
+
+    static uint64_t& MemoryBudget() {
+      static uint64_t budget = GetPhysicalMemory() / 8;
+      return budget;
+    }
+
+    static uint64_t& NBuffers() {
+      static uint64_t nBuffers = 0;
+      return nBuffers;
+    }
+
+    static uint64_t GetPhysicalMemory() {
+#ifdef XCDF_HAVE_SC_PHYS_PAGES
+      long pages = sysconf(_SC_PHYS_PAGES);
+      long pageSize = sysconf(_SC_PAGESIZE);
+      if (pages > 0 && pageSize > 0) {
+        return static_cast<uint64_t>(pages) * pageSize;
+      }
+#endif
+      return 8ULL << 30;
+    }
+
+    // Make room for at least one more entry without exceeding the
+    // memory limit, spilling the entries in memory if it is reached
+    void Reserve() {
+
+      size_t limit = GetMemoryLimit() / sizeof(double) / width_ * width_;
+      if (limit < width_) {
+        limit = width_;
+      }
+
+      if (data_.size() + width_ > limit) {
+        Spill();
+        if (data_.capacity() <= limit && data_.capacity() >= width_) {
+          return;
+        }
+        std::vector<double>().swap(data_);
+      }
+
+      size_t capacity = 2 * data_.capacity();
+      if (capacity < 1024 * width_) {
+        capacity = 1024 * width_;
+      }
+      if (capacity > limit) {
+        capacity = limit;
+      }
+      data_.reserve(capacity);
+    }
+
+    void Spill() {
+
+      if (!spill_) {
+        spill_ = tmpfile();
+        if (!spill_) {
+          XCDFFatal("Unable to create temporary histogram fill buffer");
+        }
+      }
+
+      fseek(spill_, 0, SEEK_END);
+      if (fwrite(&data_[0], sizeof(double),
+                 data_.size(), spill_) != data_.size()) {
+        XCDFFatal("Unable to write histogram fill buffer");
+      }
+      nSpilledValues_ += data_.size();
+      data_.clear();
+    }
+
+    // Disallow copy: the spill file is owned by the buffer
+    FillBuffer(const FillBuffer& buffer);
+    FillBuffer& operator=(const FillBuffer& buffer);
+};
+
+/*
+ *  Stand-ins for Histogram1D/Histogram2D when the histogram range is
+ *  not known in advance.  Fills are recorded while a RangeChecker
+ *  accumulates the range, and are replayed into a real histogram after.
+ */
+class BufferedHistogram1D {
+
+  public:
+
+    BufferedHistogram1D() : buffer_(2) { }
+
+    void Fill(double value, double weight=1.) {
+      double entry[2] = {value, weight};
+      buffer_.Push(entry);
+    }
+
+    template <typename Histogram>
+    void Replay(Histogram& h) {
+      const double* begin;
+      const double* end;
+      while (buffer_.NextChunk(begin, end)) {
+        for (const double* it = begin; it != end; it += 2) {
+          h.Fill(it[0], it[1]);
+        }
+      }
+    }
+
+  private:
+
+    FillBuffer buffer_;
+};
+
+class BufferedHistogram2D {
+
+  public:
+
+    BufferedHistogram2D() : buffer_(3) { }
+
+    void Fill(double xValue, double yValue, double weight=1.) {
+      double entry[3] = {xValue, yValue, weight};
+      buffer_.Push(entry);
+    }
+
+    template <typename Histogram>
+    void Replay(Histogram& h) {
+      const double* begin;
+      const double* end;
+      while (buffer_.NextChunk(begin, end)) {
+        for (const double* it = begin; it != end; it += 3) {
+          h.Fill(it[0], it[1], it[2]);
+        }
+      }
+    }
+
+  private:
+
+    FillBuffer buffer_;
+};
+
 class RangeChecker {
 
   public:
@@ -302,54 +811,86 @@ class RangeChecker {
     double GetMin(unsigned i) {return (rts_[i]).GetMin();}
 
     unsigned GetNExpressions() {return exprs_.size();}
+    const std::vector<std::string>& GetExpressions() const {return exprs_;}
 
     void Fill(XCDFFile& f) {
 
-      // First, check if all expressions are fields in the file.
-      // If so, we can just get the range directly
-      bool allFields = true;
-      for (unsigned i = 0; i < exprs_.size(); ++i) {
-        if (!f.HasField(exprs_[i])) {
-          allFields = false;
-          break;
-        }
-      }
-
-      if (allFields) {
-        for (unsigned i = 0; i < exprs_.size(); ++i) {
-          if (f.IsUnsignedIntegerField(exprs_[i])) {
-            rts_[i].Fill(f.GetUnsignedIntegerFieldRange(exprs_[i]).first);
-            rts_[i].Fill(f.GetUnsignedIntegerFieldRange(exprs_[i]).second);
-          } else if (f.IsSignedIntegerField(exprs_[i])) {
-            rts_[i].Fill(f.GetSignedIntegerFieldRange(exprs_[i]).first);
-            rts_[i].Fill(f.GetSignedIntegerFieldRange(exprs_[i]).second);
-          } else {
-            rts_[i].Fill(f.GetFloatingPointFieldRange(exprs_[i]).first);
-            rts_[i].Fill(f.GetFloatingPointFieldRange(exprs_[i]).second);
-          }
-        }
+      // First, check if all expressions can be bounded from the
+      // field globals.  If so, we can just get the range directly
+      if (FillFromGlobals(f)) {
         return;
       }
 
-      // OK, at least one supplied expression is more than just a
-      // field name, so we have to read the file to get the range
+      // OK, at least one supplied expression can't be bounded, so
+      // we have to read the file to get the range
       std::vector<NumericalExpression<double> > nes;
       for (unsigned i = 0; i < exprs_.size(); ++i) {
         nes.push_back(NumericalExpression<double>(exprs_[i], f));
       }
 
       while (f.Read()) {
-        for (unsigned i = 0; i < exprs_.size(); ++i) {
-          unsigned max = nes[i].GetSize();
-          if (max == 1) {
-            rts_[i].Fill(nes[i].Evaluate());
+        FillEvent(nes);
+      }
+    }
+
+    // Extend the ranges to include those of a checker with the
+    // same expressions
+    void Add(const RangeChecker& rc) {
+      for (unsigned i = 0; i < rts_.size(); ++i) {
+        rts_[i].Add(rc.rts_[i]);
+      }
+    }
+
+    // Fill the range with the values of the current event, given
+    // expressions built from GetExpressions()
+    void FillEvent(const std::vector<NumericalExpression<double> >& nes) {
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        unsigned max = nes[i].GetSize();
+        if (max == 1) {
+          rts_[i].Fill(nes[i].Evaluate());
+        } else {
+          for (unsigned j = 0; j < max; ++j) {
+            rts_[i].Fill(nes[i].Evaluate(j));
+          }
+        }
+      }
+    }
+
+    // Fill the range from the field globals without reading the events.
+    // Fields use their global range directly.  Other expressions are
+    // bounded with interval arithmetic over the globals of the fields
+    // they contain, which may give a wider range than the data.
+    // Returns false (and fills nothing) if any expression can't be
+    // bounded this way.
+    bool FillFromGlobals(XCDFFile& f) {
+
+      std::vector<std::pair<double, double> > ranges;
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        if (f.HasField(exprs_[i])) {
+          if (f.IsUnsignedIntegerField(exprs_[i])) {
+            ranges.push_back(f.GetUnsignedIntegerFieldRange(exprs_[i]));
+          } else if (f.IsSignedIntegerField(exprs_[i])) {
+            ranges.push_back(f.GetSignedIntegerFieldRange(exprs_[i]));
           } else {
-            for (unsigned j = 0; j < max; ++j) {
-              rts_[i].Fill(nes[i].Evaluate(j));
-            }
+            ranges.push_back(f.GetFloatingPointFieldRange(exprs_[i]));
           }
+          continue;
+        }
+
+        f.LoadGlobals();
+        NumericalExpression<double> ne(exprs_[i], f);
+        double min, max;
+        if (!ne.GetHeadNode().GetRange(min, max)) {
+          return false;
         }
+        ranges.push_back(std::pair<double, double>(min, max));
+      }
+
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        rts_[i].Fill(ranges[i].first);
+        rts_[i].Fill(ranges[i].second);
       }
+      return true;
     }
 
   private:
@@ -369,7 +910,9 @@ std::ostream& operator<<(std::ostream& out, const Histogram1D& h) {
   return out;
 }
 
-std::ostream& operator<<(std::ostream& out, const Histogram2D& h) {
+template <typename Storage>
+std::ostream& operator<<(std::ostream& out,
+                         const BasicHistogram2D<Storage>& h) {
 
   out << std::setw(8) << "X" << " ";
   out << std::setw(8) << "Y" << " Value" << std::endl;
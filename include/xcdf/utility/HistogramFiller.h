@@ -35,9 +35,73 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *  of field and the relationships of the histogram field(s) and the
  *  weight field.  We could possibly combine the 1D and 2D cases with
  *  another policy class, but it is not clear that this would result
- *  in better code.
+ *  in better code.  Fillers are templated on the histogram type so the
+ *  same relation logic can fill either a histogram or a FillBuffer
+ *  that defers the fill until the histogram range is known.
  */
 
+/*
+ *  A filler bound to one histogram and the expressions of one open file.
+ *  Many bound fillers can be driven from a single event loop, so any
+ *  number of histograms may be filled with one pass through the data.
+ */
+class BoundFiller {
+
+  public:
+
+    virtual ~BoundFiller() { }
+    virtual void Fill() = 0;
+};
+
+typedef XCDFPtr<BoundFiller> BoundFillerPtr;
+
+template <typename Histogram, typename DynamicFiller>
+class BoundFillerImpl : public BoundFiller {
+
+  public:
+
+    BoundFillerImpl(Histogram& h,
+                    XCDFPtr<DynamicFiller> filler) : h_(h), filler_(filler) { }
+
+    void Fill() {filler_->Fill(h_);}
+
+  private:
+
+    Histogram& h_;
+    XCDFPtr<DynamicFiller> filler_;
+};
+
+/*
+ *  Accumulates the value range of the RangeChecker expressions with
+ *  each event, alongside any histograms filled in the same pass.
+ */
+class RangeFiller : public BoundFiller {
+
+  public:
+
+    RangeFiller(RangeChecker& rc, const XCDFFile& f) : rc_(rc) {
+      for (std::vector<std::string>::const_iterator
+                                  it = rc.GetExpressions().begin();
+                                  it != rc.GetExpressions().end(); ++it) {
+        nes_.push_back(NumericalExpression<double>(*it, f));
+      }
+    }
+
+    void Fill() {rc_.FillEvent(nes_);}
+
+  private:
+
+    RangeChecker& rc_;
+    std::vector<NumericalExpression<double> > nes_;
+};
+
+template <typename Histogram, typename DynamicFiller>
+BoundFillerPtr BindFiller(Histogram& h, XCDFPtr<DynamicFiller> filler) {
+  return BoundFillerPtr(
+              new BoundFillerImpl<Histogram, DynamicFiller>(h, filler));
+}
+
+template <typename Histogram>
 class DynamicFiller1D {
   public:
 
@@ -45,7 +109,7 @@ class DynamicFiller1D {
                     const NumericalExpression<double>& ne2) :
                                           ne1_(ne1), ne2_(ne2) { }
     virtual ~DynamicFiller1D() { }
-    virtual void Fill(Histogram1D& h) const = 0;
+    virtual void Fill(Histogram& h) const = 0;
 
   protected:
 
@@ -53,99 +117,124 @@ class DynamicFiller1D {
     NumericalExpression<double> ne2_;
 };
 
-class ScalarFiller1D : public DynamicFiller1D {
+template <typename Histogram>
+class ScalarFiller1D : public DynamicFiller1D<Histogram> {
 
   public:
 
     ScalarFiller1D(const NumericalExpression<double>& ne1,
                    const NumericalExpression<double>& ne2) :
-                                      DynamicFiller1D(ne1, ne2) { }
-    void Fill(Histogram1D& h) const {
+                                      DynamicFiller1D<Histogram>(ne1, ne2) { }
+    void Fill(Histogram& h) const {
       h.Fill(ne1_.Evaluate(), ne2_.Evaluate());
     }
+
+  private:
+
+    using DynamicFiller1D<Histogram>::ne1_;
+    using DynamicFiller1D<Histogram>::ne2_;
 };
 
-template <typename FillPolicy>
-class VectorFiller1D : public DynamicFiller1D {
+template <typename Histogram, typename FillPolicy>
+class VectorFiller1D : public DynamicFiller1D<Histogram> {
 
   public:
 
     VectorFiller1D(const NumericalExpression<double>& ne1,
                    const NumericalExpression<double>& ne2) :
-                                      DynamicFiller1D(ne1, ne2) { }
-    void Fill(Histogram1D& h) const {
+                                      DynamicFiller1D<Histogram>(ne1, ne2) { }
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         FillPolicy::Fill(h, ne1_.Evaluate(i), ne2_.Evaluate());
       }
     }
+
+  private:
+
+    using DynamicFiller1D<Histogram>::ne1_;
+    using DynamicFiller1D<Histogram>::ne2_;
 };
 
-template <typename FillPolicy>
-class ParentFiller1D : public DynamicFiller1D {
+template <typename Histogram, typename FillPolicy>
+class ParentFiller1D : public DynamicFiller1D<Histogram> {
 
   public:
 
     ParentFiller1D(const NumericalExpression<double>& ne1,
                    const NumericalExpression<double>& ne2) :
-                                      DynamicFiller1D(ne1, ne2) { }
-    void Fill(Histogram1D& h) const {
+                                      DynamicFiller1D<Histogram>(ne1, ne2) { }
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         FillPolicy::Fill(h, ne1_.Evaluate(i),
                          ne2_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)));
       }
     }
+
+  private:
+
+    using DynamicFiller1D<Histogram>::ne1_;
+    using DynamicFiller1D<Histogram>::ne2_;
 };
 
-class Vector12Filler1D : public DynamicFiller1D {
+template <typename Histogram>
+class Vector12Filler1D : public DynamicFiller1D<Histogram> {
 
   public:
 
     Vector12Filler1D(const NumericalExpression<double>& ne1,
                      const NumericalExpression<double>& ne2) :
-                                      DynamicFiller1D(ne1, ne2) { }
-    void Fill(Histogram1D& h) const {
+                                      DynamicFiller1D<Histogram>(ne1, ne2) { }
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         h.Fill(ne1_.Evaluate(i), ne2_.Evaluate(i));
       }
     }
-};
 
-typedef XCDFPtr<DynamicFiller1D> DynamicFiller1DPtr;
+  private:
+
+    using DynamicFiller1D<Histogram>::ne1_;
+    using DynamicFiller1D<Histogram>::ne2_;
+};
 
 struct FillXY {
-  static void Fill(Histogram1D& h, double x, double y) {h.Fill(x, y);}
+  template <typename Histogram>
+  static void Fill(Histogram& h, double x, double y) {h.Fill(x, y);}
 };
 
 struct FillYX {
-  static void Fill(Histogram1D& h, double y, double x) {h.Fill(x, y);}
+  template <typename Histogram>
+  static void Fill(Histogram& h, double y, double x) {h.Fill(x, y);}
 };
 
-DynamicFiller1DPtr GetFiller(NodeRelationType type,
-                             const NumericalExpression<double>& ne1,
-                             const NumericalExpression<double>& ne2) {
+template <typename Histogram>
+XCDFPtr<DynamicFiller1D<Histogram> >
+GetFiller(NodeRelationType type,
+          const NumericalExpression<double>& ne1,
+          const NumericalExpression<double>& ne2) {
 
+  typedef XCDFPtr<DynamicFiller1D<Histogram> > FillerPtr;
   switch (type) {
 
     default:
     case SCALAR:
-      return DynamicFiller1DPtr(new ScalarFiller1D(ne1, ne2));
+      return FillerPtr(new ScalarFiller1D<Histogram>(ne1, ne2));
 
     // Second expression is vector.  Swap the order and swap back when filling
     case SCALAR_FIRST:
-      return DynamicFiller1DPtr(new VectorFiller1D<FillYX>(ne2, ne1));
+      return FillerPtr(new VectorFiller1D<Histogram, FillYX>(ne2, ne1));
 
     case SCALAR_SECOND:
-      return DynamicFiller1DPtr(new VectorFiller1D<FillXY>(ne1, ne2));
+      return FillerPtr(new VectorFiller1D<Histogram, FillXY>(ne1, ne2));
 
     case VECTOR_VECTOR:
-      return DynamicFiller1DPtr(new Vector12Filler1D(ne1, ne2));
+      return FillerPtr(new Vector12Filler1D<Histogram>(ne1, ne2));
 
     // Second expression is the larger vector.
     case PARENT_FIRST:
-      return DynamicFiller1DPtr(new ParentFiller1D<FillYX>(ne2, ne1));
+      return FillerPtr(new ParentFiller1D<Histogram, FillYX>(ne2, ne1));
 
     case PARENT_SECOND:
-      return DynamicFiller1DPtr(new ParentFiller1D<FillXY>(ne1, ne2));
+      return FillerPtr(new ParentFiller1D<Histogram, FillXY>(ne1, ne2));
   }
 }
 
@@ -156,18 +245,24 @@ class Filler1D {
     Filler1D(const std::string& xExpr,
              const std::string& wExpr) : xExpr_(xExpr), wExpr_(wExpr) { }
 
-    void Fill(Histogram1D& h, XCDFFile& f) {
+    template <typename Histogram>
+    void Fill(Histogram& h, XCDFFile& f) const {
+
+      BoundFillerPtr filler = Bind(h, f);
+      while (f.Read()) {
+        filler->Fill();
+      }
+    }
+
+    template <typename Histogram>
+    BoundFillerPtr Bind(Histogram& h, const XCDFFile& f) const {
 
       NumericalExpression<double> xne(xExpr_, f);
       NumericalExpression<double> wne(wExpr_, f);
 
       // Get the filler appropriate to the relation between the two nodes
-      DynamicFiller1DPtr filler =
-               GetFiller(xne.GetNodeRelationType(wne), xne, wne);
-
-      while (f.Read()) {
-        filler->Fill(h);
-      }
+      return BindFiller(h,
+               GetFiller<Histogram>(xne.GetNodeRelationType(wne), xne, wne));
     }
 
   private:
@@ -176,6 +271,7 @@ class Filler1D {
     std::string wExpr_;
 };
 
+template <typename Histogram>
 class DynamicFiller2D {
   public:
 
@@ -184,7 +280,7 @@ class DynamicFiller2D {
                     const NumericalExpression<double>& ne3) :
                                     ne1_(ne1), ne2_(ne2), ne3_(ne3) { }
     virtual ~DynamicFiller2D() { }
-    virtual void Fill(Histogram2D& h) const = 0;
+    virtual void Fill(Histogram& h) const = 0;
 
   protected:
 
@@ -193,303 +289,360 @@ class DynamicFiller2D {
     NumericalExpression<double> ne3_;
 };
 
-class ScalarFiller2D : public DynamicFiller2D {
+template <typename Histogram>
+class ScalarFiller2D : public DynamicFiller2D<Histogram> {
 
   public:
 
     ScalarFiller2D(const NumericalExpression<double>& ne1,
                    const NumericalExpression<double>& ne2,
                    const NumericalExpression<double>& ne3) :
-                                 DynamicFiller2D(ne1, ne2, ne3) { }
+                                 DynamicFiller2D<Histogram>(ne1, ne2, ne3) { }
 
-    void Fill(Histogram2D& h) const {
+    void Fill(Histogram& h) const {
       h.Fill(ne1_.Evaluate(), ne2_.Evaluate(), ne3_.Evaluate());
     }
+
+  private:
+
+    using DynamicFiller2D<Histogram>::ne1_;
+    using DynamicFiller2D<Histogram>::ne2_;
+    using DynamicFiller2D<Histogram>::ne3_;
 };
 
-template <typename FillPolicy>
-class VectorFiller2D : public DynamicFiller2D {
+template <typename Histogram, typename FillPolicy>
+class VectorFiller2D : public DynamicFiller2D<Histogram> {
 
   public:
 
     VectorFiller2D(const NumericalExpression<double>& ne1,
                    const NumericalExpression<double>& ne2,
                    const NumericalExpression<double>& ne3) :
-                                 DynamicFiller2D(ne1, ne2, ne3) { }
+                                 DynamicFiller2D<Histogram>(ne1, ne2, ne3) { }
 
-    void Fill(Histogram2D& h) const {
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         FillPolicy::Fill(h, ne1_.Evaluate(i),
                          ne2_.Evaluate(), ne3_.Evaluate());
       }
     }
+
+  private:
+
+    using DynamicFiller2D<Histogram>::ne1_;
+    using DynamicFiller2D<Histogram>::ne2_;
+    using DynamicFiller2D<Histogram>::ne3_;
 };
 
-template <typename FillPolicy>
-class Vector12Filler2D : public DynamicFiller2D {
+template <typename Histogram, typename FillPolicy>
+class Vector12Filler2D : public DynamicFiller2D<Histogram> {
 
   public:
 
     Vector12Filler2D(const NumericalExpression<double>& ne1,
                      const NumericalExpression<double>& ne2,
                      const NumericalExpression<double>& ne3) :
-                                 DynamicFiller2D(ne1, ne2, ne3) { }
+                                 DynamicFiller2D<Histogram>(ne1, ne2, ne3) { }
 
-    void Fill(Histogram2D& h) const {
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         FillPolicy::Fill(h, ne1_.Evaluate(i),
                          ne2_.Evaluate(i), ne3_.Evaluate());
       }
     }
+
+  private:
+
+    using DynamicFiller2D<Histogram>::ne1_;
+    using DynamicFiller2D<Histogram>::ne2_;
+    using DynamicFiller2D<Histogram>::ne3_;
 };
 
-template <typename FillPolicy>
-class Parent12Filler2D : public DynamicFiller2D {
+template <typename Histogram, typename FillPolicy>
+class Parent12Filler2D : public DynamicFiller2D<Histogram> {
 
   public:
 
     Parent12Filler2D(const NumericalExpression<double>& ne1,
                      const NumericalExpression<double>& ne2,
                      const NumericalExpression<double>& ne3) :
-                                 DynamicFiller2D(ne1, ne2, ne3) { }
+                                 DynamicFiller2D<Histogram>(ne1, ne2, ne3) { }
 
-    void Fill(Histogram2D& h) const {
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         FillPolicy::Fill(h, ne1_.Evaluate(i),
                          ne2_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)),
                          ne3_.Evaluate());
       }
     }
+
+  private:
+
+    using DynamicFiller2D<Histogram>::ne1_;
+    using DynamicFiller2D<Histogram>::ne2_;
+    using DynamicFiller2D<Histogram>::ne3_;
 };
 
-class Vector123Filler2D : public DynamicFiller2D {
+template <typename Histogram>
+class Vector123Filler2D : public DynamicFiller2D<Histogram> {
 
   public:
 
     Vector123Filler2D(const NumericalExpression<double>& ne1,
                       const NumericalExpression<double>& ne2,
                       const NumericalExpression<double>& ne3) :
-                                 DynamicFiller2D(ne1, ne2, ne3) { }
+                                 DynamicFiller2D<Histogram>(ne1, ne2, ne3) { }
 
-    void Fill(Histogram2D& h) const {
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         h.Fill(ne1_.Evaluate(i), ne2_.Evaluate(i), ne3_.Evaluate(i));
       }
     }
+
+  private:
+
+    using DynamicFiller2D<Histogram>::ne1_;
+    using DynamicFiller2D<Histogram>::ne2_;
+    using DynamicFiller2D<Histogram>::ne3_;
 };
 
-template <typename FillPolicy>
-class Parent12v3Filler2D : public DynamicFiller2D {
+template <typename Histogram, typename FillPolicy>
+class Parent12v3Filler2D : public DynamicFiller2D<Histogram> {
 
   public:
 
     Parent12v3Filler2D(const NumericalExpression<double>& ne1,
                        const NumericalExpression<double>& ne2,
                        const NumericalExpression<double>& ne3) :
-                                 DynamicFiller2D(ne1, ne2, ne3) { }
+                                 DynamicFiller2D<Histogram>(ne1, ne2, ne3) { }
 
-    void Fill(Histogram2D& h) const {
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         FillPolicy::Fill(h, ne1_.Evaluate(i),
                          ne2_.Evaluate(i),
                          ne3_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)));
       }
     }
+
+  private:
+
+    using DynamicFiller2D<Histogram>::ne1_;
+    using DynamicFiller2D<Histogram>::ne2_;
+    using DynamicFiller2D<Histogram>::ne3_;
 };
 
-template <typename FillPolicy>
-class Parent1v23Filler2D : public DynamicFiller2D {
+template <typename Histogram, typename FillPolicy>
+class Parent1v23Filler2D : public DynamicFiller2D<Histogram> {
 
   public:
 
     Parent1v23Filler2D(const NumericalExpression<double>& ne1,
                        const NumericalExpression<double>& ne2,
                        const NumericalExpression<double>& ne3) :
-                                 DynamicFiller2D(ne1, ne2, ne3) { }
+                                 DynamicFiller2D<Histogram>(ne1, ne2, ne3) { }
 
-    void Fill(Histogram2D& h) const {
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         FillPolicy::Fill(h, ne1_.Evaluate(i),
                          ne2_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)),
                          ne3_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)));
       }
     }
+
+  private:
+
+    using DynamicFiller2D<Histogram>::ne1_;
+    using DynamicFiller2D<Histogram>::ne2_;
+    using DynamicFiller2D<Histogram>::ne3_;
 };
 
-template <typename FillPolicy>
-class Parent1v2v3Filler2D : public DynamicFiller2D {
+template <typename Histogram, typename FillPolicy>
+class Parent1v2v3Filler2D : public DynamicFiller2D<Histogram> {
 
   public:
 
     Parent1v2v3Filler2D(const NumericalExpression<double>& ne1,
                         const NumericalExpression<double>& ne2,
                         const NumericalExpression<double>& ne3) :
-                                 DynamicFiller2D(ne1, ne2, ne3) { }
+                                 DynamicFiller2D<Histogram>(ne1, ne2, ne3) { }
 
-    void Fill(Histogram2D& h) const {
+    void Fill(Histogram& h) const {
       for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
         unsigned interIdx = ne1_.GetHeadNode().GetParentIndex(i);
         FillPolicy::Fill(h, ne1_.Evaluate(i), ne2_.Evaluate(interIdx),
                 ne3_.Evaluate(ne2_.GetHeadNode().GetParentIndex(interIdx)));
       }
     }
+
+  private:
+
+    using DynamicFiller2D<Histogram>::ne1_;
+    using DynamicFiller2D<Histogram>::ne2_;
+    using DynamicFiller2D<Histogram>::ne3_;
 };
 
 struct FillXYZ {
-  static void Fill(Histogram2D& h, double x, double y, double z) {
+  template <typename Histogram>
+  static void Fill(Histogram& h, double x, double y, double z) {
     h.Fill(x, y, z);
   }
 };
 
 struct FillXZY {
-  static void Fill(Histogram2D& h, double x, double z, double y) {
+  template <typename Histogram>
+  static void Fill(Histogram& h, double x, double z, double y) {
     h.Fill(x, y, z);
   }
 };
 
 struct FillYXZ {
-  static void Fill(Histogram2D& h, double y, double x, double z) {
+  template <typename Histogram>
+  static void Fill(Histogram& h, double y, double x, double z) {
     h.Fill(x, y, z);
   }
 };
 
 struct FillYZX {
-  static void Fill(Histogram2D& h, double y, double z, double x) {
+  template <typename Histogram>
+  static void Fill(Histogram& h, double y, double z, double x) {
     h.Fill(x, y, z);
   }
 };
 
 struct FillZXY {
-  static void Fill(Histogram2D& h, double z, double x, double y) {
+  template <typename Histogram>
+  static void Fill(Histogram& h, double z, double x, double y) {
     h.Fill(x, y, z);
   }
 };
 
 struct FillZYX {
-  static void Fill(Histogram2D& h, double z, double y, double x) {
+  template <typename Histogram>
+  static void Fill(Histogram& h, double z, double y, double x) {
     h.Fill(x, y, z);
   }
 };
 
-typedef XCDFPtr<DynamicFiller2D> DynamicFiller2DPtr;
-
-DynamicFiller2DPtr GetFiller(NodeRelationType type12,
-                             NodeRelationType type13,
-                             NodeRelationType type23,
-                             const NumericalExpression<double>& ne1,
-                             const NumericalExpression<double>& ne2,
-                             const NumericalExpression<double>& ne3) {
+template <typename Histogram>
+XCDFPtr<DynamicFiller2D<Histogram> >
+GetFiller(NodeRelationType type12,
+          NodeRelationType type13,
+          NodeRelationType type23,
+          const NumericalExpression<double>& ne1,
+          const NumericalExpression<double>& ne2,
+          const NumericalExpression<double>& ne3) {
 
+  typedef XCDFPtr<DynamicFiller2D<Histogram> > FillerPtr;
   switch (type12) {
 
     default:
     case SCALAR: {
       if (type13 == SCALAR) {
-        return DynamicFiller2DPtr(new ScalarFiller2D(ne1, ne2, ne3));
+        return FillerPtr(new ScalarFiller2D<Histogram>(ne1, ne2, ne3));
       } else {
         // type13 == SCALAR_FIRST
-        return DynamicFiller2DPtr(new VectorFiller2D<FillZXY>(ne3, ne1, ne2));
+        return FillerPtr(new VectorFiller2D<Histogram, FillZXY>(ne3, ne1, ne2));
       }
     }
 
     case SCALAR_FIRST: {
       if (type13 == SCALAR) {
-        return DynamicFiller2DPtr(new VectorFiller2D<FillYXZ>(ne2, ne1, ne3));
+        return FillerPtr(new VectorFiller2D<Histogram, FillYXZ>(ne2, ne1, ne3));
         // type13 == SCALAR_FIRST.  Field3 is a vector.
       } else {
         if (type23 == VECTOR_VECTOR) {
-          return DynamicFiller2DPtr(
-                          new Vector12Filler2D<FillYZX>(ne2, ne3, ne1));
+          return FillerPtr(
+              new Vector12Filler2D<Histogram, FillYZX>(ne2, ne3, ne1));
         } else if (type23 == PARENT_FIRST) {
-          return DynamicFiller2DPtr(
-                          new Parent12Filler2D<FillZYX>(ne3, ne2, ne1));
+          return FillerPtr(
+              new Parent12Filler2D<Histogram, FillZYX>(ne3, ne2, ne1));
         } else {
           // type23 == PARENT_SECOND
-          return DynamicFiller2DPtr(
-                          new Parent12Filler2D<FillYZX>(ne2, ne3, ne1));
+          return FillerPtr(
+              new Parent12Filler2D<Histogram, FillYZX>(ne2, ne3, ne1));
         }
       }
     }
 
     case SCALAR_SECOND: {
       if (type23 == SCALAR) {
-        return DynamicFiller2DPtr(new VectorFiller2D<FillXYZ>(ne1, ne2, ne3));
+        return FillerPtr(new VectorFiller2D<Histogram, FillXYZ>(ne1, ne2, ne3));
         // type23 == SCALAR_FIRST.  Field3 is a vector.
       } else {
         if (type13 == VECTOR_VECTOR) {
-          return DynamicFiller2DPtr(
-                          new Vector12Filler2D<FillXZY>(ne1, ne3, ne2));
+          return FillerPtr(
+              new Vector12Filler2D<Histogram, FillXZY>(ne1, ne3, ne2));
         } else if (type13 == PARENT_FIRST) {
-          return DynamicFiller2DPtr(
-                          new Parent12Filler2D<FillZXY>(ne3, ne1, ne2));
+          return FillerPtr(
+              new Parent12Filler2D<Histogram, FillZXY>(ne3, ne1, ne2));
         } else {
           // type13 == PARENT_SECOND
-          return DynamicFiller2DPtr(
-                          new Parent12Filler2D<FillXZY>(ne1, ne3, ne2));
+          return FillerPtr(
+              new Parent12Filler2D<Histogram, FillXZY>(ne1, ne3, ne2));
         }
       }
     }
 
     case VECTOR_VECTOR: {
       if (type23 == SCALAR_SECOND) {
-        return DynamicFiller2DPtr(
-                     new Vector12Filler2D<FillXYZ>(ne1, ne2, ne3));
+        return FillerPtr(
+                     new Vector12Filler2D<Histogram, FillXYZ>(ne1, ne2, ne3));
       } else {
         if (type23 == VECTOR_VECTOR) {
-          return DynamicFiller2DPtr(new Vector123Filler2D(ne1, ne2, ne3));
+          return FillerPtr(new Vector123Filler2D<Histogram>(ne1, ne2, ne3));
         } else if (type23 == PARENT_FIRST) {
-          return DynamicFiller2DPtr(
-                          new Parent1v23Filler2D<FillZXY>(ne3, ne1, ne2));
+          return FillerPtr(
+              new Parent1v23Filler2D<Histogram, FillZXY>(ne3, ne1, ne2));
         } else {
           // type23 == PARENT_SECOND
-          return DynamicFiller2DPtr(
-                          new Parent12v3Filler2D<FillXYZ>(ne1, ne2, ne3));
+          return FillerPtr(
+              new Parent12v3Filler2D<Histogram, FillXYZ>(ne1, ne2, ne3));
         }
       }
     }
 
     case PARENT_FIRST: {
       if (type13 == SCALAR_SECOND) {
-        return DynamicFiller2DPtr(
-                      new Parent12Filler2D<FillYXZ>(ne2, ne1, ne3));
+        return FillerPtr(
+                      new Parent12Filler2D<Histogram, FillYXZ>(ne2, ne1, ne3));
       } else {
         if (type23 == VECTOR_VECTOR) {
-          return DynamicFiller2DPtr(
-                           new Parent12v3Filler2D<FillYZX>(ne2, ne3, ne1));
+          return FillerPtr(
+              new Parent12v3Filler2D<Histogram, FillYZX>(ne2, ne3, ne1));
         } else if (type23 == PARENT_FIRST) {
           // Not supported: Calculation of type13 will fail
-          return DynamicFiller2DPtr(
-                           new Parent1v2v3Filler2D<FillZYX>(ne3, ne2, ne1));
+          return FillerPtr(
+              new Parent1v2v3Filler2D<Histogram, FillZYX>(ne3, ne2, ne1));
         } else {
           // type23 == PARENT_SECOND
           // Assume type13 is VECTOR_VECTOR.
           // type13 == PARENT_FIRST --> type23 == VECTOR_VECTOR
           // type13 == PARENT_SECOND --> calculation of type23 will fail
-          return DynamicFiller2DPtr(
-                           new Parent1v23Filler2D<FillYXZ>(ne2, ne1, ne3));
+          return FillerPtr(
+              new Parent1v23Filler2D<Histogram, FillYXZ>(ne2, ne1, ne3));
         }
       }
     }
 
     case PARENT_SECOND: {
       if (type23 == SCALAR_SECOND) {
-        return DynamicFiller2DPtr(
-                      new Parent12Filler2D<FillXYZ>(ne1, ne2, ne3));
+        return FillerPtr(
+                      new Parent12Filler2D<Histogram, FillXYZ>(ne1, ne2, ne3));
       } else {
         if (type13 == VECTOR_VECTOR) {
-          return DynamicFiller2DPtr(
-                           new Parent12v3Filler2D<FillXZY>(ne1, ne3, ne2));
+          return FillerPtr(
+              new Parent12v3Filler2D<Histogram, FillXZY>(ne1, ne3, ne2));
         } else if (type13 == PARENT_FIRST) {
           // Not supported: Calculation of type23 will fail
-          return DynamicFiller2DPtr(
-                           new Parent1v2v3Filler2D<FillZXY>(ne3, ne1, ne2));
+          return FillerPtr(
+              new Parent1v2v3Filler2D<Histogram, FillZXY>(ne3, ne1, ne2));
         } else {
           // type13 == PARENT_SECOND
           // Assume type23 is VECTOR_VECTOR.
           // type23 == PARENT_FIRST --> type13 == VECTOR_VECTOR
           // type23 == PARENT_SECOND --> calculation of type13 will fail
-          return DynamicFiller2DPtr(
-                           new Parent1v23Filler2D<FillXYZ>(ne1, ne2, ne3));
+          return FillerPtr(
+              new Parent1v23Filler2D<Histogram, FillXYZ>(ne1, ne2, ne3));
         }
       }
     }
@@ -506,7 +659,17 @@ class Filler2D {
                                          yExpr_(yExpr),
                                          wExpr_(wExpr) { }
 
-    void Fill(Histogram2D& h, XCDFFile& f) {
+    template <typename Histogram>
+    void Fill(Histogram& h, XCDFFile& f) const {
+
+      BoundFillerPtr filler = Bind(h, f);
+      while (f.Read()) {
+        filler->Fill();
+      }
+    }
+
+    template <typename Histogram>
+    BoundFillerPtr Bind(Histogram& h, const XCDFFile& f) const {
 
       NumericalExpression<double> xne(xExpr_, f);
       NumericalExpression<double> yne(yExpr_, f);
@@ -515,14 +678,11 @@ class Filler2D {
       // Check the relation between two axis nodes and the weight node
       // Important to get all 3 relations to ensure the fields can all
       // be compared.
-      DynamicFiller2DPtr filler =
-                 GetFiller(xne.GetNodeRelationType(yne),
-                           xne.GetNodeRelationType(wne),
-                           yne.GetNodeRelationType(wne), xne, yne, wne);
-
-      while (f.Read()) {
-        filler->Fill(h);
-      }
+      return BindFiller(h,
+               GetFiller<Histogram>(xne.GetNodeRelationType(yne),
+                                    xne.GetNodeRelationType(wne),
+                                    yne.GetNodeRelationType(wne),
+                                    xne, yne, wne));
     }
 
   private:
@@ -30,6 +30,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <xcdf/utility/Symbol.h>
 #include <xcdf/XCDFDefs.h>
 
+#include <set>
+#include <string>
+
 template <typename T>
 class Node : public Symbol {
 
@@ -53,6 +56,19 @@ class Node : public Symbol {
     virtual bool HasGrandparent() const {return false;}
     virtual const std::string& GetGrandparentName() const {return NO_PARENT;}
     virtual unsigned GetParentIndex(unsigned index) const {return 0;}
+
+    // Bound the values the node can take anywhere in the file from the
+    // field global ranges, without reading events.  The bound may be
+    // wider than the data.  Returns false if the node cannot be bounded.
+    virtual bool GetRange(double& min, double& max) const {return false;}
+
+    // Add the names of the fields the node reads to inputs.  Nodes that
+    // read no field, or whose range does not depend on one, add nothing.
+    virtual void GetInputs(std::set<std::string>& inputs) const { }
+
+    // True if the node is a bare field or alias, so that two such nodes
+    // with the same name always evaluate to the same value
+    virtual bool IsVariable() const {return false;}
 };
 
 template <> inline
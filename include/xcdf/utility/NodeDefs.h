@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cmath>
 #include <algorithm>
+#include <limits>
 #include <set>
 
 template <typename T>
@@ -44,6 +45,11 @@ class ConstNode : public Node<T> {
     T operator[](unsigned index) const {return datum_;}
     unsigned GetSize() const {return 1;}
 
+    bool GetRange(double& min, double& max) const {
+      min = max = datum_;
+      return true;
+    }
+
   private:
 
     T datum_;
@@ -113,6 +119,34 @@ class GetParentIndexPolicy {
     unsigned index_;
 };
 
+// Check that a range is representable in type T, i.e. that integer
+// values would not wrap around
+template <typename T>
+bool RangeFitsType(double min, double max) {
+  if (!std::numeric_limits<T>::is_integer) {
+    return true;
+  }
+  return min >= static_cast<double>(std::numeric_limits<T>::min()) &&
+         max <= static_cast<double>(std::numeric_limits<T>::max());
+}
+
+// Range of a function monotonic in each argument from its values at
+// the corners of the argument ranges
+inline bool CornerRange(double c0, double c1, double c2, double c3,
+                 double& min, double& max) {
+  if (std::isnan(c0) || std::isnan(c1) || std::isnan(c2) || std::isnan(c3)) {
+    return false;
+  }
+  min = std::min(std::min(c0, c1), std::min(c2, c3));
+  max = std::max(std::max(c0, c1), std::max(c2, c3));
+  return true;
+}
+
+// Round toward zero, as integer division does
+inline double Truncate(double x) {
+  return x < 0. ? ceil(x) : floor(x);
+}
+
 }
 
 template <typename T,
@@ -174,6 +208,61 @@ class BinaryNode : public Node<ReturnType> {
       return ApplyToLargerNode(GetParentIndexPolicy(index));
     }
 
+    bool GetRange(double& min, double& max) const {
+
+      double min1, max1, min2, max2;
+      if (!n1_.GetRange(min1, max1) || !n2_.GetRange(min2, max2)) {
+        return false;
+      }
+
+      // Don't follow integer operands that wrap on conversion
+      if (!RangeFitsType<DominantType>(min1, max1) ||
+          !RangeFitsType<DominantType>(min2, max2)) {
+        return false;
+      }
+
+      if (!static_cast<const Derived*>(this)->BoundRange(min1, max1,
+                                                         min2, max2,
+                                                         min, max)) {
+        return false;
+      }
+      return !std::isnan(min) && !std::isnan(max) &&
+             RangeFitsType<ReturnType>(min, max);
+    }
+
+    // Derived nodes that can be bounded override this
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {return false;}
+
+    void GetInputs(std::set<std::string>& inputs) const {
+      n1_.GetInputs(inputs);
+      n2_.GetInputs(inputs);
+    }
+
+  protected:
+
+    // Both operands are the same field or alias
+    bool SameOperands() const {
+      return n1_.IsVariable() && n2_.IsVariable() &&
+             n1_.GetName() == n2_.GetName();
+    }
+
+    // The operands read a common field, so their values are not
+    // independent and a bound from the two ranges may be loose
+    bool SharesInputs() const {
+      std::set<std::string> inputs1;
+      std::set<std::string> inputs2;
+      n1_.GetInputs(inputs1);
+      n2_.GetInputs(inputs2);
+      for (std::set<std::string>::const_iterator
+                        it = inputs1.begin(); it != inputs1.end(); ++it) {
+        if (inputs2.count(*it) > 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
   private:
 
     Node<T>& n1_;
@@ -225,6 +314,46 @@ class UnaryNode : public Node<ReturnType> {
       return node_.GetParentIndex(index);
     }
 
+    bool GetRange(double& min, double& max) const {
+
+      if (!node_.GetRange(min, max) || !RangeFitsType<T>(min, max)) {
+        return false;
+      }
+      if (!static_cast<const Derived*>(this)->BoundRange(min, max)) {
+        return false;
+      }
+      return !std::isnan(min) && !std::isnan(max) &&
+             RangeFitsType<ReturnType>(min, max);
+    }
+
+    // Derived nodes that can be bounded override this, mapping the
+    // range of the operand onto the range of the result
+    bool BoundRange(double& min, double& max) const {return false;}
+
+    void GetInputs(std::set<std::string>& inputs) const {
+      node_.GetInputs(inputs);
+    }
+
+  protected:
+
+    // Map the range through a non-decreasing function
+    bool Increasing(double& min, double& max) const {
+      const Derived* d = static_cast<const Derived*>(this);
+      double newMin = d->Evaluate(static_cast<T>(min));
+      max = d->Evaluate(static_cast<T>(max));
+      min = newMin;
+      return true;
+    }
+
+    // Map the range through a non-increasing function
+    bool Decreasing(double& min, double& max) const {
+      const Derived* d = static_cast<const Derived*>(this);
+      double newMin = d->Evaluate(static_cast<T>(max));
+      max = d->Evaluate(static_cast<T>(min));
+      min = newMin;
+      return true;
+    }
+
   private:
 
     Node<T>& node_;
@@ -245,6 +374,13 @@ class AdditionNode : public BinaryNode<T, U, DominantType, DominantType,
                   AdditionNode<T, U, DominantType> >(n1, n2) { }
 
     DominantType Evaluate(DominantType a, DominantType b) const {return a + b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = min1 + min2;
+      max = max1 + max2;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -259,6 +395,13 @@ class SubtractionNode :
                       SubtractionNode<T, U, DominantType> >(n1, n2) { }
 
     DominantType Evaluate(DominantType a, DominantType b) const {return a - b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = min1 - max2;
+      max = max1 - min2;
+      return true;
+    }
 };
 
 
@@ -274,6 +417,32 @@ class MultiplicationNode :
                       MultiplicationNode<T, U, DominantType> >(n1, n2) { }
 
     DominantType Evaluate(DominantType a, DominantType b) const {return a * b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+
+      // x*x: the square of the range, which is non-negative
+      if (this->SameOperands()) {
+        if (min1 >= 0.) {
+          min = min1 * min1;
+          max = max1 * max1;
+        } else if (max1 <= 0.) {
+          min = max1 * max1;
+          max = min1 * min1;
+        } else {
+          min = 0.;
+          max = std::max(min1 * min1, max1 * max1);
+        }
+        return true;
+      }
+
+      // Correlated operands, e.g. x*(x+1), can't be bounded tightly
+      if (this->SharesInputs()) {
+        return false;
+      }
+      return CornerRange(min1 * min2, min1 * max2,
+                         max1 * min2, max1 * max2, min, max);
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -288,6 +457,24 @@ class DivisionNode :
                          DivisionNode<T, U, DominantType> >(n1, n2) { }
 
     DominantType Evaluate(DominantType a, DominantType b) const {return a / b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+
+      // Unbounded if the divisor can be zero
+      if (!(min2 > 0. || max2 < 0.)) {
+        return false;
+      }
+      if (!CornerRange(min1 / min2, min1 / max2,
+                       max1 / min2, max1 / max2, min, max)) {
+        return false;
+      }
+      if (std::numeric_limits<DominantType>::is_integer) {
+        min = Truncate(min);
+        max = Truncate(max);
+      }
+      return true;
+    }
 };
 
 template <typename T, typename U>
@@ -301,6 +488,16 @@ class ModulusNode :
                         uint64_t, ModulusNode<T, U> >(n1, n2) { }
 
     uint64_t Evaluate(uint64_t a, uint64_t b) const {return a % b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      if (min2 < 1.) {
+        return false;
+      }
+      min = 0.;
+      max = std::min(max1, max2 - 1.);
+      return true;
+    }
 };
 
 template <typename T, typename U>
@@ -312,6 +509,17 @@ class PowerNode : public BinaryNode<T, U, double, double, PowerNode<T, U> > {
            BinaryNode<T, U, double, double, PowerNode<T, U> >(n1, n2) { }
 
     double Evaluate(double a, double b) const {return pow(a, b);}
+
+    // pow() is monotonic in each argument for non-negative bases, as
+    // long as the base can only be zero for positive exponents
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      if (!(min1 > 0. || (min1 == 0. && min2 > 0.))) {
+        return false;
+      }
+      return CornerRange(pow(min1, min2), pow(min1, max2),
+                         pow(max1, min2), pow(max1, max2), min, max);
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -326,6 +534,13 @@ class EqualityNode :
                     EqualityNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a == b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -340,6 +555,13 @@ class InequalityNode :
                       InequalityNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a != b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -354,6 +576,13 @@ class GreaterThanNode :
                          GreaterThanNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a > b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -368,6 +597,13 @@ class LessThanNode :
                        LessThanNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a < b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -382,6 +618,13 @@ class GreaterThanEqualNode :
                    GreaterThanEqualNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a >= b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -396,6 +639,13 @@ class LessThanEqualNode :
                        LessThanEqualNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a <= b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -410,6 +660,13 @@ class LogicalANDNode :
                          LogicalANDNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a && b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -424,6 +681,13 @@ class LogicalORNode :
                          LogicalORNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a || b;}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T, typename U, typename DominantType>
@@ -497,6 +761,12 @@ class LogicalNOTNode : public UnaryNode<T, uint64_t, LogicalNOTNode<T> > {
   LogicalNOTNode(Node<T>& n1) :
               UnaryNode<T, uint64_t, LogicalNOTNode<T> >(n1) { }
   uint64_t Evaluate(T a) const {return !a;}
+
+  bool BoundRange(double& min, double& max) const {
+    min = 0.;
+    max = 1.;
+    return true;
+  }
 };
 
 template <typename T>
@@ -507,6 +777,10 @@ class BitwiseNOTNode : public UnaryNode<T, T, BitwiseNOTNode<T> > {
   BitwiseNOTNode(Node<T>& n1) :
       UnaryNode<T, T, BitwiseNOTNode<T> >(n1) { }
   T Evaluate(T a) const {return ~a;}
+
+  bool BoundRange(double& min, double& max) const {
+    return this->Decreasing(min, max);
+  }
 };
 
 template <>
@@ -537,6 +811,12 @@ class InNode : public UnaryNode<T, uint64_t, InNode<T> > {
     }
     uint64_t Evaluate(T a) const {return data_.find(a) != data_.end();}
 
+    bool BoundRange(double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
+
   private:
     std::set<T> data_;
 };
@@ -548,6 +828,10 @@ class CastNode : public UnaryNode<U, T, CastNode<T, U> > {
 
   CastNode(Node<U>& n1) : UnaryNode<U, T, CastNode<T, U> >(n1) { }
   T Evaluate(U a) const {return static_cast<T>(a);}
+
+  bool BoundRange(double& min, double& max) const {
+    return RangeFitsType<T>(min, max) && this->Increasing(min, max);
+  }
 };
 
 template <typename T>
@@ -590,6 +874,12 @@ class AnyNode : public Node<uint64_t> {
     }
     unsigned GetSize() const {return 1;}
 
+    bool GetRange(double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
+
   private:
 
     Node<T>& node_;
@@ -618,6 +908,12 @@ class AllNode : public Node<uint64_t> {
     }
     unsigned GetSize() const {return 1;}
 
+    bool GetRange(double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
+
   private:
 
     Node<T>& node_;
@@ -650,6 +946,12 @@ class SinNode : public UnaryNode<T, double, SinNode<T> > {
 
     SinNode(Node<T>& node) : UnaryNode<T, double, SinNode<T> >(node) { }
     double Evaluate(T a) const {return sin(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      min = -1.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T>
@@ -659,6 +961,12 @@ class CosNode : public UnaryNode<T, double, CosNode<T> > {
 
     CosNode(Node<T>& node) : UnaryNode<T, double, CosNode<T> >(node) { }
     double Evaluate(T a) const {return cos(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      min = -1.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T>
@@ -677,6 +985,15 @@ class AsinNode : public UnaryNode<T, double, AsinNode<T> > {
 
     AsinNode(Node<T>& node) : UnaryNode<T, double, AsinNode<T> >(node) { }
     double Evaluate(T a) const {return asin(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      if (max < -1. || min > 1.) {
+        return false;
+      }
+      min = std::max(min, -1.);
+      max = std::min(max, 1.);
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -686,6 +1003,15 @@ class AcosNode : public UnaryNode<T, double, AcosNode<T> > {
 
     AcosNode(Node<T>& node) : UnaryNode<T, double, AcosNode<T> >(node) { }
     double Evaluate(T a) const {return acos(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      if (max < -1. || min > 1.) {
+        return false;
+      }
+      min = std::max(min, -1.);
+      max = std::min(max, 1.);
+      return this->Decreasing(min, max);
+    }
 };
 
 template <typename T>
@@ -695,6 +1021,10 @@ class AtanNode : public UnaryNode<T, double, AtanNode<T> > {
 
     AtanNode(Node<T>& node) : UnaryNode<T, double, AtanNode<T> >(node) { }
     double Evaluate(T a) const {return atan(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -704,6 +1034,14 @@ class LogNode : public UnaryNode<T, double, LogNode<T> > {
 
     LogNode(Node<T>& node) : UnaryNode<T, double, LogNode<T> >(node) { }
     double Evaluate(T a) const {return log(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      if (max < 0.) {
+        return false;
+      }
+      min = std::max(min, 0.);
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -713,6 +1051,14 @@ class Log10Node : public UnaryNode<T, double, Log10Node<T> > {
 
     Log10Node(Node<T>& node) : UnaryNode<T, double, Log10Node<T> >(node) { }
     double Evaluate(T a) const {return log10(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      if (max < 0.) {
+        return false;
+      }
+      min = std::max(min, 0.);
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -722,6 +1068,10 @@ class ExpNode : public UnaryNode<T, double, ExpNode<T> > {
 
     ExpNode(Node<T>& node) : UnaryNode<T, double, ExpNode<T> >(node) { }
     double Evaluate(T a) const {return exp(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -731,6 +1081,18 @@ class AbsNode : public UnaryNode<T, double, AbsNode<T> > {
 
     AbsNode(Node<T>& node) : UnaryNode<T, double, AbsNode<T> >(node) { }
     double Evaluate(T a) const {return fabs(static_cast<double>(a));}
+
+    bool BoundRange(double& min, double& max) const {
+      if (min >= 0.) {
+        return this->Increasing(min, max);
+      }
+      if (max <= 0.) {
+        return this->Decreasing(min, max);
+      }
+      max = std::max(-min, max);
+      min = 0.;
+      return true;
+    }
 };
 
 // Specialize for uint64_t to avoid snarky warnings from Clang
@@ -743,6 +1105,8 @@ class AbsNode<uint64_t> :
       AbsNode(Node<uint64_t>& node) :
             UnaryNode<uint64_t, double, AbsNode<uint64_t> >(node) { }
       double Evaluate(uint64_t a) const {return static_cast<double>(a);}
+
+      bool BoundRange(double& min, double& max) const {return true;}
 };
 
 template <typename T>
@@ -752,6 +1116,14 @@ class SqrtNode : public UnaryNode<T, double, SqrtNode<T> > {
 
     SqrtNode(Node<T>& node) : UnaryNode<T, double, SqrtNode<T> >(node) { }
     double Evaluate(T a) const {return sqrt(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      if (max < 0.) {
+        return false;
+      }
+      min = std::max(min, 0.);
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -761,6 +1133,10 @@ class CeilNode : public UnaryNode<T, double, CeilNode<T> > {
 
     CeilNode(Node<T>& node) : UnaryNode<T, double, CeilNode<T> >(node) { }
     double Evaluate(T a) const {return ceil(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -770,6 +1146,10 @@ class FloorNode : public UnaryNode<T, double, FloorNode<T> > {
 
     FloorNode(Node<T>& node) : UnaryNode<T, double, FloorNode<T> >(node) { }
     double Evaluate(T a) const {return floor(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -779,6 +1159,12 @@ class IsNaNNode : public UnaryNode<T, uint64_t, IsNaNNode<T> > {
 
     IsNaNNode(Node<T>& node) : UnaryNode<T, uint64_t, IsNaNNode<T> >(node) { }
     uint64_t Evaluate(T a) const {return std::isnan(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T>
@@ -788,6 +1174,12 @@ class IsInfNode : public UnaryNode<T, uint64_t, IsInfNode<T> > {
 
     IsInfNode(Node<T>& node) : UnaryNode<T, uint64_t, IsInfNode<T> >(node) { }
     uint64_t Evaluate(T a) const {return std::isinf(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      min = 0.;
+      max = 1.;
+      return true;
+    }
 };
 
 template <typename T>
@@ -797,6 +1189,10 @@ class SinhNode : public UnaryNode<T, double, SinhNode<T> > {
 
     SinhNode(Node<T>& node) : UnaryNode<T, double, SinhNode<T> >(node) { }
     double Evaluate(T a) const {return sinh(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -806,6 +1202,18 @@ class CoshNode : public UnaryNode<T, double, CoshNode<T> > {
 
     CoshNode(Node<T>& node) : UnaryNode<T, double, CoshNode<T> >(node) { }
     double Evaluate(T a) const {return cosh(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      if (min >= 0.) {
+        return this->Increasing(min, max);
+      }
+      if (max <= 0.) {
+        return this->Decreasing(min, max);
+      }
+      max = std::max(cosh(min), cosh(max));
+      min = 1.;
+      return true;
+    }
 };
 
 template <typename T>
@@ -815,6 +1223,10 @@ class TanhNode : public UnaryNode<T, double, TanhNode<T> > {
 
     TanhNode(Node<T>& node) : UnaryNode<T, double, TanhNode<T> >(node) { }
     double Evaluate(T a) const {return tanh(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -824,6 +1236,10 @@ class IntNode : public UnaryNode<T, int64_t, IntNode<T> > {
 
     IntNode(Node<T>& node) : UnaryNode<T, int64_t, IntNode<T> >(node) { }
     int64_t Evaluate(T a) const {return int(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return RangeFitsType<int>(min, max) && this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -834,6 +1250,10 @@ class UnsignedNode : public UnaryNode<T, uint64_t, UnsignedNode<T> > {
     UnsignedNode(Node<T>& node) :
             UnaryNode<T, uint64_t, UnsignedNode<T> >(node) { }
     uint64_t Evaluate(T a) const {return unsigned(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return RangeFitsType<unsigned>(min, max) && this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -843,6 +1263,10 @@ class FloatNode : public UnaryNode<T, float, FloatNode<T> > {
 
     FloatNode(Node<T>& node) : UnaryNode<T, float, FloatNode<T> >(node) { }
     float Evaluate(T a) const {return float(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return this->Increasing(min, max);
+    }
 };
 
 template <typename T>
@@ -852,6 +1276,10 @@ class DoubleNode : public UnaryNode<T, double, DoubleNode<T> > {
 
     DoubleNode(Node<T>& node) : UnaryNode<T, double, DoubleNode<T> >(node) { }
     double Evaluate(T a) const {return double(a);}
+
+    bool BoundRange(double& min, double& max) const {
+      return this->Increasing(min, max);
+    }
 };
 
 class RandNode : public Node<uint64_t> {
@@ -861,6 +1289,12 @@ class RandNode : public Node<uint64_t> {
     RandNode() { }
     uint64_t operator[](unsigned idx) const {return rand();}
     unsigned GetSize() const {return 1;}
+
+    bool GetRange(double& min, double& max) const {
+      min = 0.;
+      max = RAND_MAX;
+      return true;
+    }
 };
 
 template <typename T, typename U>
@@ -874,6 +1308,19 @@ class FmodNode :
                         double, FmodNode<T, U> >(n1, n2) { }
 
     double Evaluate(double a, double b) const {return fmod(a, b);}
+
+    // The result has the sign of the dividend and is smaller in
+    // magnitude than both arguments
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      if (!(min2 > 0. || max2 < 0.)) {
+        return false;
+      }
+      double m = std::max(fabs(min2), fabs(max2));
+      min = std::max(-m, std::min(min1, 0.));
+      max = std::min(m, std::max(max1, 0.));
+      return true;
+    }
 };
 
 template <typename T, typename U>
@@ -887,6 +1334,13 @@ class Atan2Node :
                         double, Atan2Node<T, U> >(n1, n2) { }
 
     double Evaluate(double a, double b) const {return atan2(a, b);}
+
+    bool BoundRange(double min1, double max1, double min2, double max2,
+                    double& min, double& max) const {
+      max = atan2(0., -1.);
+      min = -max;
+      return true;
+    }
 };
 
 #endif // XCDF_UTILITY_NODE_DEFS_H_INCLUDED
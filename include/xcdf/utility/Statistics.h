@@ -0,0 +1,345 @@
+
+/*
+Copyright (c) 2014, University of Maryland
+                    Jim Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef XCDF_UTILITY_STATISTICS_H_INCLUDED
+#define XCDF_UTILITY_STATISTICS_H_INCLUDED
+
+#include <xcdf/XCDFDefs.h>
+#include <xcdf/XCDFFile.h>
+#include <xcdf/utility/NumericalExpression.h>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#include <stdint.h>
+
+/*
+ *  Count, mean, variance and range of a stream of values.  The mean and
+ *  variance are updated with Welford's method, and two sets of statistics
+ *  are combined exactly with the pairwise formula of Chan et al.
+ */
+class RunningStatistics {
+
+  public:
+
+    RunningStatistics() : n_(0),
+                          mean_(0.),
+                          m2_(0.),
+                          min_(HUGE_VAL),
+                          max_(-HUGE_VAL) { }
+
+    void Fill(double x) {
+      ++n_;
+      double delta = x - mean_;
+      mean_ += delta / n_;
+      m2_ += delta * (x - mean_);
+      if (x < min_) {
+        min_ = x;
+      }
+      if (x > max_) {
+        max_ = x;
+      }
+    }
+
+    void Add(const RunningStatistics& s) {
+
+      if (s.n_ == 0) {
+        return;
+      }
+
+      uint64_t n = n_ + s.n_;
+      double delta = s.mean_ - mean_;
+      mean_ += delta * s.n_ / n;
+      m2_ += s.m2_ + delta * delta * (static_cast<double>(n_) * s.n_) / n;
+      n_ = n;
+      if (s.min_ < min_) {
+        min_ = s.min_;
+      }
+      if (s.max_ > max_) {
+        max_ = s.max_;
+      }
+    }
+
+    uint64_t GetN() const {return n_;}
+    double GetMean() const {return n_ > 0 ? mean_ : NaN();}
+    double GetMin() const {return n_ > 0 ? min_ : NaN();}
+    double GetMax() const {return n_ > 0 ? max_ : NaN();}
+
+    // Sample variance, with n - 1 degrees of freedom
+    double GetVariance() const {return n_ > 1 ? m2_ / (n_ - 1) : NaN();}
+    double GetStandardDeviation() const {return sqrt(GetVariance());}
+
+  private:
+
+    uint64_t n_;
+    double mean_;
+    double m2_;
+    double min_;
+    double max_;
+
+    static double NaN() {return std::numeric_limits<double>::quiet_NaN();}
+};
+
+/*
+ *  KLL quantile sketch (Karnin, Lang and Liberty, 2016).  Values are held
+ *  in a stack of compactors; items at level h stand for 2^h values.  When
+ *  a level is full it is sorted and every other item is promoted to the
+ *  next level, so memory grows only as O(k log(n/k)).  Sketches with the
+ *  same k merge by concatenating levels.  The choice of items to promote
+ *  alternates deterministically, so results are reproducible.
+ */
+class QuantileSketch {
+
+  public:
+
+    QuantileSketch(unsigned k = 1000) : k_(k < 8 ? 8 : k),
+                                       n_(0),
+                                       offset_(0),
+                                       levels_(1),
+                                       capacities_(1, k_) { }
+
+    void Fill(double x) {
+      levels_[0].push_back(x);
+      ++n_;
+      if (levels_[0].size() >= capacities_[0]) {
+        Compress();
+      }
+    }
+
+    void Add(const QuantileSketch& s) {
+
+      if (s.k_ != k_) {
+        XCDFFatal("Cannot merge quantile sketches of different size");
+      }
+
+      while (levels_.size() < s.levels_.size()) {
+        AddLevel();
+      }
+      for (unsigned h = 0; h < s.levels_.size(); ++h) {
+        levels_[h].insert(levels_[h].end(),
+                          s.levels_[h].begin(), s.levels_[h].end());
+      }
+      n_ += s.n_;
+      Compress();
+    }
+
+    uint64_t GetN() const {return n_;}
+
+    // Number of items held, for checking memory use
+    unsigned GetNRetained() const {
+      unsigned size = 0;
+      for (unsigned h = 0; h < levels_.size(); ++h) {
+        size += levels_[h].size();
+      }
+      return size;
+    }
+
+    // Approximate value at quantile q in [0, 1]
+    double GetQuantile(double q) const {
+
+      std::vector<std::pair<double, uint64_t> > items;
+      uint64_t total = 0;
+      for (unsigned h = 0; h < levels_.size(); ++h) {
+        for (std::vector<double>::const_iterator it = levels_[h].begin();
+                                                 it != levels_[h].end(); ++it) {
+          items.push_back(std::pair<double, uint64_t>(*it, 1ULL << h));
+          total += 1ULL << h;
+        }
+      }
+
+      if (items.size() == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+      }
+
+      std::sort(items.begin(), items.end());
+      double target = q * total;
+      uint64_t cumulative = 0;
+      for (std::vector<std::pair<double, uint64_t> >::const_iterator
+                       it = items.begin(); it != items.end(); ++it) {
+        cumulative += it->second;
+        if (cumulative >= target) {
+          return it->first;
+        }
+      }
+      return items.back().first;
+    }
+
+  private:
+
+    unsigned k_;
+    uint64_t n_;
+    unsigned offset_;
+    std::vector<std::vector<double> > levels_;
+    std::vector<size_t> capacities_;
+
+    // Capacities shrink geometrically (by 2/3) below the top level
+    void AddLevel() {
+      levels_.push_back(std::vector<double>());
+      capacities_.resize(levels_.size());
+      unsigned top = levels_.size() - 1;
+      for (unsigned h = 0; h <= top; ++h) {
+        double cap = k_ * pow(2. / 3., static_cast<int>(top - h));
+        capacities_[h] = cap < 2. ? 2 : static_cast<size_t>(cap);
+      }
+    }
+
+    void Compress() {
+
+      for (unsigned h = 0; h < levels_.size(); ++h) {
+
+        if (levels_[h].size() < capacities_[h]) {
+          continue;
+        }
+
+        if (h + 1 == levels_.size()) {
+          AddLevel();
+        }
+
+        // An odd item out stays at this level
+        std::vector<double>& level = levels_[h];
+        std::sort(level.begin(), level.end());
+        size_t n = level.size() & ~static_cast<size_t>(1);
+        for (size_t i = offset_; i < n; i += 2) {
+          levels_[h + 1].push_back(level[i]);
+        }
+        offset_ ^= 1;
+        level.erase(level.begin(), level.begin() + n);
+      }
+    }
+};
+
+/*
+ *  Summary statistics and quantiles of a set of expressions, filled in
+ *  a single pass.  All entries of vector expressions are included, and
+ *  NaN values are skipped.  Statistics of the same expressions filled
+ *  from different parts of the data are combined with Add().
+ */
+class ExpressionStatistics {
+
+  public:
+
+    ExpressionStatistics(const std::vector<std::string>& exprs,
+                         unsigned sketchSize = 1000) :
+                              exprs_(exprs),
+                              stats_(exprs.size()),
+                              sketches_(exprs.size(),
+                                        QuantileSketch(sketchSize)) { }
+
+    unsigned GetNExpressions() const {return exprs_.size();}
+    const std::vector<std::string>& GetExpressions() const {return exprs_;}
+
+    const RunningStatistics& GetStatistics(unsigned i) const {
+      return stats_[i];
+    }
+    const QuantileSketch& GetQuantiles(unsigned i) const {
+      return sketches_[i];
+    }
+
+    void Fill(XCDFFile& f) {
+
+      std::vector<NumericalExpression<double> > nes;
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        nes.push_back(NumericalExpression<double>(exprs_[i], f));
+      }
+
+      while (f.Read()) {
+        FillEvent(nes);
+      }
+    }
+
+    // Fill with the values of the current event, given expressions
+    // built from GetExpressions()
+    void FillEvent(const std::vector<NumericalExpression<double> >& nes) {
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        unsigned size = nes[i].GetSize();
+        for (unsigned j = 0; j < size; ++j) {
+          double value = nes[i].Evaluate(j);
+          if (!std::isnan(value)) {
+            stats_[i].Fill(value);
+            sketches_[i].Fill(value);
+          }
+        }
+      }
+    }
+
+    void Add(const ExpressionStatistics& s) {
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        stats_[i].Add(s.stats_[i]);
+        sketches_[i].Add(s.sketches_[i]);
+      }
+    }
+
+  private:
+
+    std::vector<std::string> exprs_;
+    std::vector<RunningStatistics> stats_;
+    std::vector<QuantileSketch> sketches_;
+};
+
+inline std::ostream&
+operator<<(std::ostream& out, const ExpressionStatistics& s) {
+
+  const double quantiles[] = {0.05, 0.25, 0.5, 0.75, 0.95};
+  const char* labels[] = {"5%", "25%", "Median", "75%", "95%"};
+  const unsigned nq = 5;
+
+  unsigned width = 10;
+  for (unsigned i = 0; i < s.GetNExpressions(); ++i) {
+    if (s.GetExpressions()[i].size() > width) {
+      width = s.GetExpressions()[i].size();
+    }
+  }
+
+  out << std::setw(width) << "Expression" << " " << std::setw(10) <<
+         "Count" << " " << std::setw(12) << "Mean" << " " <<
+         std::setw(12) << "StdDev" << " " << std::setw(12) << "Min";
+  for (unsigned j = 0; j < nq; ++j) {
+    out << " " << std::setw(12) << labels[j];
+  }
+  out << " " << std::setw(12) << "Max" << "\n";
+
+  for (unsigned i = 0; i < s.GetNExpressions(); ++i) {
+    const RunningStatistics& rs = s.GetStatistics(i);
+    out << std::setw(width) << s.GetExpressions()[i] << " " <<
+           std::setw(10) << rs.GetN() << " " <<
+           std::setw(12) << rs.GetMean() << " " <<
+           std::setw(12) << rs.GetStandardDeviation() << " " <<
+           std::setw(12) << rs.GetMin();
+    for (unsigned j = 0; j < nq; ++j) {
+      out << " " << std::setw(12) <<
+             s.GetQuantiles(i).GetQuantile(quantiles[j]);
+    }
+    out << " " << std::setw(12) << rs.GetMax() << "\n";
+  }
+  return out;
+}
+
+#endif // XCDF_UTILITY_STATISTICS_H_INCLUDED
@@ -0,0 +1,148 @@
+
+/*
+Copyright (c) 2014, University of Maryland
+                    Jim Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_UTILITY_THREAD_RUNNER_H_INCLUDED
+#define XCDF_UTILITY_THREAD_RUNNER_H_INCLUDED
+
+#include <xcdf/XCDFDefs.h>
+
+#include <vector>
+#include <string>
+#include <pthread.h>
+
+/*
+ *  A unit of work run on its own thread by RunThreads().  An
+ *  XCDFException thrown by Run() is caught on the thread and rethrown
+ *  from RunThreads() once all threads are joined.
+ */
+class ThreadTask {
+
+  public:
+
+    ThreadTask() : failed_(false) { }
+    virtual ~ThreadTask() { }
+
+    virtual void Run() = 0;
+
+    bool Failed() const {return failed_;}
+    const std::string& GetErrorMessage() const {return errorMessage_;}
+
+    static void* Start(void* task) {
+
+      ThreadTask* t = static_cast<ThreadTask*>(task);
+      try {
+        t->Run();
+      } catch (XCDFException& e) {
+        t->failed_ = true;
+        t->errorMessage_ = e.GetMessage();
+      }
+      return NULL;
+    }
+
+  private:
+
+    bool failed_;
+    std::string errorMessage_;
+};
+
+/// Run each task on its own thread and wait for them all to finish
+inline void RunThreads(std::vector<ThreadTask*>& tasks) {
+
+  // No need for a thread when there is one task
+  if (tasks.size() == 1) {
+    tasks[0]->Run();
+    return;
+  }
+
+  std::vector<pthread_t> threads(tasks.size());
+  std::vector<bool> started(tasks.size(), false);
+  for (unsigned i = 0; i < tasks.size(); ++i) {
+    if (pthread_create(&threads[i], NULL,
+                       &ThreadTask::Start, tasks[i]) == 0) {
+      started[i] = true;
+    } else {
+      // Unable to start a thread.  Run the task here instead.
+      ThreadTask::Start(tasks[i]);
+    }
+  }
+
+  for (unsigned i = 0; i < tasks.size(); ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+
+  for (unsigned i = 0; i < tasks.size(); ++i) {
+    if (tasks[i]->Failed()) {
+      XCDFThrow(tasks[i]->GetErrorMessage());
+    }
+  }
+}
+
+/*
+ *  Tasks of one type to run together with RunThreads().  The list owns
+ *  the tasks and deletes them when it goes out of scope, also when a
+ *  task fails.  Tasks are kept in the order added, so results can be
+ *  merged in input order.
+ */
+template <typename Task>
+class TaskList {
+
+  public:
+
+    TaskList() { }
+
+    ~TaskList() {Clear();}
+
+    void Add(Task* task) {tasks_.push_back(task);}
+
+    unsigned Size() const {return tasks_.size();}
+
+    Task& operator[](unsigned i) {return *tasks_[i];}
+
+    void Run() {
+      std::vector<ThreadTask*> threadTasks(tasks_.begin(), tasks_.end());
+      RunThreads(threadTasks);
+    }
+
+    void Clear() {
+      for (unsigned i = 0; i < tasks_.size(); ++i) {
+        delete tasks_[i];
+      }
+      tasks_.clear();
+    }
+
+  private:
+
+    std::vector<Task*> tasks_;
+
+    // Not copyable
+    TaskList(const TaskList&);
+    TaskList& operator=(const TaskList&);
+};
+
+#endif // XCDF_UTILITY_THREAD_RUNNER_H_INCLUDED
@@ -37,6 +37,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <utility>
 #include <algorithm>
 #include <set>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
 
 #include <unistd.h>
 
@@ -431,6 +434,7 @@ class FieldCopyBuffer {
       if (it == map.end()) {
         XCDFField<T> newField =
             AllocateField(name, field.GetResolution(), parentName);
+        file_.SetFieldEncoding(name, field.GetEncoding());
         map.insert(std::make_pair(field.GetName(),
                                           std::make_pair(field, newField)));
       } else {
@@ -508,7 +512,7 @@ class CSVInputHandler {
                     std::istream& in) : f_(f),
                                         in_(in),
                                         delim_(',') {
-      ProcessFieldDefs();
+      Init();
     }
 
     CSVInputHandler(XCDFFile& f,
@@ -516,19 +520,18 @@ class CSVInputHandler {
                     char& delim) : f_(f),
                                 in_(in),
                                 delim_(delim) {
-      ProcessFieldDefs();
+      Init();
     }
 
     bool CopyLine() {
 
-      ParseLine();
-      if (!in_.good()) {
+      if (!ParseLine()) {
         return false;
       }
 
-      if (currentParsedLine_.size() != fieldTypeList_.size()) {
+      if (cells_.size() != fieldTypeList_.size()) {
         XCDFFatal("Expected " << fieldTypeList_.size() <<
-                             " entries in line " << currentLine_);
+                  " entries in line " << std::string(lineBegin_, lineEnd_));
       }
 
       std::vector<XCDFUnsignedIntegerField>::iterator
@@ -538,26 +541,25 @@ class CSVInputHandler {
       std::vector<XCDFFloatingPointField>::iterator
                    currentFloatingPointField = floatingPointFields_.begin();
 
-      unsigned long long uval;
-      long long ival;
+      uint64_t uval;
+      int64_t ival;
       double fval;
 
-      unsigned count;
-      std::vector<std::string> entries;
-
       for (unsigned i = 0; i < fieldTypeList_.size(); ++i) {
 
-        count = 0;
-        ParseString(currentParsedLine_[i], entries);
+        // Vector entries are separated by ':'
+        const char* pos = cells_[i].first;
+        const char* end = cells_[i].second;
+        const char* entryBegin;
+        const char* entryEnd;
+        bool good = true;
 
         switch(fieldTypeList_[i]) {
 
           case XCDF_UNSIGNED_INTEGER:
 
-            for (std::vector<std::string>::iterator it = entries.begin();
-                                                 it != entries.end(); ++it) {
-
-              count += sscanf(it->c_str(), "%llu", &uval);
+            while (good && NextEntry(pos, end, entryBegin, entryEnd)) {
+              good = ParseUnsigned(entryBegin, entryEnd, uval);
               *currentUnsignedField << uval;
             }
             currentUnsignedField++;
@@ -565,10 +567,8 @@ class CSVInputHandler {
 
           case XCDF_SIGNED_INTEGER:
 
-            for (std::vector<std::string>::iterator it = entries.begin();
-                                                 it != entries.end(); ++it) {
-
-              count += sscanf(it->c_str(), "%lld", &ival);
+            while (good && NextEntry(pos, end, entryBegin, entryEnd)) {
+              good = ParseSigned(entryBegin, entryEnd, ival);
               *currentSignedField << ival;
             }
             currentSignedField++;
@@ -576,19 +576,17 @@ class CSVInputHandler {
 
           case XCDF_FLOATING_POINT:
 
-            for (std::vector<std::string>::iterator it = entries.begin();
-                                                 it != entries.end(); ++it) {
-
-              count += sscanf(it->c_str(), "%lg", &fval);
+            while (good && NextEntry(pos, end, entryBegin, entryEnd)) {
+              good = ParseDouble(entryBegin, entryEnd, fval);
               *currentFloatingPointField << fval;
             }
             currentFloatingPointField++;
             break;
-
         }
 
-        if (count != entries.size()) {
-          XCDFFatal("Bad input string: " << currentParsedLine_[i]);
+        if (!good) {
+          XCDFFatal("Bad input string: " <<
+                    std::string(cells_[i].first, cells_[i].second));
         }
       }
 
@@ -597,50 +595,260 @@ class CSVInputHandler {
 
   private:
 
+    typedef std::pair<const char*, const char*> Cell;
+
     XCDFFile& f_;
     std::istream& in_;
     char delim_;
 
+    // Text is read in large chunks and parsed in place
+    std::vector<char> buffer_;
+    size_t bufferPos_;
+    size_t bufferFill_;
+    bool inputDone_;
+
+    const char* lineBegin_;
+    const char* lineEnd_;
+    std::vector<Cell> cells_;
+    std::string scratch_;
+
+    static const size_t READ_SIZE = 1 << 20;
+
+    void Init() {
+      buffer_.resize(READ_SIZE);
+      bufferPos_ = 0;
+      bufferFill_ = 0;
+      inputDone_ = false;
+      lineBegin_ = NULL;
+      lineEnd_ = NULL;
+      ProcessFieldDefs();
+    }
+
     void ProcessFieldDefs() {
 
       ParseLine();
-      for (std::vector<std::string>::iterator
-                          it = currentParsedLine_.begin();
-                          it != currentParsedLine_.end(); ++it) {
-        AddField(*it);
+      for (std::vector<Cell>::iterator it = cells_.begin();
+                                       it != cells_.end(); ++it) {
+        std::string str(it->first, it->second);
+        AddField(str);
       }
     }
 
-    void ParseLine() {
+    /*
+     *  Find the next line in the buffer, reading more input as needed.
+     *  A final line without a newline is returned as well.
+     */
+    bool ReadLine() {
+
+      for (;;) {
+
+        char* begin = &buffer_[0] + bufferPos_;
+        char* newline = static_cast<char*>(
+                  memchr(begin, '\n', bufferFill_ - bufferPos_));
+        if (newline) {
+          lineBegin_ = begin;
+          lineEnd_ = newline;
+          bufferPos_ = newline - &buffer_[0] + 1;
+          return true;
+        }
+
+        if (inputDone_) {
+          if (bufferPos_ == bufferFill_) {
+            return false;
+          }
+          lineBegin_ = begin;
+          lineEnd_ = &buffer_[0] + bufferFill_;
+          bufferPos_ = bufferFill_;
+          return true;
+        }
+
+        // Move the partial line to the front, making room for a long line
+        size_t remaining = bufferFill_ - bufferPos_;
+        if (bufferPos_ > 0) {
+          memmove(&buffer_[0], begin, remaining);
+        }
+        bufferPos_ = 0;
+        bufferFill_ = remaining;
+        if (buffer_.size() - bufferFill_ < READ_SIZE / 2) {
+          buffer_.resize(2 * buffer_.size());
+        }
 
-      currentParsedLine_.clear();
-      std::getline(in_, currentLine_);
-      std::stringstream sstream(currentLine_);
-      std::string currentString;
+        in_.read(&buffer_[bufferFill_], buffer_.size() - bufferFill_);
+        bufferFill_ += in_.gcount();
+        if (!in_.good()) {
+          inputDone_ = true;
+        }
+      }
+    }
 
-      while (std::getline(sstream, currentString, delim_)) {
+    /*
+     *  Split the next line into cells at each delimiter.  An empty line
+     *  has no cells.
+     */
+    bool ParseLine() {
 
-        currentParsedLine_.push_back(currentString);
+      cells_.clear();
+      if (!ReadLine()) {
+        return false;
       }
 
-      // Check for an empty delimiter
-      if (currentLine_.size() > 0) {
-        if (currentLine_[currentLine_.size() - 1] == delim_) {
-          currentParsedLine_.push_back("");
+      const char* pos = lineBegin_;
+      if (pos == lineEnd_) {
+        return true;
+      }
+
+      for (;;) {
+        const char* next = static_cast<const char*>(
+                            memchr(pos, delim_, lineEnd_ - pos));
+        if (!next) {
+          cells_.push_back(Cell(pos, lineEnd_));
+          return true;
         }
+        cells_.push_back(Cell(pos, next));
+        pos = next + 1;
       }
     }
 
-    void ParseString(const std::string& input,
-                     std::vector<std::string>& vec) {
+    /// Get the next ':'-separated entry of a cell.  A trailing ':' does
+    /// not start another entry.
+    static bool NextEntry(const char*& pos,
+                          const char* end,
+                          const char*& entryBegin,
+                          const char*& entryEnd) {
 
-      vec.clear();
-      std::stringstream sstream(input);
-      std::string currentString;
-      while (std::getline(sstream, currentString, ':')) {
+      if (pos == end) {
+        return false;
+      }
 
-        vec.push_back(currentString);
+      entryBegin = pos;
+      const char* next = static_cast<const char*>(memchr(pos, ':', end - pos));
+      if (next) {
+        entryEnd = next;
+        pos = next + 1;
+      } else {
+        entryEnd = end;
+        pos = end;
       }
+      return true;
+    }
+
+    static const char* SkipSpace(const char* pos, const char* end) {
+      while (pos != end && (*pos == ' ' || (*pos >= '\t' && *pos <= '\r'))) {
+        ++pos;
+      }
+      return pos;
+    }
+
+    static bool IsDigit(char c) {return c >= '0' && c <= '9';}
+
+    /*
+     *  The parsers accept the same text as sscanf(): leading whitespace
+     *  is skipped and anything after the number is ignored.  Plain
+     *  decimal numbers are converted directly.  Anything else is passed
+     *  to the C library.
+     */
+    bool ParseUnsigned(const char* pos, const char* end, uint64_t& value) {
+
+      const char* begin = SkipSpace(pos, end);
+      pos = begin;
+      value = 0;
+      while (pos != end && IsDigit(*pos) && value < 1000000000000000000ull) {
+        value = 10 * value + (*pos++ - '0');
+      }
+
+      if (pos != begin && (pos == end || !IsDigit(*pos))) {
+        return true;
+      }
+
+      const char* cstr = Terminate(begin, end);
+      char* endPtr;
+      value = strtoull(cstr, &endPtr, 10);
+      return endPtr != cstr;
+    }
+
+    bool ParseSigned(const char* pos, const char* end, int64_t& value) {
+
+      const char* begin = SkipSpace(pos, end);
+      pos = begin;
+      bool negative = false;
+      if (pos != end && (*pos == '-' || *pos == '+')) {
+        negative = *pos++ == '-';
+      }
+
+      const char* digits = pos;
+      uint64_t magnitude = 0;
+      while (pos != end && IsDigit(*pos) && magnitude < 100000000000000000ull) {
+        magnitude = 10 * magnitude + (*pos++ - '0');
+      }
+
+      if (pos != digits && (pos == end || !IsDigit(*pos))) {
+        value = negative ? -static_cast<int64_t>(magnitude) :
+                            static_cast<int64_t>(magnitude);
+        return true;
+      }
+
+      const char* cstr = Terminate(begin, end);
+      char* endPtr;
+      value = strtoll(cstr, &endPtr, 10);
+      return endPtr != cstr;
+    }
+
+    /*
+     *  A decimal n / 10^d with n < 2^53 and d <= 22 is converted exactly
+     *  by a single correctly rounded division, as strtod() would.
+     */
+    bool ParseDouble(const char* pos, const char* end, double& value) {
+
+      static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6,
+                                      1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+                                      1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+                                      1e19, 1e20, 1e21, 1e22};
+      static const uint64_t maxExact = 1ull << 53;
+
+      const char* begin = SkipSpace(pos, end);
+      pos = begin;
+      bool negative = false;
+      if (pos != end && (*pos == '-' || *pos == '+')) {
+        negative = *pos++ == '-';
+      }
+
+      uint64_t n = 0;
+      unsigned nDigits = 0;
+      unsigned decimals = 0;
+      bool exact = true;
+      for (; pos != end && IsDigit(*pos); ++pos, ++nDigits) {
+        n = 10 * n + (*pos - '0');
+        exact = exact && n < maxExact / 10;
+      }
+      if (pos != end && *pos == '.') {
+        for (++pos; pos != end && IsDigit(*pos); ++pos, ++nDigits) {
+          n = 10 * n + (*pos - '0');
+          exact = exact && n < maxExact / 10;
+          ++decimals;
+        }
+      }
+
+      // Exponents, hexadecimal, inf and nan go to strtod()
+      bool plain = pos == end || (*pos != 'e' && *pos != 'E' &&
+                                  *pos != 'x' && *pos != 'X');
+      if (nDigits > 0 && exact && plain && decimals <= 22) {
+        value = static_cast<double>(n) / powers[decimals];
+        if (negative) {
+          value = -value;
+        }
+        return true;
+      }
+
+      const char* cstr = Terminate(begin, end);
+      char* endPtr;
+      value = strtod(cstr, &endPtr);
+      return endPtr != cstr;
+    }
+
+    /// Copy text to a NUL-terminated scratch buffer
+    const char* Terminate(const char* begin, const char* end) {
+      scratch_.assign(begin, end);
+      return scratch_.c_str();
     }
 
     void AddField(std::string& str) {
@@ -730,8 +938,6 @@ class CSVInputHandler {
    std::vector<XCDFFloatingPointField> floatingPointFields_;
 
    std::vector<XCDFFieldType> fieldTypeList_;
-   std::vector<std::string> currentParsedLine_;
-   std::string currentLine_;
 };
 
 class AliasAdder {
@@ -31,11 +31,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <cstring>
 #include <fstream>
+#include <algorithm>
 
 void XCDFFile::Init() {
 
+  eventStamp_ = 0;
   blockSize_ = 1000;
   thresholdByteCount_ = 100000000; // Allow up to 100 MB in a block by default
+  targetBlockBytes_ = 0;
+  blockCompressionRatio_ = 0.;
   zeroAlign_ = true;
 
   eventCount_ = 0;
@@ -50,10 +54,12 @@ void XCDFFile::Init() {
   recover_ = false;
   unusableGlobalsFromFile_ = false;
   haveV3Globals_ = false;
+  haveHeaderGlobals_ = false;
 
   currentFileStartOffset_ = 0;
   currentFrameStartOffset_ = 0;
   currentFrameEndOffset_ = 0;
+  currentBlockStartOffset_ = 0;
 
   currentFileName_ = "";
   isSimple_ = false;
@@ -139,6 +145,7 @@ void XCDFFile::Close() {
   currentFileStartOffset_ = 0;
   currentFrameStartOffset_ = 0;
   currentFrameEndOffset_ = 0;
+  currentBlockStartOffset_ = 0;
 
   currentFileName_ = "";
 }
@@ -359,7 +366,7 @@ void XCDFFile::WriteFrame() {
 /*
  *  Read a frame from istream_ into currentFrame_
  */
-void XCDFFile::ReadFrame() {
+void XCDFFile::ReadFrame(bool inflate) {
 
   assert(IsReadable());
 
@@ -368,7 +375,7 @@ void XCDFFile::ReadFrame() {
   // Save start-of-frame file pointer
   currentFrameStartOffset_ = istream.tellg();
   try {
-    currentFrame_.Read(istream);
+    currentFrame_.Read(istream, inflate);
   } catch (std::istream::failure& e) {
     istream.setstate(std::istream::failbit);
   }
@@ -403,16 +410,19 @@ int XCDFFile::Write() {
   eventCount_++;
   blockEventCount_++;
 
-  uint64_t currentBlockSize = 0;
-  for (FieldList::iterator it = fieldList_.begin();
-                           it != fieldList_.end(); ++it) {
-    currentBlockSize += (*it)->GetStashSize() * XCDF_DATUM_WIDTH_BYTES;
+  uint64_t currentBlockSize = GetStashBytes();
+
+  // With a target compressed size, predict the size of the block from
+  // the compression of the last one in place of counting events
+  bool blockFull = blockEventCount_ >= blockSize_;
+  if (targetBlockBytes_ > 0 && blockCompressionRatio_ > 0.) {
+    blockFull =
+        currentBlockSize * blockCompressionRatio_ >= targetBlockBytes_;
   }
 
   // Write out the block if we've reached specified block size or
   // buffer has reached the specified threshold size
-  if (blockEventCount_ >= blockSize_ ||
-                 currentBlockSize >= thresholdByteCount_) {
+  if (blockFull || currentBlockSize >= thresholdByteCount_) {
     WriteBlock();
 
     // If last block was larger than 150 MB, deallocate memory buffers.
@@ -445,6 +455,7 @@ void XCDFFile::WriteBlock() {
   blockHeader_.Clear();
   blockData_.Clear();
   blockHeader_.SetEventCount(blockEventCount_);
+  uint64_t stashBytes = GetStashBytes();
 
   // Align the field bins with zero if possible
   if (zeroAlign_) {
@@ -456,7 +467,7 @@ void XCDFFile::WriteBlock() {
   for (FieldList::iterator it = fieldList_.begin();
                            it != fieldList_.end(); ++it) {
     header.rawActiveMin_ = (*it)->GetRawActiveMin();
-    header.activeSize_ = (*it)->GetActiveSize();
+    header.activeSize_ = (*it)->GetHeaderSize();
     blockHeader_.AddFieldHeader(header);
   }
 
@@ -481,8 +492,18 @@ void XCDFFile::WriteBlock() {
   blockHeader_.PackFrame(currentFrame_);
   WriteFrame();
   blockData_.PackFrame(currentFrame_);
+  if (fileHeader_.GetShuffle()) {
+    currentFrame_.SetShuffle(GetBlockRecordBits());
+  }
   WriteFrame();
 
+  // Measure the compression to size the next block, if we can tell
+  // where the frame ended (not on a pipe)
+  std::streamoff frameBytes = currentFrameEndOffset_ - currentFrameStartOffset_;
+  if (stashBytes > 0 && frameBytes > 0) {
+    blockCompressionRatio_ = static_cast<double>(frameBytes) / stashBytes;
+  }
+
   // Reset each field
   FieldListForEach(ResetField);
 
@@ -492,6 +513,36 @@ void XCDFFile::WriteBlock() {
   blockEventCount_ = 0;
 }
 
+/*
+ * Get the number of bits used by each event of the current block, or 0 if
+ * it varies from event to event
+ */
+uint32_t XCDFFile::GetBlockRecordBits() const {
+
+  uint32_t recordBits = 0;
+  for (FieldList::const_iterator it = fieldList_.begin();
+                                 it != fieldList_.end(); ++it) {
+    if ((*it)->HasParent() || !(*it)->IsFixedWidthBlock()) {
+      return 0;
+    }
+    recordBits += (*it)->GetActiveSize();
+  }
+  return recordBits;
+}
+
+/*
+ * Get the size of the uncompressed buffer, in bytes
+ */
+uint64_t XCDFFile::GetStashBytes() const {
+
+  uint64_t stashBytes = 0;
+  for (FieldList::const_iterator it = fieldList_.begin();
+                                 it != fieldList_.end(); ++it) {
+    stashBytes += (*it)->GetStashSize() * XCDF_DATUM_WIDTH_BYTES;
+  }
+  return stashBytes;
+}
+
 /*
  * Read an event from the uncompressed buffer and then compress it to
  * the XCDFBlockData object.
@@ -520,9 +571,10 @@ void XCDFFile::ReadEvent() {
 
   blockEventCount_--;
   eventCount_++;
+  eventStamp_++;
 }
 
-bool XCDFFile::ReadNextBlock() {
+bool XCDFFile::ReadNextBlock(bool unpackData) {
 
   assert(IsReadable());
 
@@ -538,6 +590,7 @@ bool XCDFFile::ReadNextBlock() {
 
   } else if (currentFrame_.GetType() == XCDF_BLOCK_HEADER) {
 
+    currentBlockStartOffset_ = currentFrameStartOffset_;
     blockHeader_.UnpackFrame(currentFrame_);
 
     if (blockHeader_.GetNFieldHeaders() != GetNFields()) {
@@ -547,6 +600,7 @@ bool XCDFFile::ReadNextBlock() {
 
     // Reset each field
     FieldListForEach(ResetField);
+    eventStamp_++;
 
     // Update field sizes for the block.
     uint32_t i = 0;
@@ -555,7 +609,8 @@ bool XCDFFile::ReadNextBlock() {
                       it != blockHeader_.FieldHeadersEnd(); ++it) {
 
       fieldList_[i]->SetRawActiveMin(it->rawActiveMin_);
-      fieldList_[i]->SetActiveSize(it->activeSize_);
+      fieldList_[i]->SetActiveSize(
+                          static_cast<unsigned char>(it->activeSize_));
       i++;
     }
 
@@ -565,13 +620,20 @@ bool XCDFFile::ReadNextBlock() {
     // Get event count for next block
     blockEventCount_ = blockHeader_.GetEventCount();
 
-    ReadFrame();
+    AdviseNextBlock();
+    ReadFrame(unpackData);
 
     if (currentFrame_.GetType() != XCDF_BLOCK_DATA) {
       XCDFFatal("Block header not followed by data block at file offset: " <<
                                    currentFrameStartOffset_ << ". Aborting.");
     }
 
+    // Leave the data in currentFrame_ if it is only being copied
+    if (!unpackData) {
+      blockCount_++;
+      return true;
+    }
+
     // Shrink internal buffers if previous block > 150 MB
     if (blockData_.Capacity() > 150000000) {
       blockData_.Clear();
@@ -609,7 +671,7 @@ bool XCDFFile::ReadNextBlock() {
       }
 
       // Go on to the next data block
-      return ReadNextBlock();
+      return ReadNextBlock(unpackData);
 
     } else {
 
@@ -638,6 +700,28 @@ bool XCDFFile::ReadNextBlock() {
   return false;
 }
 
+/*
+ *  If the block table is loaded, tell the input stream that the block
+ *  after the current one will be read soon
+ */
+void XCDFFile::AdviseNextBlock() {
+
+  if (!blockTableComplete_) {
+    return;
+  }
+
+  std::vector<XCDFBlockEntry>::const_iterator next =
+      std::upper_bound(fileTrailer_.BlockEntriesBegin(),
+                       fileTrailer_.BlockEntriesEnd(),
+                       currentBlockStartOffset_, BlockStartsAfter);
+  if (next == fileTrailer_.BlockEntriesEnd() ||
+      next + 1 == fileTrailer_.BlockEntriesEnd()) {
+    return;
+  }
+  streamHandler_.WillNeed(next->filePtr_,
+                          (next + 1)->filePtr_ - next->filePtr_);
+}
+
 /*
  * Read blocks until we find one with events or we reach EOF
  */
@@ -680,6 +764,330 @@ int XCDFFile::Read() {
   return 1;
 }
 
+/*
+ *  Map each field in the file to its index in the destination, or -1
+ *  if it is not copied.  Return false if the destination can't be
+ *  filled by copying encoded data.
+ */
+bool XCDFFile::GetBlockCopyMap(const XCDFFile& destination,
+                               std::vector<int>& map) const {
+
+  map.assign(fieldList_.size(), -1);
+
+  // Encoded values depend on the values before them and can't be
+  // walked or copied one at a time
+  for (unsigned j = 0; j < fieldList_.size(); ++j) {
+    if (fieldList_[j]->GetEncoding() != XCDF_ENCODING_PLAIN) {
+      return false;
+    }
+  }
+
+  unsigned j = 0;
+  for (unsigned i = 0; i < destination.fieldList_.size(); ++i) {
+
+    const XCDFFieldDataBase& out = *destination.fieldList_[i];
+    while (j < fieldList_.size() &&
+           fieldList_[j]->GetName() != out.GetName()) {
+      ++j;
+    }
+
+    if (j == fieldList_.size()) {
+      return false;
+    }
+
+    const XCDFFieldDataBase& in = *fieldList_[j];
+    if (in.GetType() != out.GetType() ||
+        in.GetRawResolution() != out.GetRawResolution() ||
+        in.GetParentName() != out.GetParentName() ||
+        out.GetEncoding() != XCDF_ENCODING_PLAIN) {
+      return false;
+    }
+    map[j++] = i;
+  }
+  return true;
+}
+
+/*
+ *  Copy the remaining events of the current block bit-for-bit.  Events
+ *  are stored field after field, so each event is walked to find the
+ *  bits of each field: vector fields hold as many values as the sum of
+ *  their parent's values, which are the only values decoded.  The block
+ *  header values are reused as they are.
+ */
+uint64_t XCDFFile::CopyBlock(XCDFFile& destination) {
+
+  if (!IsReadable()) {
+    XCDFFatal("XCDF Copy Failed: File not opened for reading");
+  }
+
+  if (!destination.IsWritable()) {
+    XCDFFatal("XCDF Copy Failed: Destination not opened for writing");
+  }
+
+  std::vector<int> map;
+  if (!GetBlockCopyMap(destination, map)) {
+    XCDFFatal("XCDF Copy Failed: Destination fields do not match");
+  }
+
+  if (blockEventCount_ == 0 && !GetNextBlockWithEvents()) {
+    return 0;
+  }
+
+  // Write out any events already in the destination
+  if (destination.blockEventCount_ > 0) {
+    destination.WriteBlock();
+  }
+  destination.isModifiable_ = false;
+
+  uint32_t nEvents = blockEventCount_;
+  XCDFBlockHeader& outHeader = destination.blockHeader_;
+  XCDFBlockData& outData = destination.blockData_;
+  outHeader.Clear();
+  outData.Clear();
+  outHeader.SetEventCount(nEvents);
+
+  unsigned nFields = fieldList_.size();
+  std::vector<unsigned> sizes(nFields);
+  std::vector<int> parents(nFields, -1);
+  std::vector<bool> isParent(nFields, false);
+  std::vector<XCDFFieldDataBase*> outFields(nFields,
+                                       static_cast<XCDFFieldDataBase*>(NULL));
+  for (unsigned j = 0; j < nFields; ++j) {
+
+    sizes[j] = fieldList_[j]->GetActiveSize();
+    if (fieldList_[j]->HasParent()) {
+      const std::string& parentName = fieldList_[j]->GetParentName();
+      for (unsigned k = 0; k < j; ++k) {
+        if (fieldList_[k]->GetName() == parentName) {
+          parents[j] = k;
+          isParent[k] = true;
+          break;
+        }
+      }
+    }
+
+    if (map[j] >= 0) {
+      XCDFFieldHeader header;
+      header.rawActiveMin_ = fieldList_[j]->GetRawActiveMin();
+      header.activeSize_ = sizes[j];
+      outHeader.AddFieldHeader(header);
+      outFields[j] = &*destination.fieldList_[map[j]];
+      outFields[j]->SetRawBlockHeader(header.rawActiveMin_, sizes[j]);
+    }
+  }
+
+  // Sum of the values of each parent field in the current event
+  std::vector<uint64_t> sums(nFields, 0);
+  for (uint32_t i = 0; i < nEvents; ++i) {
+    for (unsigned j = 0; j < nFields; ++j) {
+
+      uint64_t count = parents[j] < 0 ? 1 : sums[parents[j]];
+      XCDFFieldDataBase* out = outFields[j];
+      if (!out && !isParent[j]) {
+        for (; count > 0; --count) {
+          blockData_.SkipDatum(sizes[j]);
+        }
+        continue;
+      }
+
+      // Parents are unsigned integer fields, so the value is
+      // min + resolution * datum
+      uint64_t min = fieldList_[j]->GetRawActiveMin();
+      uint64_t resolution = fieldList_[j]->GetRawResolution();
+      sums[j] = 0;
+      for (uint64_t k = 0; k < count; ++k) {
+        uint64_t datum = blockData_.GetDatum(sizes[j]);
+        if (isParent[j]) {
+          sums[j] += min + resolution * datum;
+        }
+        if (out) {
+          out->DumpRawValue(outData, datum);
+        }
+      }
+    }
+  }
+
+  eventCount_ += nEvents;
+  blockEventCount_ = 0;
+
+  // If header not written, write the header
+  if (!destination.headerWritten_) {
+    destination.fileHeader_.PackFrame(destination.currentFrame_);
+    destination.WriteFrame();
+    destination.headerWritten_ = true;
+  }
+
+  destination.eventCount_ += nEvents;
+  XCDFBlockEntry entry;
+  entry.nextEventNumber_ = destination.eventCount_ - nEvents;
+  entry.filePtr_ = destination.streamHandler_.GetOutputStream().tellp();
+  destination.fileTrailer_.AddBlockEntry(entry);
+
+  outHeader.PackFrame(destination.currentFrame_);
+  destination.WriteFrame();
+  outData.PackFrame(destination.currentFrame_);
+  destination.WriteFrame();
+
+  destination.FieldListForEach(ResetField);
+  destination.blockCount_++;
+  return nEvents;
+}
+
+/*
+ *  Copy the block frames of the file without decoding them.  Blocks
+ *  are found with ReadNextBlock(), which also follows the headers and
+ *  trailers of concatenated files, so the output has a single header,
+ *  block table and trailer.
+ */
+uint64_t XCDFFile::CopyFrames(XCDFFile& destination) {
+
+  if (!IsFrameCopyCompatible(destination)) {
+    XCDFFatal("XCDF Copy Failed: Files not compatible for frame copy");
+  }
+
+  // Write out any events already in the destination
+  if (destination.blockEventCount_ > 0) {
+    destination.WriteBlock();
+  }
+  destination.isModifiable_ = false;
+
+  // If header not written, write the header
+  if (!destination.headerWritten_) {
+    destination.fileHeader_.PackFrame(destination.currentFrame_);
+    destination.WriteFrame();
+    destination.headerWritten_ = true;
+  }
+
+  std::ostream& ostream = destination.streamHandler_.GetOutputStream();
+  uint64_t nEvents = 0;
+  while (ReadNextBlock(false)) {
+
+    uint32_t blockEvents = blockEventCount_;
+    eventCount_ += blockEvents;
+    blockEventCount_ = 0;
+
+    if (blockEvents == 0) {
+      continue;
+    }
+
+    destination.eventCount_ += blockEvents;
+    XCDFBlockEntry entry;
+    entry.nextEventNumber_ = destination.eventCount_ - blockEvents;
+    entry.filePtr_ = ostream.tellp();
+    destination.fileTrailer_.AddBlockEntry(entry);
+
+    blockHeader_.PackFrame(destination.currentFrame_);
+    destination.WriteFrame();
+    destination.currentFrame_.Swap(currentFrame_);
+    destination.WriteFrame();
+
+    destination.blockCount_++;
+    nEvents += blockEvents;
+  }
+
+  // All trailers have now been read.  Seekable inputs were checked in
+  // IsFrameCopyCompatible(); a streamed input can only get here without
+  // globals if it was written with the block table disabled.
+  if (!haveV3Globals_) {
+    XCDFFatal("XCDF Copy Failed: Field globals not found in file trailer");
+  }
+
+  for (unsigned i = 0; i < fieldList_.size(); ++i) {
+
+    const XCDFFieldDataBase& in = *fieldList_[i];
+    XCDFFieldDataBase& out = *destination.fieldList_[i];
+    if (in.GlobalsSet()) {
+      out.SetRawGlobalMin(in.GetRawGlobalMin());
+      out.SetRawGlobalMax(in.GetRawGlobalMax());
+    }
+    out.AddBitsProcessed(in.GetTotalBytes() << 3);
+  }
+
+  return nEvents;
+}
+
+/*
+ *  Walk the block frames with ReadNextBlock(), which verifies checksums
+ *  and frame ordering, and record where each block was found.  A block
+ *  holds at least the bits of its scalar fields, so the inflated size
+ *  can be bounded without decoding the vector field counts.  Only blocks
+ *  written plain are counted, as the encodings may take fewer bits.
+ */
+uint64_t XCDFFile::CheckFrames(bool inflate) {
+
+  if (!IsReadable()) {
+    XCDFFatal("XCDF Check Failed: File not opened for reading");
+  }
+
+  std::vector<XCDFBlockEntry> blocks;
+  while (ReadNextBlock(false)) {
+
+    uint64_t scalarBits = 0;
+    for (unsigned i = 0; i < fieldList_.size(); ++i) {
+      uint32_t size = fieldList_[i]->GetActiveSize();
+      if (size > XCDF_DATUM_WIDTH_BITS) {
+        XCDFFatal("Corrupt file: Field \"" << fieldList_[i]->GetName() <<
+                  "\" has invalid size " << size << " in block at offset " <<
+                  currentBlockStartOffset_);
+      }
+      if (!fieldList_[i]->HasParent() &&
+          fieldList_[i]->IsFixedWidthBlock()) {
+        scalarBits += size;
+      }
+    }
+
+    if (inflate) {
+      currentFrame_.Inflate();
+      if (8 * static_cast<uint64_t>(currentFrame_.GetDataSize()) <
+                                        scalarBits * blockEventCount_) {
+        XCDFFatal("Corrupt file: Data block at offset " <<
+                  currentFrameStartOffset_ << " is too short for " <<
+                  blockEventCount_ << " events");
+      }
+    }
+
+    XCDFBlockEntry entry;
+    entry.nextEventNumber_ = eventCount_;
+    entry.filePtr_ = currentBlockStartOffset_;
+    blocks.push_back(entry);
+
+    eventCount_ += blockEventCount_;
+    blockEventCount_ = 0;
+  }
+
+  // All trailers have now been read.  Compare against the block table,
+  // if one was written.
+  if (eventCount_ != fileTrailer_.GetTotalEventCount()) {
+    XCDFFatal("Corrupt file: Found " << eventCount_ <<
+              " events.  Expected " << fileTrailer_.GetTotalEventCount());
+  }
+
+  if (fileTrailer_.HasEntries()) {
+
+    if (blocks.size() != fileTrailer_.GetNBlockEntries()) {
+      XCDFFatal("Corrupt file: Found " << blocks.size() <<
+                " blocks.  Block table has " <<
+                fileTrailer_.GetNBlockEntries());
+    }
+
+    std::vector<XCDFBlockEntry>::const_iterator
+                               it = fileTrailer_.BlockEntriesBegin();
+    for (unsigned i = 0; i < blocks.size(); ++i, ++it) {
+
+      // Offsets are unknown if the stream can't report its position
+      bool checkOffset =
+                  static_cast<std::streamoff>(blocks[i].filePtr_) >= 0;
+      if (it->nextEventNumber_ != blocks[i].nextEventNumber_ ||
+          (checkOffset && it->filePtr_ != blocks[i].filePtr_)) {
+        XCDFFatal("Corrupt file: Block table entry " << i <<
+                  " does not match block at offset " << blocks[i].filePtr_);
+      }
+    }
+  }
+
+  return eventCount_;
+}
+
 /*
  *  Seek the istream to a new file position and check for failure.
  *  Return the status.
@@ -731,6 +1139,8 @@ void XCDFFile::ReadFileHeaders() {
 
     XCDFFieldType type = static_cast<XCDFFieldType>(it->type_);
     AllocateField(it->name_, type, it->rawResolution_, it->parentName_);
+    (*FindFieldByName(it->name_, true))->SetEncoding(
+                            static_cast<XCDFFieldEncoding>(it->encoding_));
   }
 
   // Load any aliases
@@ -852,9 +1262,11 @@ void XCDFFile::SetGlobals(const XCDFFileTrailer& trailer) {
     if (it->globalsSet_) {
       fieldList_[i]->SetRawGlobalMin(it->rawGlobalMin_);
       fieldList_[i]->SetRawGlobalMax(it->rawGlobalMax_);
-      fieldList_[i]->SetTotalBytes(
-                      fieldList_[i]->GetTotalBytes() + it->totalBytes_);
     }
+
+    /// A field with no values in range still takes up space
+    fieldList_[i]->SetTotalBytes(
+                    fieldList_[i]->GetTotalBytes() + it->totalBytes_);
     i++;
   }
 }
@@ -934,6 +1346,7 @@ bool XCDFFile::Rewind() {
   eventCount_ = 0;
   blockEventCount_ = 0;
   blockCount_ = 0;
+  eventStamp_++;
 
   // Get the header block out of the way
   ReadFrame();
@@ -957,6 +1370,7 @@ bool XCDFFile::Seek(uint64_t absoluteEventPos) {
   if (absoluteEventPos + 1 == eventCount_) {
     return true;
   }
+  eventStamp_++;
 
   // Check if event is in unread portion of current block.
   if (!(absoluteEventPos < eventCount_ + blockEventCount_ &&
@@ -1126,17 +1540,125 @@ void XCDFFile::CheckGlobals() {
   // Calculate the globals
   FieldListForEach(CalculateGlobals);
   haveV3Globals_ = true;
+  RestoreEvent(currentEventCount);
+}
+
+bool XCDFFile::LoadHeaderGlobals() {
+
+  if (haveHeaderGlobals_) {
+    return true;
+  }
+
+  if (!IsReadable()) {
+    return false;
+  }
+
+  // Bits used by each field, as the block headers give them
+  std::vector<uint64_t> bits(fieldList_.size(), 0);
+
+  if (blockTableComplete_ &&
+      fileTrailer_.BlockEntriesBegin() != fileTrailer_.BlockEntriesEnd()) {
+
+    // Visit only the block headers.  The current block is already
+    // unpacked, so we need only return the stream to where it was.
+    std::istream& istream = streamHandler_.GetInputStream();
+    std::streampos currentPos = istream.tellg();
+    std::streampos frameStartOffset = currentFrameStartOffset_;
+    std::streampos frameEndOffset = currentFrameEndOffset_;
+
+    XCDFBlockHeader header;
+    for (std::vector<XCDFBlockEntry>::const_iterator
+                        it = fileTrailer_.BlockEntriesBegin();
+                        it != fileTrailer_.BlockEntriesEnd(); ++it) {
+
+      if (!DoSeek(it->filePtr_)) {
+        DoSeek(currentPos);
+        return false;
+      }
+
+      ReadFrame();
+      if (currentFrame_.GetType() != XCDF_BLOCK_HEADER) {
+        XCDFFatal("Block header not found at file offset: " <<
+                               currentFrameStartOffset_ << ". Aborting.");
+      }
+      header.UnpackFrame(currentFrame_);
+      AddHeaderGlobals(header, bits);
+    }
+
+    DoSeek(currentPos);
+    currentFrameStartOffset_ = frameStartOffset;
+    currentFrameEndOffset_ = frameEndOffset;
+
+  } else {
+
+    // No block table.  Step through the blocks without unpacking them.
+    uint64_t currentEventCount = eventCount_;
+    if (!Rewind()) {
+      return false;
+    }
+
+    do {
+      AddHeaderGlobals(blockHeader_, bits);
+    } while (NextFrameExists() && ReadNextBlock(false));
+
+    RestoreEvent(currentEventCount);
+
+    // The trailers we passed may have had usable globals after all
+    if (haveV3Globals_) {
+      return false;
+    }
+  }
+
+  for (unsigned i = 0; i < fieldList_.size(); ++i) {
+    if (IsHeaderCounted(*fieldList_[i])) {
+      fieldList_[i]->SetTotalBytes(bits[i] >> 3);
+    }
+  }
+
+  haveHeaderGlobals_ = true;
+  return true;
+}
+
+void XCDFFile::AddHeaderGlobals(const XCDFBlockHeader& header,
+                                std::vector<uint64_t>& bits) {
+
+  if (header.GetNFieldHeaders() != GetNFields()) {
+    XCDFFatal("File corrupt: Unexpected number of block headers");
+  }
+
+  // Empty blocks hold no values
+  uint64_t nEvents = header.GetEventCount();
+  if (nEvents == 0) {
+    return;
+  }
+
+  uint32_t i = 0;
+  for (std::vector<XCDFFieldHeader>::const_iterator
+                    it = header.FieldHeadersBegin();
+                    it != header.FieldHeadersEnd(); ++it) {
+
+    uint32_t size = static_cast<unsigned char>(it->activeSize_);
+    fieldList_[i]->CheckBlockBounds(it->rawActiveMin_, size);
+    bits[i] += nEvents * size;
+    i++;
+  }
+}
+
+void XCDFFile::RestoreEvent(uint64_t eventCount) {
+
   // Return file to original position if possible
-  if (currentEventCount == 0) {
+  bool seekSuccess;
+  if (eventCount == 0) {
     seekSuccess = Rewind();
   } else {
-    seekSuccess = Seek(currentEventCount - 1);
+    seekSuccess = Seek(eventCount - 1);
   }
 
   if (!seekSuccess) {
     // Unable to return to previous state
     eventCount_ = GetEventCount() + 1;
     blockEventCount_ = 0;
+    eventStamp_++;
   }
 }
 
@@ -14,6 +14,8 @@
 #include <XCDFHeaderVisitor.h>
 #include <XCDFTupleSetter.h>
 #include <XCDFFieldsByNameSelector.h>
+#include <XCDFColumnReader.h>
+#include <XCDFColumnWriter.h>
 
 #include <structmember.h>
 #include <string.h>
@@ -23,16 +25,44 @@
 
 // ___________________________________
 // Expose parts of XCDFFile to python \_________________________________________
+//
+// Thread safety: reading, seeking and decoding are done with the GIL
+// released, so python threads using different XCDFFile objects run in
+// parallel.  An XCDFFile object and the iterators created from it share one
+// file position and must be used by one thread at a time.  Using a file
+// while another thread is reading it raises XCDFException.
 typedef struct {
   PyObject_HEAD
   PyObject* filename_;    // XCDF filename (a python string)
   XCDFFile* file_;        // an XCDF file instance
+  int busy_;              // set while the GIL is released to use file_
 } pyxcdf_XCDFFile;
 
 
 // XCDFException object
 PyObject* pyxcdf_XCDFException;
 
+// Mark a file in use before releasing the GIL.  The flag is only changed
+// with the GIL held.  Return false and set an exception if the file is
+// already in use by another thread.
+static bool
+XCDFFile_acquire(pyxcdf_XCDFFile* self)
+{
+  if (self->busy_) {
+    PyErr_SetString(pyxcdf_XCDFException,
+                    "file: in use by another thread");
+    return false;
+  }
+  self->busy_ = 1;
+  return true;
+}
+
+static void
+XCDFFile_release(pyxcdf_XCDFFile* self)
+{
+  self->busy_ = 0;
+}
+
 
 // Python XCDFFile allocator
 static PyObject*
@@ -50,6 +80,7 @@ XCDFFile_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
       return NULL;
     }
     self->file_ = NULL;
+    self->busy_ = 0;
   }
   return (PyObject*)self;
 }
@@ -85,17 +116,33 @@ XCDFFile_init(pyxcdf_XCDFFile* self, PyObject* args)
     else
       strcpy(mode, "R");
 
+    #if PY_MAJOR_VERSION >= 3
+    const char* name = PyBytes_AsString(filename);
+    #else
+    const char* name = PyString_AsString(filename);
+    #endif
+
+    if (!XCDFFile_acquire(self))
+      return -1;
+
+    XCDFFile* file = NULL;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
     try {
-      #if PY_MAJOR_VERSION >= 3
-      self->file_ = new XCDFFile(PyBytes_AsString(filename), mode);
-      #else
-      self->file_ = new XCDFFile(PyString_AsString(filename), mode);
-      #endif
+      file = new XCDFFile(name, mode);
     }
     catch (const XCDFException& e) {
-      PyErr_SetString(pyxcdf_XCDFException, e.GetMessage().c_str());
+      error = e.GetMessage();
+    }
+    Py_END_ALLOW_THREADS
+    XCDFFile_release(self);
+
+    if (!file) {
+      PyErr_SetString(pyxcdf_XCDFException, error.c_str());
       return -1;
     }
+    delete self->file_;
+    self->file_ = file;
   }
 
   return 0;
@@ -131,6 +178,7 @@ typedef std::vector<XCDFFieldDescriptor>::const_iterator XCDFDescriptorIterator;
 
 typedef struct {
   PyObject_HEAD
+  pyxcdf_XCDFFile* owner_;              // python file object (referenced)
   XCDFFile* file_;                      // pointer to current open XCDF file
   int iCurrent_;                        // current record being read
   int iTotal_;                          // total number of records in file
@@ -147,6 +195,7 @@ XCDFRecordIterator_init(XCDFRecordIterator* self, PyObject* args) {
     delete self->selectField_;
   }
   self->selectField_ = NULL;
+  Py_CLEAR(self->owner_);
   self->file_ = NULL;
   self->iCurrent_ = self->iTotal_ = 0;
   return 0;
@@ -158,6 +207,7 @@ XCDFRecordIterator_dealloc(XCDFRecordIterator* self) {
   if (self->selectField_) {
     delete self->selectField_;
   }
+  Py_XDECREF(self->owner_);
   #if PY_MAJOR_VERSION >= 3
   Py_TYPE(self)->tp_free((PyObject*)self);
   #else
@@ -173,59 +223,80 @@ XCDFRecordIterator_iter(PyObject* self)
   return self;
 }
 
+// Read up to the next selected record.  Return false at the end of the file.
+// Does not use the python API, so it is called with the GIL released.
+static bool
+XCDFRecordIterator_read(XCDFRecordIterator* p)
+{
+  for (;;) {
+
+    // If we have not reached the end of the file:
+    if (p->iCurrent_ < p->iTotal_ && p->file_->Read() > 0)
+    {
+      p->iCurrent_ = p->file_->GetCurrentEventNumber();
+      if (p->iCurrent_ < 0) {
+        return false;
+      }
+
+      // Check if we should select this event
+      if (p->selectEvent_.SelectEvent()) {
+        return true;
+      }
+    }
+    // When reaching EOF, rewind the XCDF file and stop the iterator
+    else {
+      p->file_->Rewind();
+      return false;
+    }
+  }
+}
+
 // Define next() for iteration over XCDF records
 PyObject*
 XCDFRecordIterator_iternext(PyObject* self)
 {
   XCDFRecordIterator* p = (XCDFRecordIterator*)self;
 
+  if (!XCDFFile_acquire(p->owner_)) {
+    return NULL;
+  }
+
+  bool found = false;
+  bool failed = false;
+  std::string error;
+  Py_BEGIN_ALLOW_THREADS
   try {
+    found = XCDFRecordIterator_read(p);
+  } catch (const XCDFException& e) {
+    failed = true;
+    error = e.GetMessage();
+  }
+  Py_END_ALLOW_THREADS
 
-    for (;;) {
+  PyObject* result = NULL;
+  try {
+    if (failed) {
+      PyErr_SetString(pyxcdf_XCDFException, error.c_str());
+    } else if (!found) {
+      PyErr_SetNone(PyExc_StopIteration);
+    } else if (p->selectField_) {
 
-      // If we have not reached the end of the file:
-      if (p->iCurrent_ < p->iTotal_ && p->file_->Read() > 0)
-      {
-        p->iCurrent_ = p->file_->GetCurrentEventNumber();
-        if (p->iCurrent_ < 0) {
-          PyErr_SetNone(PyExc_StopIteration);
-          return NULL;
-        }
-
-        // Check if we should select this event
-        if (!p->selectEvent_.SelectEvent()) {
-          continue;
-        }
-
-        if (p->selectField_) {
-
-          // We have a list of fields to extract
-          return p->selectField_->GetTuple();
-        } else {
-
-          // Keep all fields.
-          // Create a field visitor to stuff data into a tuple
-          TupleSetter tsetter(p->file_->GetNFields());
-          p->file_->ApplyFieldVisitor(tsetter);
-
-          PyObject* result(tsetter.GetTuple());
-          return result;
-        }
-      }
-      // When reaching EOF, rewind the XCDF file and stop the iterator
-      else {
-        p->file_->Rewind();
-        PyErr_SetNone(PyExc_StopIteration);
-        return NULL;
-      }
+      // We have a list of fields to extract
+      result = p->selectField_->GetTuple();
+    } else {
+
+      // Keep all fields.
+      // Create a field visitor to stuff data into a tuple
+      TupleSetter tsetter(p->file_->GetNFields());
+      p->file_->ApplyFieldVisitor(tsetter);
+      result = tsetter.GetTuple();
     }
   } catch (const XCDFException& e) {
     PyErr_SetString(pyxcdf_XCDFException, e.GetMessage().c_str());
-    return NULL;
   }
 
-  // Should never be reached
-  return NULL;
+  XCDFFile_release(p->owner_);
+  return result;
 }
 
 // Definition of the record iterator type for python
@@ -280,6 +351,7 @@ XCDFRecordIteratorType =
 // XCDFFile field iterator \____________________________________________________
 typedef struct {
   PyObject_HEAD
+  pyxcdf_XCDFFile* owner_;              // python file object (referenced)
   XCDFFile* file_;                      // pointer to current open XCDF file
   int iCurrent_;                        // current record being read
   int iTotal_;                          // total number of records in file
@@ -294,6 +366,7 @@ XCDFFieldIterator_init(XCDFFieldIterator* self, PyObject* args) {
     delete self->selector_;
   }
   self->selector_ = NULL;
+  Py_CLEAR(self->owner_);
   self->file_ = NULL;
   self->iCurrent_ = self->iTotal_ = 0;
   return 0;
@@ -305,6 +378,7 @@ XCDFFieldIterator_dealloc(XCDFFieldIterator* self) {
   if (self->selector_) {
     delete self->selector_;
   }
+  Py_XDECREF(self->owner_);
   #if PY_MAJOR_VERSION >= 3
   Py_TYPE(self)->tp_free((PyObject*)self);
   #else
@@ -320,34 +394,56 @@ XCDFFieldIterator_iter(PyObject* self)
   return self;
 }
 
+// Read the next record.  Return false at the end of the file.  Does not use
+// the python API, so it is called with the GIL released.
+static bool
+XCDFFieldIterator_read(XCDFFieldIterator* p)
+{
+  // If we have not reached the end of the file:
+  if (p->iCurrent_ < p->iTotal_ && p->file_->Read() > 0)
+  {
+    p->iCurrent_ = p->file_->GetCurrentEventNumber();
+    return p->iCurrent_ >= 0;
+  }
+
+  // When reaching EOF, rewind the XCDF file and stop the iterator
+  p->file_->Rewind();
+  return false;
+}
+
 // Define next() for iteration over XCDF fields
 PyObject*
 XCDFFieldIterator_iternext(PyObject* self)
 {
   XCDFFieldIterator* p = (XCDFFieldIterator*)self;
 
-  try {
+  if (!XCDFFile_acquire(p->owner_)) {
+    return NULL;
+  }
 
-    // If we have not reached the end of the file:
-    if (p->iCurrent_ < p->iTotal_ && p->file_->Read() > 0)
-    {
-      p->iCurrent_ = p->file_->GetCurrentEventNumber();
-      if (p->iCurrent_ < 0) {
-        PyErr_SetNone(PyExc_StopIteration);
-        return NULL;
-      }
-      return p->selector_->GetTuple();
-    }
-    // When reaching EOF, rewind the XCDF file and stop the iterator
-    else {
-      p->file_->Rewind();
-      PyErr_SetNone(PyExc_StopIteration);
-      return NULL;
-    }
+  bool found = false;
+  bool failed = false;
+  std::string error;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    found = XCDFFieldIterator_read(p);
   } catch (const XCDFException& e) {
-    PyErr_SetString(pyxcdf_XCDFException, e.GetMessage().c_str());
-    return NULL;
+    failed = true;
+    error = e.GetMessage();
   }
+  Py_END_ALLOW_THREADS
+
+  PyObject* result = NULL;
+  if (failed) {
+    PyErr_SetString(pyxcdf_XCDFException, error.c_str());
+  } else if (!found) {
+    PyErr_SetNone(PyExc_StopIteration);
+  } else {
+    result = p->selector_->GetTuple();
+  }
+
+  XCDFFile_release(p->owner_);
+  return result;
 }
 
 // Definition of the field iterator type for python
@@ -398,6 +494,110 @@ XCDFFieldIteratorType =
     PyType_GenericNew,                          // tp_new
 };
 
+// ______________________________________
+// Column of values with a buffer export \______________________________________
+typedef struct {
+  PyObject_HEAD
+  std::vector<uint64_t>* data_;         // column values (owned)
+  char format_[2];                      // struct format of one value
+  Py_ssize_t shape_;                    // number of values
+  Py_ssize_t stride_;                   // size of one value
+} XCDFColumn;
+
+// Define __del__
+static void
+XCDFColumn_dealloc(XCDFColumn* self) {
+  delete self->data_;
+  #if PY_MAJOR_VERSION >= 3
+  Py_TYPE(self)->tp_free((PyObject*)self);
+  #else
+  self->ob_type->tp_free((PyObject*)self);
+  #endif
+}
+
+// Expose the values as a 1-d array of numbers, e.g. to numpy.asarray
+static int
+XCDFColumn_getbuffer(XCDFColumn* self, Py_buffer* view, int flags)
+{
+  view->obj = (PyObject*)self;
+  Py_INCREF(self);
+  view->buf = self->data_->empty() ? NULL : &(*self->data_)[0];
+  view->len = self->shape_ * self->stride_;
+  view->readonly = 0;
+  view->itemsize = self->stride_;
+  view->format = (flags & PyBUF_FORMAT) ? self->format_ : NULL;
+  view->ndim = 1;
+  view->shape = (flags & PyBUF_ND) ? &self->shape_ : NULL;
+  view->strides =
+    ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? &self->stride_ : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
+}
+
+static Py_ssize_t
+XCDFColumn_length(XCDFColumn* self)
+{
+  return self->shape_;
+}
+
+// Buffer and sequence slots are filled in at module initialization, since
+// the layout of PyBufferProcs differs between python 2 and 3
+static PyBufferProcs XCDFColumn_as_buffer;
+static PySequenceMethods XCDFColumn_as_sequence;
+
+// Definition of the column type for python
+static PyTypeObject
+XCDFColumnType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pyxcdf.Column",                            // tp_name
+    sizeof(XCDFColumn),                         // tp_basicsize
+    0,                                          // tp_itemsize
+    (destructor)XCDFColumn_dealloc,             // tp_dealloc
+    0,                                          // tp_print
+    0,                                          // tp_getattr
+    0,                                          // tp_setattr
+    0,                                          // tp_reserved
+    0,                                          // tp_repr
+    0,                                          // tp_as_number
+    &XCDFColumn_as_sequence,                    // tp_as_sequence
+    0,                                          // tp_as_mapping
+    0,                                          // tp_hash
+    0,                                          // tp_call
+    0,                                          // tp_str
+    0,                                          // tp_getattro
+    0,                                          // tp_setattro
+    &XCDFColumn_as_buffer,                      // tp_as_buffer
+    #if PY_MAJOR_VERSION >= 3
+    Py_TPFLAGS_DEFAULT,                         // tp_flags
+    #else
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, // tp_flags
+    #endif
+    "Column of XCDF values supporting the buffer protocol", // tp_doc
+};
+
+// Wrap a column of values read from a file.  The values, packed as the
+// given number of values of the given size, are taken from the vector,
+// which is left empty.
+static PyObject*
+XCDFColumn_new(std::vector<uint64_t>& values, const char format,
+               uint64_t count, unsigned size)
+{
+  XCDFColumn* column =
+    (XCDFColumn*)XCDFColumnType.tp_alloc(&XCDFColumnType, 0);
+  if (column == NULL) {
+    return NULL;
+  }
+  column->data_ = new std::vector<uint64_t>();
+  column->data_->swap(values);
+  column->format_[0] = format;
+  column->format_[1] = '\0';
+  column->shape_ = count;
+  column->stride_ = size;
+  return (PyObject*)column;
+}
+
 // __________________________
 // XCDFFile member functions \__________________________________________________
 
@@ -479,6 +679,8 @@ XCDFRecord_iterator(pyxcdf_XCDFFile* self, PyObject* args, PyObject* kwargs)
       return NULL;
     }
 
+    Py_INCREF(self);
+    it->owner_ = self;
     it->file_ = self->file_;
     it->iCurrent_ = 0;
     it->iTotal_ = self->file_->GetEventCount();
@@ -523,6 +725,8 @@ XCDFField_iterator(pyxcdf_XCDFFile* self, PyObject* fieldName)
       return NULL;
     }
 
+    Py_INCREF(self);
+    it->owner_ = self;
     it->file_ = self->file_;
     it->iCurrent_ = 0;
     it->iTotal_ = self->file_->GetEventCount();
@@ -562,16 +766,33 @@ XCDFFile_getRecord(pyxcdf_XCDFFile* self, PyObject* args)
     return NULL;
   }
 
-  PyObject* result = NULL;
+  // Seek to a given record ID in the file
+  #if PY_MAJOR_VERSION >= 3
+  uint64_t id = PyLong_AsUnsignedLongLongMask(recordId);
+  #else
+  uint64_t id = PyInt_AsUnsignedLongLongMask(recordId);
+  #endif
+
+  if (!XCDFFile_acquire(self)) {
+    return NULL;
+  }
+
+  bool found = false;
+  bool failed = false;
+  std::string error;
+  Py_BEGIN_ALLOW_THREADS
   try {
-    // Seek to a given record ID in the file
-    #if PY_MAJOR_VERSION >= 3
-    uint64_t id = PyLong_AsUnsignedLongLongMask(recordId);
-    #else
-    uint64_t id = PyInt_AsUnsignedLongLongMask(recordId);
-    #endif
+    found = self->file_->Seek(id);
+  }
+  catch (const XCDFException& e) {
+    failed = true;
+    error = e.GetMessage();
+  }
+  Py_END_ALLOW_THREADS
 
-    if (self->file_->Seek(id)) {
+  PyObject* result = NULL;
+  try {
+    if (found) {
 
       if (fields == NULL) {
 
@@ -592,21 +813,350 @@ XCDFFile_getRecord(pyxcdf_XCDFFile* self, PyObject* args)
         result = selector.GetTuple();
       }
 
-      self->file_->Rewind();
+      Py_BEGIN_ALLOW_THREADS
+      try {
+        self->file_->Rewind();
+      }
+      catch (const XCDFException& e) {
+        failed = true;
+        error = e.GetMessage();
+      }
+      Py_END_ALLOW_THREADS
     }
-    else {
+    else if (!failed) {
       std::stringstream errMsg;
       errMsg << "Invalid event number " << id;
       PyErr_SetString(pyxcdf_XCDFException, errMsg.str().c_str());
     }
+  }
+  catch (const XCDFException& e) {
+    failed = true;
+    error = e.GetMessage();
+  }
+
+  XCDFFile_release(self);
+  if (failed) {
+    PyErr_SetString(pyxcdf_XCDFException, error.c_str());
+    Py_XDECREF(result);
+    return NULL;
+  }
+  return result;
+}
+
+// Get a field name or expression passed as bytes or as a string
+static bool
+python2string(PyObject* obj, std::string& str)
+{
+  if (PyBytes_Check(obj)) {
+    str = PyBytes_AsString(obj);
+    return true;
+  }
+  if (PyUnicode_Check(obj)) {
+    PyObject* bytes = PyUnicode_AsUTF8String(obj);
+    if (bytes == NULL) {
+      return false;
+    }
+    str = PyBytes_AsString(bytes);
+    Py_DECREF(bytes);
+    return true;
+  }
+  PyErr_SetString(PyExc_TypeError, "expected a string");
+  return false;
+}
 
-    return result;
+// Function to read whole fields into columns supporting the buffer protocol.
+// The file is decoded with the GIL released.
+static PyObject*
+XCDFFile_readColumns(pyxcdf_XCDFFile* self, PyObject* args, PyObject* kwargs)
+{
+  // Make sure the XCDF file is valid
+  if (self->file_ == NULL) {
+    PyErr_SetString(PyExc_AttributeError, "file: not open");
+    return NULL;
+  }
+
+  PyObject* fields = NULL;
+  unsigned long long start = 0;
+  PyObject* stop = NULL;
+  PyObject* selection = NULL;
+  PyObject* narrow = NULL;
+  char *kwlist[] = {const_cast<char*>("fields"),
+                    const_cast<char*>("start"),
+                    const_cast<char*>("stop"),
+                    const_cast<char*>("selection"),
+                    const_cast<char*>("narrow"),
+                    NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|KOOO", kwlist,
+                                   &fields, &start, &stop, &selection,
+                                   &narrow)) {
+    return NULL;
+  }
+
+  int narrowTypes = narrow ? PyObject_IsTrue(narrow) : 0;
+  if (narrowTypes < 0) {
+    return NULL;
+  }
+
+  PyObject* names = PySequence_Fast(fields,
+      "read_columns(fields, [start=0, stop=None, selection=\"expression\", "
+      "narrow=False])");
+  if (names == NULL) {
+    return NULL;
+  }
+
+  std::vector<std::string> nameList(PySequence_Fast_GET_SIZE(names));
+  for (unsigned i = 0; i < nameList.size(); ++i) {
+    if (!python2string(PySequence_Fast_GET_ITEM(names, i), nameList[i])) {
+      Py_DECREF(names);
+      return NULL;
+    }
+  }
+
+  uint64_t stopEvent = std::numeric_limits<uint64_t>::max();
+  if (stop && stop != Py_None) {
+    stopEvent = PyLong_AsUnsignedLongLong(stop);
+    if (PyErr_Occurred()) {
+      Py_DECREF(names);
+      return NULL;
+    }
+  }
+
+  std::string selectExpression("true");
+  if (selection && selection != Py_None &&
+      !python2string(selection, selectExpression)) {
+    Py_DECREF(names);
+    return NULL;
+  }
+
+  if (!XCDFFile_acquire(self)) {
+    Py_DECREF(names);
+    return NULL;
+  }
+
+  ColumnReader* reader = NULL;
+  bool failed = false;
+  std::string error;
+  try {
+    reader = new ColumnReader(nameList, *(self->file_));
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+      if (narrowTypes) {
+        reader->SetNarrowestValueSizes();
+      }
+      reader->Read(start, stopEvent, selectExpression);
+    }
+    catch (const XCDFException& e) {
+      failed = true;
+      error = e.GetMessage();
+    }
+    Py_END_ALLOW_THREADS
+  }
+  catch (const XCDFException& e) {
+    failed = true;
+    error = e.GetMessage();
+  }
+  XCDFFile_release(self);
+
+  if (failed) {
+    PyErr_SetString(pyxcdf_XCDFException, error.c_str());
+    delete reader;
+    Py_DECREF(names);
+    return NULL;
+  }
+
+  // Return {name: column} or {name: (values, offsets)} for vector fields,
+  // keyed by the name objects passed in
+  PyObject* result = PyDict_New();
+  for (unsigned i = 0; result && i < reader->GetNColumns(); ++i) {
+
+    PyObject* column = XCDFColumn_new(reader->GetValues(i),
+                                      reader->GetFormat(i),
+                                      reader->GetNValues(i),
+                                      reader->GetValueSize(i));
+    if (column && reader->IsVector(i)) {
+      std::vector<uint64_t>& eventOffsets = reader->GetOffsets(i);
+      PyObject* offsets = XCDFColumn_new(eventOffsets, 'Q',
+                                         eventOffsets.size(),
+                                         sizeof(uint64_t));
+      PyObject* pair = offsets ? PyTuple_Pack(2, column, offsets) : NULL;
+      Py_XDECREF(offsets);
+      Py_DECREF(column);
+      column = pair;
+    }
+
+    if (column == NULL ||
+        PyDict_SetItem(result, PySequence_Fast_GET_ITEM(names, i), column)) {
+      Py_XDECREF(column);
+      Py_DECREF(result);
+      result = NULL;
+      break;
+    }
+    Py_DECREF(column);
+  }
+
+  delete reader;
+  Py_DECREF(names);
+  return result;
+}
+
+// Get a 1-d array of native values through the buffer protocol.  Return the
+// struct format character of the values, or 0 with an exception set.
+static char
+XCDFFile_getArray(PyObject* obj,
+                  Py_buffer* view,
+                  std::vector<Py_buffer*>& views)
+{
+  if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+    return 0;
+  }
+  views.push_back(view);
+
+  // Accept native formats, optionally with an explicit byte order prefix
+  // that matches the host
+  const char* format = view->format ? view->format : "B";
+  if (*format == '@' || *format == '=' || *format == '<') {
+    ++format;
+  }
+  if (view->ndim != 1 || format[0] == '\0' || format[1] != '\0' ||
+      ColumnWriter::GetFormatSize(format[0]) != (unsigned)view->itemsize) {
+    PyErr_Format(PyExc_TypeError,
+                 "write_columns: unsupported array format \"%s\"",
+                 view->format ? view->format : "B");
+    return 0;
+  }
+  return format[0];
+}
+
+// Function to write events from a dictionary of columns supporting the
+// buffer protocol, e.g. numpy arrays.  Vector fields take the flat array of
+// values, or (values, counts).  The events are written with the GIL
+// released.
+static PyObject*
+XCDFFile_writeColumns(pyxcdf_XCDFFile* self, PyObject* columns)
+{
+  // Make sure the XCDF file is valid
+  if (self->file_ == NULL) {
+    PyErr_SetString(PyExc_AttributeError, "file: not open");
+    return NULL;
+  }
+
+  if (!PyDict_Check(columns)) {
+    PyErr_SetString(PyExc_TypeError,
+                    "write_columns({name: values, "
+                    "vector name: (values, counts)})");
+    return NULL;
+  }
+
+  std::vector<Py_buffer> buffers(2 * PyDict_Size(columns));
+  std::vector<Py_buffer*> views;
+  ColumnWriter* writer = new ColumnWriter(*(self->file_));
+  bool ok = true;
+
+  try {
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    for (unsigned i = 0; ok && PyDict_Next(columns, &pos, &key, &value);
+                                                                    ++i) {
+      std::string name;
+      ok = python2string(key, name);
+
+      PyObject* counts = NULL;
+      if (ok && PyTuple_Check(value)) {
+        ok = PyArg_ParseTuple(value, "OO", &value, &counts);
+      }
+
+      char format = 0;
+      if (ok) {
+        format = XCDFFile_getArray(value, &buffers[2 * i], views);
+        ok = format != 0;
+      }
+
+      char countFormat = 'Q';
+      if (ok && counts) {
+        countFormat = XCDFFile_getArray(counts, &buffers[2 * i + 1], views);
+        ok = countFormat != 0;
+      }
+
+      if (ok) {
+        writer->AddColumn(name,
+                          buffers[2 * i].buf,
+                          buffers[2 * i].shape[0],
+                          format,
+                          counts ? buffers[2 * i + 1].buf : NULL,
+                          counts ? buffers[2 * i + 1].shape[0] : 0,
+                          countFormat);
+      }
+    }
   }
   catch (const XCDFException& e) {
     PyErr_SetString(pyxcdf_XCDFException, e.GetMessage().c_str());
-    Py_XDECREF(result);
+    ok = false;
+  }
+
+  uint64_t nEvents = 0;
+  if (ok && (ok = XCDFFile_acquire(self))) {
+
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+      nEvents = writer->Write();
+    }
+    catch (const XCDFException& e) {
+      ok = false;
+      error = e.GetMessage();
+    }
+    Py_END_ALLOW_THREADS
+    XCDFFile_release(self);
+
+    if (!ok) {
+      PyErr_SetString(pyxcdf_XCDFException, error.c_str());
+    }
+  }
+
+  for (unsigned i = 0; i < views.size(); ++i) {
+    PyBuffer_Release(views[i]);
+  }
+  delete writer;
+
+  if (!ok) {
     return NULL;
   }
+  return PyLong_FromUnsignedLongLong(nEvents);
+}
+
+// Function to close the file, writing any buffered events
+static PyObject*
+XCDFFile_close(pyxcdf_XCDFFile* self)
+{
+  if (self->file_ == NULL) {
+    Py_RETURN_NONE;
+  }
+
+  if (!XCDFFile_acquire(self)) {
+    return NULL;
+  }
+
+  bool failed = false;
+  std::string error;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    self->file_->Close();
+  }
+  catch (const XCDFException& e) {
+    failed = true;
+    error = e.GetMessage();
+  }
+  Py_END_ALLOW_THREADS
+  XCDFFile_release(self);
+
+  if (failed) {
+    PyErr_SetString(pyxcdf_XCDFException, error.c_str());
+    return NULL;
+  }
+  Py_RETURN_NONE;
 }
 
 static PyObject*
@@ -703,14 +1253,35 @@ static PyMethodDef XCDFFile_methods[] =
     const_cast<char*>("Get a record by number from the file") },
 
   { const_cast<char*>("records"), (PyCFunction)XCDFRecord_iterator,
-    METH_KEYWORDS,
+    METH_VARARGS | METH_KEYWORDS,
     const_cast<char*>("Iterator over XCDF records") },
 
+  { const_cast<char*>("read_columns"), (PyCFunction)XCDFFile_readColumns,
+    METH_VARARGS | METH_KEYWORDS,
+    const_cast<char*>("Read a list of fields into columns supporting the "
+                      "buffer protocol, e.g. for numpy.asarray.  Vector "
+                      "fields are returned as (values, offsets).  Optional "
+                      "start, stop and selection limit the events read.  "
+                      "With narrow=True, values are stored in the smallest "
+                      "integer or float type that holds the field without "
+                      "loss.") },
+
   { const_cast<char*>("fields"), (PyCFunction)XCDFField_iterator,
     METH_O,
     const_cast<char*>("Iterator over one or more XCDF fields (comma-separated "
                       "by name)") },
 
+  { const_cast<char*>("write_columns"), (PyCFunction)XCDFFile_writeColumns,
+    METH_O,
+    const_cast<char*>("Write events from a dictionary of field columns "
+                      "supporting the buffer protocol, e.g. numpy arrays.  "
+                      "Vector fields take the flat array of values, or "
+                      "(values, counts).  Every field must be given.") },
+
+  { const_cast<char*>("close"), (PyCFunction)XCDFFile_close,
+    METH_NOARGS,
+    const_cast<char*>("Close the file, writing any buffered events") },
+
   { const_cast<char*>("addField"), (PyCFunction)XCDFFile_addField,
     METH_VARARGS,
     const_cast<char*>("Add a field with a given name, XCDF type, and optional "
@@ -817,60 +1388,79 @@ static PyMethodDef pyxcdf_methods[] =
 
 // _________________________
 // Python module definition \___________________________________________________
+
+// Prepare the types defined in this module.  Return false on failure.
+static bool
+pyxcdf_ready_types()
+{
+  XCDFColumn_as_buffer.bf_getbuffer = (getbufferproc)XCDFColumn_getbuffer;
+  XCDFColumn_as_sequence.sq_length = (lenfunc)XCDFColumn_length;
+
+  return PyType_Ready(&pyxcdf_XCDFFileType) >= 0 &&
+         PyType_Ready(&XCDFRecordIteratorType) >= 0 &&
+         PyType_Ready(&XCDFFieldIteratorType) >= 0 &&
+         PyType_Ready(&XCDFColumnType) >= 0;
+}
+
+// Add the types, exception and constants to the module
+static void
+pyxcdf_add_objects(PyObject* module)
+{
+  // Add XCDFFile type to the module dictionary
+  Py_INCREF(&pyxcdf_XCDFFileType);
+  PyModule_AddObject(module, "XCDFFile", (PyObject*)&pyxcdf_XCDFFileType);
+
+  Py_INCREF(&XCDFColumnType);
+  PyModule_AddObject(module, "Column", (PyObject*)&XCDFColumnType);
+
+  // Add XCDFException
+  pyxcdf_XCDFException = PyErr_NewException(
+             const_cast<char*>("pyxcdf.XCDFException"), NULL, NULL);
+  Py_INCREF(pyxcdf_XCDFException);
+  PyModule_AddObject(module, "XCDFException", pyxcdf_XCDFException);
+
+  // Add XCDF enum types to the module
+  PyModule_AddIntConstant(module, "XCDF_SIGNED_INTEGER",
+                                  int(XCDF_SIGNED_INTEGER));
+  PyModule_AddIntConstant(module, "XCDF_UNSIGNED_INTEGER",
+                                  int(XCDF_UNSIGNED_INTEGER));
+  PyModule_AddIntConstant(module, "XCDF_FLOATING_POINT",
+                                  int(XCDF_FLOATING_POINT));
+}
+
 #if PY_MAJOR_VERSION >= 3
   static struct PyModuleDef pyxcdfModule = {
     PyModuleDef_HEAD_INIT,
     "pyxcdf",                 // m_name
-    NULL,                   // m_doc
+    "Python bindings to XCDF library.", // m_doc
     -1,                       // m_size
+    pyxcdf_methods,           // m_methods
   };
 
   PyMODINIT_FUNC
   PyInit_pyxcdf(void)
   {
+    // Enable creation of new XCDFFile objects
+    if (!pyxcdf_ready_types())
+      return NULL;
+
     PyObject* module = PyModule_Create(&pyxcdfModule);
     if (!module)
       return NULL;
 
-    pyxcdf_XCDFException = PyErr_NewException(
-           const_cast<char*>("pyxcdf.XCDFException"), NULL, NULL);
-    Py_INCREF(pyxcdf_XCDFException);
-    PyModule_AddObject(module, "XCDFException", pyxcdf_XCDFException);
+    pyxcdf_add_objects(module);
+    return module;
   }
 #else
   PyMODINIT_FUNC
   initpyxcdf(void)
   {
     // Enable creation of new XCDFFile objects
-    if (PyType_Ready(&pyxcdf_XCDFFileType) < 0)
-      return;
-
-    if (PyType_Ready(&XCDFRecordIteratorType) < 0)
-      return;
-
-    if (PyType_Ready(&XCDFFieldIteratorType) < 0)
+    if (!pyxcdf_ready_types())
       return;
 
     PyObject* module = Py_InitModule3("pyxcdf", pyxcdf_methods,
                                       "Python bindings to XCDF library.");
-
-    // Add XCDFFile type to the module dictionary
-    Py_INCREF(&pyxcdf_XCDFFileType);
-    PyModule_AddObject(module, "XCDFFile", (PyObject*)&pyxcdf_XCDFFileType);
-
-    // Add XCDFException
-    pyxcdf_XCDFException = PyErr_NewException(
-               const_cast<char*>("pyxcdf.XCDFException"), NULL, NULL);
-    Py_INCREF(pyxcdf_XCDFException);
-    PyModule_AddObject(module, "XCDFException", pyxcdf_XCDFException);
-
-    // Add XCDF enum types to the module
-    PyModule_AddIntConstant(module, "XCDF_SIGNED_INTEGER",
-                                    int(XCDF_SIGNED_INTEGER));
-    PyModule_AddIntConstant(module, "XCDF_UNSIGNED_INTEGER",
-                                    int(XCDF_UNSIGNED_INTEGER));
-    PyModule_AddIntConstant(module, "XCDF_FLOATING_POINT",
-                                    int(XCDF_FLOATING_POINT));
+    pyxcdf_add_objects(module);
   }
 #endif
-
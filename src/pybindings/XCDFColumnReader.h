@@ -0,0 +1,223 @@
+/*!
+ * @file XCDFColumnReader.h
+ * @brief Read selected XCDF fields from a range of events into flat arrays.
+ */
+
+#ifndef XCDFCOLUMNREADER_H_INCLUDED
+#define XCDFCOLUMNREADER_H_INCLUDED
+
+#include <xcdf/XCDFFile.h>
+#include <xcdf/XCDFField.h>
+#include <xcdf/utility/EventSelectExpression.h>
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstring>
+#include <stdint.h>
+
+/*!
+ * @class ColumnReader
+ * @brief Copies the values of a list of fields into one flat array per
+ * field.  Values are stored as 64-bit numbers of the field type unless a
+ * narrower value size is chosen before reading.  Vector fields also get an
+ * array of offsets, with the values of the i-th selected event at
+ * [offsets[i], offsets[i+1]).  The reader does not use the Python API, so
+ * it can be run with the GIL released.
+ */
+class ColumnReader {
+
+  public:
+
+    ColumnReader(const std::vector<std::string>& names,
+                 XCDFFile& f) : file_(f), columns_(names.size()) {
+
+      for (unsigned i = 0; i < names.size(); ++i) {
+
+        Column& c = columns_[i];
+        c.name_ = names[i];
+        if (f.IsUnsignedIntegerField(names[i])) {
+          c.type_ = XCDF_UNSIGNED_INTEGER;
+          c.unsignedField_ = f.GetUnsignedIntegerField(names[i]);
+        } else if (f.IsSignedIntegerField(names[i])) {
+          c.type_ = XCDF_SIGNED_INTEGER;
+          c.signedField_ = f.GetSignedIntegerField(names[i]);
+        } else {
+          // This will throw XCDFException if the field does not exist
+          c.type_ = XCDF_FLOATING_POINT;
+          c.floatField_ = f.GetFloatingPointField(names[i]);
+        }
+        c.vector_ = f.IsVectorField(names[i]);
+        c.count_ = 0;
+        SetFormat(c, sizeof(uint64_t));
+        if (c.vector_) {
+          c.offsets_.push_back(0);
+        }
+      }
+    }
+
+    /// Store the values of a column in the given number of bytes (1, 2, 4
+    /// or 8; 4 or 8 for floating point fields) instead of 8.  Fails if the
+    /// field values do not fit, as given by XCDFFile::GetFieldValueSize.
+    void SetValueSize(unsigned i, unsigned size) {
+
+      Column& c = columns_[i];
+      if (c.count_ > 0) {
+        XCDFFatal("Column " << c.name_ << ": Cannot change value size " <<
+                  "after reading");
+      }
+      if (size != 1 && size != 2 && size != 4 && size != 8) {
+        XCDFFatal("Column " << c.name_ << ": Invalid value size " << size);
+      }
+      unsigned fit = file_.GetFieldValueSize(c.name_);
+      if (size < fit) {
+        XCDFFatal("Column " << c.name_ << ": Values do not fit in " <<
+                  size << " bytes");
+      }
+      SetFormat(c, size);
+    }
+
+    /// Store the values of every column in the narrowest type that fits
+    void SetNarrowestValueSizes() {
+      for (unsigned i = 0; i < columns_.size(); ++i) {
+        SetValueSize(i, file_.GetFieldValueSize(columns_[i].name_));
+      }
+    }
+
+    /// Read the events in [start, stop) that satisfy the selection
+    void Read(uint64_t start = 0,
+              uint64_t stop = std::numeric_limits<uint64_t>::max(),
+              const std::string& selection = "true") {
+
+      if (start >= stop) {
+        return;
+      }
+
+      EventSelectExpression expression(selection, file_);
+
+      // Size the scalar columns for the whole range if it is known
+      uint64_t total = file_.GetEventCount();
+      if (total > start) {
+        uint64_t n = (stop < total ? stop : total) - start;
+        for (unsigned i = 0; i < columns_.size(); ++i) {
+          if (!columns_[i].vector_) {
+            Column& c = columns_[i];
+            c.values_.reserve(((c.count_ + n) * c.size_ + 7) / 8);
+          }
+        }
+      }
+
+      file_.Rewind();
+      bool ok = start == 0 ? file_.Read() > 0 : file_.Seek(start);
+      while (ok && file_.GetCurrentEventNumber() < stop) {
+        if (expression.SelectEvent()) {
+          for (unsigned i = 0; i < columns_.size(); ++i) {
+            AddEvent(columns_[i]);
+          }
+        }
+        ok = file_.Read() > 0;
+      }
+      file_.Rewind();
+    }
+
+    unsigned GetNColumns() const {return columns_.size();}
+
+    const std::string& GetName(unsigned i) const {return columns_[i].name_;}
+    XCDFFieldType GetType(unsigned i) const {return columns_[i].type_;}
+    bool IsVector(unsigned i) const {return columns_[i].vector_;}
+
+    /// Number of values in a column
+    uint64_t GetNValues(unsigned i) const {return columns_[i].count_;}
+
+    /// Size in bytes of one value of a column
+    unsigned GetValueSize(unsigned i) const {return columns_[i].size_;}
+
+    /// Python struct format character of the values of a column
+    char GetFormat(unsigned i) const {return columns_[i].format_;}
+
+    /// Column values, packed into 64-bit words as values of the column
+    /// format
+    std::vector<uint64_t>& GetValues(unsigned i) {
+      return columns_[i].values_;
+    }
+
+    /// Vector field offsets, one more than the number of selected events
+    std::vector<uint64_t>& GetOffsets(unsigned i) {
+      return columns_[i].offsets_;
+    }
+
+  private:
+
+    struct Column {
+      std::string name_;
+      XCDFFieldType type_;
+      bool vector_;
+      unsigned size_;
+      char format_;
+      uint64_t count_;
+      XCDFUnsignedIntegerField unsignedField_;
+      XCDFSignedIntegerField signedField_;
+      XCDFFloatingPointField floatField_;
+      std::vector<uint64_t> values_;
+      std::vector<uint64_t> offsets_;
+    };
+
+    XCDFFile& file_;
+    std::vector<Column> columns_;
+
+    static void SetFormat(Column& c, unsigned size) {
+      static const char unsignedFormats[] = "BH?I???Q";
+      static const char signedFormats[] = "bh?i???q";
+      c.size_ = size;
+      switch (c.type_) {
+        case XCDF_UNSIGNED_INTEGER:
+          c.format_ = unsignedFormats[size - 1]; break;
+        case XCDF_SIGNED_INTEGER: c.format_ = signedFormats[size - 1]; break;
+        case XCDF_FLOATING_POINT: c.format_ = size == 4 ? 'f' : 'd'; break;
+      }
+    }
+
+    void AddEvent(Column& c) {
+      switch (c.type_) {
+        case XCDF_UNSIGNED_INTEGER: Append(c.unsignedField_, c); break;
+        case XCDF_SIGNED_INTEGER: Append(c.signedField_, c); break;
+        case XCDF_FLOATING_POINT: Append(c.floatField_, c); break;
+      }
+      if (c.vector_) {
+        c.offsets_.push_back(c.count_);
+      }
+    }
+
+    template <typename T>
+    static void Append(const XCDFField<T>& field, Column& c) {
+
+      if (field.GetSize() == 0) {
+        return;
+      }
+      uint64_t count = c.count_ + field.GetSize();
+      c.values_.resize((count * c.size_ + 7) / 8);
+      char* out = reinterpret_cast<char*>(&c.values_[0]) + c.count_ * c.size_;
+      switch (c.format_) {
+        case 'B': Copy<uint8_t>(field, out); break;
+        case 'H': Copy<uint16_t>(field, out); break;
+        case 'I': Copy<uint32_t>(field, out); break;
+        case 'b': Copy<int8_t>(field, out); break;
+        case 'h': Copy<int16_t>(field, out); break;
+        case 'i': Copy<int32_t>(field, out); break;
+        case 'f': Copy<float>(field, out); break;
+        default: Copy<T>(field, out); break;
+      }
+      c.count_ = count;
+    }
+
+    template <typename N, typename T>
+    static void Copy(const XCDFField<T>& field, char* out) {
+      for (typename XCDFField<T>::ConstIterator it = field.Begin();
+                                it != field.End(); ++it, out += sizeof(N)) {
+        N value = static_cast<N>(*it);
+        memcpy(out, &value, sizeof(N));
+      }
+    }
+};
+
+#endif // XCDFCOLUMNREADER_H_INCLUDED
@@ -0,0 +1,288 @@
+/*!
+ * @file XCDFColumnWriter.h
+ * @brief Write events into XCDF fields from whole columns of values.
+ */
+
+#ifndef XCDFCOLUMNWRITER_H_INCLUDED
+#define XCDFCOLUMNWRITER_H_INCLUDED
+
+#include <xcdf/XCDFFile.h>
+#include <xcdf/XCDFField.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <limits>
+#include <stdint.h>
+
+/*!
+ * @class ColumnWriter
+ * @brief Fills the fields of a file from one array of values per field and
+ * writes the events.  Arrays are described by a pointer, a length and a
+ * python struct format character, as obtained from the buffer protocol.
+ * Vector fields take the flat array of all their values, with the number
+ * of values in each event given by the parent field.  Values written to
+ * integer fields must be integers within the range of the field type;
+ * others are rejected before any event is written.  The writer does not
+ * use the Python API, so it can be run with the GIL released.
+ */
+class ColumnWriter {
+
+  public:
+
+    ColumnWriter(XCDFFile& f) : file_(f) { }
+
+    /// Size of a value of the given native struct format character, or 0
+    /// if the format is not supported
+    static unsigned GetFormatSize(const char format) {
+      switch (format) {
+        case '?':
+        case 'b':
+        case 'B': return sizeof(char);
+        case 'h':
+        case 'H': return sizeof(short);
+        case 'i':
+        case 'I': return sizeof(int);
+        case 'l':
+        case 'L': return sizeof(long);
+        case 'q':
+        case 'Q': return sizeof(long long);
+        case 'f': return sizeof(float);
+        case 'd': return sizeof(double);
+        default: return 0;
+      }
+    }
+
+    /// Add the values of a field.  For a vector field, counts may give the
+    /// number of values in each event, which must match the parent field.
+    void AddColumn(const std::string& name,
+                   const void* data, uint64_t size, const char format,
+                   const void* counts = NULL, uint64_t nCounts = 0,
+                   const char countFormat = 'Q') {
+
+      Column c;
+      c.name_ = name;
+      c.values_ = Array(data, size, format);
+      c.counts_ = Array(counts, nCounts, countFormat);
+      c.parent_ = -1;
+      if (file_.IsUnsignedIntegerField(name)) {
+        c.type_ = XCDF_UNSIGNED_INTEGER;
+        c.unsignedField_ = file_.GetUnsignedIntegerField(name);
+      } else if (file_.IsSignedIntegerField(name)) {
+        c.type_ = XCDF_SIGNED_INTEGER;
+        c.signedField_ = file_.GetSignedIntegerField(name);
+      } else {
+        // This will throw XCDFException if the field does not exist
+        c.type_ = XCDF_FLOATING_POINT;
+        c.floatField_ = file_.GetFloatingPointField(name);
+      }
+      if (file_.IsVectorField(name)) {
+        parentNames_[columns_.size()] = file_.GetFieldParentName(name);
+      }
+      columns_.push_back(c);
+    }
+
+    /// Check the column sizes and write the events.  Return the number of
+    /// events written.
+    uint64_t Write() {
+
+      uint64_t nEvents = Resolve();
+      std::vector<uint64_t> position(columns_.size(), 0);
+      for (uint64_t event = 0; event < nEvents; ++event) {
+        for (unsigned i = 0; i < columns_.size(); ++i) {
+
+          Column& c = columns_[i];
+          uint64_t n = 1;
+          if (c.parent_ >= 0) {
+            n = columns_[c.parent_].values_.Get<uint64_t>(event);
+          }
+          for (uint64_t j = position[i]; j < position[i] + n; ++j) {
+            switch (c.type_) {
+              case XCDF_UNSIGNED_INTEGER:
+                c.unsignedField_ << c.values_.Get<uint64_t>(j);
+                break;
+              case XCDF_SIGNED_INTEGER:
+                c.signedField_ << c.values_.Get<int64_t>(j);
+                break;
+              case XCDF_FLOATING_POINT:
+                c.floatField_ << c.values_.Get<double>(j);
+                break;
+            }
+          }
+          position[i] += n;
+        }
+        file_.Write();
+      }
+      return nEvents;
+    }
+
+  private:
+
+    // A contiguous array of native values
+    struct Array {
+
+      Array(const void* data = NULL,
+            uint64_t size = 0,
+            const char format = 'Q') : data_(data),
+                                       size_(size),
+                                       format_(format) { }
+
+      bool IsFloat() const {return format_ == 'f' || format_ == 'd';}
+
+      bool IsSigned() const {
+        return format_ == 'b' || format_ == 'h' || format_ == 'i' ||
+               format_ == 'l' || format_ == 'q';
+      }
+
+      template <typename T>
+      T Get(uint64_t i) const {
+        switch (format_) {
+          case '?':
+          case 'B': return T(static_cast<const unsigned char*>(data_)[i]);
+          case 'b': return T(static_cast<const signed char*>(data_)[i]);
+          case 'h': return T(static_cast<const short*>(data_)[i]);
+          case 'H': return T(static_cast<const unsigned short*>(data_)[i]);
+          case 'i': return T(static_cast<const int*>(data_)[i]);
+          case 'I': return T(static_cast<const unsigned*>(data_)[i]);
+          case 'l': return T(static_cast<const long*>(data_)[i]);
+          case 'L': return T(static_cast<const unsigned long*>(data_)[i]);
+          case 'q': return T(static_cast<const long long*>(data_)[i]);
+          case 'Q':
+            return T(static_cast<const unsigned long long*>(data_)[i]);
+          case 'f': return T(static_cast<const float*>(data_)[i]);
+          case 'd': return T(static_cast<const double*>(data_)[i]);
+          default:
+            XCDFFatal("Unsupported array format: " << format_);
+            return T(0);
+        }
+      }
+
+      const void* data_;
+      uint64_t size_;
+      char format_;
+    };
+
+    struct Column {
+      std::string name_;
+      XCDFFieldType type_;
+      Array values_;
+      Array counts_;
+      int parent_;
+      XCDFUnsignedIntegerField unsignedField_;
+      XCDFSignedIntegerField signedField_;
+      XCDFFloatingPointField floatField_;
+    };
+
+    XCDFFile& file_;
+    std::vector<Column> columns_;
+    std::map<unsigned, std::string> parentNames_;
+
+    // Check that every value of an array converts to the field type
+    // without loss
+    static void CheckValues(const std::string& name,
+                            const Array& a, XCDFFieldType type) {
+
+      // Limits of uint64_t and int64_t, exactly representable as doubles
+      const double unsignedLimit = 18446744073709551616.;
+      const double signedLimit = 9223372036854775808.;
+
+      if (type == XCDF_FLOATING_POINT) {
+        return;
+      }
+
+      for (uint64_t i = 0; i < a.size_; ++i) {
+        bool ok = true;
+        if (a.IsFloat()) {
+          double value = a.Get<double>(i);
+          ok = value == std::floor(value) &&
+               (type == XCDF_UNSIGNED_INTEGER ?
+                    value >= 0. && value < unsignedLimit :
+                    value >= -signedLimit && value < signedLimit);
+          if (!ok) {
+            XCDFFatal("Column " << name << " value " << i << " (" <<
+                      value << ") is not a valid " <<
+                      (type == XCDF_UNSIGNED_INTEGER ? "unsigned" : "signed")
+                      << " integer");
+          }
+        } else if (type == XCDF_UNSIGNED_INTEGER && a.IsSigned()) {
+          ok = a.Get<int64_t>(i) >= 0;
+        } else if (type == XCDF_SIGNED_INTEGER && !a.IsSigned()) {
+          ok = a.Get<uint64_t>(i) <=
+                   static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+        }
+        if (!ok) {
+          XCDFFatal("Column " << name << " value " << i <<
+                    " is out of range of the field type");
+        }
+      }
+    }
+
+    // Link vector fields to their parent columns and check that the column
+    // sizes agree and the values fit the fields.  Return the number of
+    // events.
+    uint64_t Resolve() {
+
+      if (columns_.size() != file_.GetNFields()) {
+        XCDFFatal("Columns given for " << columns_.size() << " of " <<
+                  file_.GetNFields() << " fields");
+      }
+
+      uint64_t nEvents = 0;
+      bool nEventsSet = false;
+      for (unsigned i = 0; i < columns_.size(); ++i) {
+        if (parentNames_.find(i) == parentNames_.end()) {
+          if (nEventsSet && columns_[i].values_.size_ != nEvents) {
+            XCDFFatal("Column " << columns_[i].name_ << " has " <<
+                      columns_[i].values_.size_ << " values.  Expected " <<
+                      nEvents);
+          }
+          nEvents = columns_[i].values_.size_;
+          nEventsSet = true;
+        }
+      }
+
+      for (unsigned i = 0; i < columns_.size(); ++i) {
+        CheckValues(columns_[i].name_, columns_[i].values_, columns_[i].type_);
+        CheckValues(columns_[i].name_, columns_[i].counts_,
+                    XCDF_UNSIGNED_INTEGER);
+      }
+
+      for (std::map<unsigned, std::string>::const_iterator
+                 it = parentNames_.begin(); it != parentNames_.end(); ++it) {
+
+        Column& c = columns_[it->first];
+        for (unsigned i = 0; i < columns_.size(); ++i) {
+          if (columns_[i].name_ == it->second) {
+            c.parent_ = i;
+          }
+        }
+        if (c.parent_ < 0) {
+          XCDFFatal("Column " << c.name_ << " requires parent column " <<
+                    it->second);
+        }
+
+        const Array& parent = columns_[c.parent_].values_;
+        if (c.counts_.data_ && c.counts_.size_ != nEvents) {
+          XCDFFatal("Column " << c.name_ << " has " << c.counts_.size_ <<
+                    " counts.  Expected " << nEvents);
+        }
+        uint64_t total = 0;
+        for (uint64_t event = 0; event < nEvents; ++event) {
+          uint64_t n = parent.Get<uint64_t>(event);
+          if (c.counts_.data_ && c.counts_.Get<uint64_t>(event) != n) {
+            XCDFFatal("Column " << c.name_ << " event " << event <<
+                      " count does not match " << it->second);
+          }
+          total += n;
+        }
+        if (c.values_.size_ != total) {
+          XCDFFatal("Column " << c.name_ << " has " << c.values_.size_ <<
+                    " values.  Expected " << total);
+        }
+      }
+      return nEvents;
+    }
+};
+
+#endif // XCDFCOLUMNWRITER_H_INCLUDED
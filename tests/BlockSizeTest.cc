@@ -0,0 +1,139 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+ *  Write a file with a target compressed block size and check the block
+ *  table.  The first block has no compression ratio to predict from, so
+ *  it ends after the block size in events.  The data compresses about
+ *  half as well after the midpoint, so the block after the change may
+ *  miss the target.  Every other full block must be close to it.
+ */
+
+namespace {
+
+const uint64_t targetBytes = 65536;
+const uint64_t blockSize = 1000;
+const int nEvents = 400000;
+
+// Allowed deviation of a block from the target size
+const double tolerance = 0.2;
+
+}
+
+int main(int argc, char** argv) {
+
+  XCDFFile f("blocksizetest.xcd", "w");
+  XCDFUnsignedIntegerField field1 =
+                  f.AllocateUnsignedIntegerField("field1", 1);
+  XCDFFloatingPointField field2 =
+                  f.AllocateFloatingPointField("field2", 0.01);
+  f.SetBlockSize(blockSize);
+  f.SetTargetBlockBytes(targetBytes);
+  if (f.GetTargetBlockBytes() != targetBytes) {
+    std::cerr << "Target block bytes not set" << std::endl;
+    exit(1);
+  }
+
+  srand(1);
+  for (int k = 0; k < nEvents; k++) {
+    int range = k < nEvents / 2 ? 256 : 65536;
+    field1 << rand() % range;
+    field2 << (rand() % range) * 0.01;
+    f.Write();
+  }
+  f.Close();
+
+  XCDFFile g("blocksizetest.xcd", "r");
+  std::vector<uint64_t> starts;
+  std::vector<uint64_t> offsets;
+  if (!g.GetBlockStartEvents(starts) || !g.GetBlockOffsets(offsets) ||
+      starts.size() != offsets.size() || starts.size() < 4) {
+    std::cerr << "Block table not found" << std::endl;
+    exit(1);
+  }
+
+  if (starts[1] != blockSize) {
+    std::cerr << "First block has " << starts[1] << " events.  Expected " <<
+                 blockSize << std::endl;
+    exit(1);
+  }
+
+  // The last block is partly filled, and its size is not in the table
+  unsigned nChecked = 0;
+  for (unsigned i = 1; i + 1 < offsets.size(); ++i) {
+
+    uint64_t bytes = offsets[i + 1] - offsets[i];
+    bool straddles = starts[i] < nEvents / 2 && starts[i + 1] > nEvents / 2;
+    bool follows = starts[i] >= nEvents / 2 && starts[i - 1] < nEvents / 2;
+    if (straddles || follows) {
+      continue;
+    }
+
+    if (fabs(static_cast<double>(bytes) - targetBytes) >
+                                              tolerance * targetBytes) {
+      std::cerr << "Block " << i << " at event " << starts[i] << " is " <<
+                   bytes << " bytes.  Target: " << targetBytes << std::endl;
+      exit(1);
+    }
+    nChecked++;
+  }
+
+  if (nChecked < 4) {
+    std::cerr << "Only " << nChecked << " blocks checked" << std::endl;
+    exit(1);
+  }
+
+  // The events must be unchanged
+  srand(1);
+  field1 = g.GetUnsignedIntegerField("field1");
+  field2 = g.GetFloatingPointField("field2");
+  int k = 0;
+  while (g.Read()) {
+    int range = k < nEvents / 2 ? 256 : 65536;
+    uint64_t value1 = rand() % range;
+    double value2 = (rand() % range) * 0.01;
+    if (*field1 != value1 || fabs(*field2 - value2) > 0.005 + 1e-9) {
+      std::cerr << "Bad event " << k << std::endl;
+      exit(1);
+    }
+    k++;
+  }
+  if (k != nEvents) {
+    std::cerr << "Read " << k << " of " << nEvents << " entries" << std::endl;
+    exit(1);
+  }
+  g.Close();
+
+  std::cout << "Checked " << nChecked << " of " << offsets.size() <<
+               " blocks.  Success!" << std::endl;
+}
@@ -0,0 +1,479 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+/*
+ *  Write a file with each field encoding, with and without shuffling,
+ *  then read it back, seek in it, select fields from it and merge it,
+ *  checking every value.  The blocks are chosen to reach the edge cases
+ *  of the encodings:
+ *
+ *  - a block of constant values, where every field has active size 0
+ *  - a block that needs all 64 bits, holding NaN and infinite values
+ *  - a block of slowly-varying values, which delta encoding writes as
+ *    differences
+ *  - a block of small values with rare outliers, which mini-block
+ *    encoding writes as escaped values
+ *  - a block with more distinct values than a dictionary can hold
+ *  - a block of mostly-zero values, which run-length encoding writes
+ *    as a few long runs
+ *  - a block where the floating point fields are all NaN
+ *  - a block of random values
+ *  - a block where every vector is empty
+ */
+
+namespace {
+
+struct Event {
+  uint64_t uint_;
+  int64_t sint_;
+  double fp_;
+  double full_;
+  std::vector<double> vec_;
+};
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+const double inf = std::numeric_limits<double>::infinity();
+
+const double fpRes = 0.1;
+const double vecRes = 0.01;
+
+struct Encoding {
+  XCDFFieldEncoding encoding_;
+  const char* name_;
+};
+
+const Encoding encodings[] = {
+  {XCDF_ENCODING_PLAIN, "plain"},
+  {XCDF_ENCODING_DELTA, "delta"},
+  {XCDF_ENCODING_MINI_BLOCK, "mini-block"},
+  {XCDF_ENCODING_DICTIONARY, "dictionary"},
+  {XCDF_ENCODING_RUN_LENGTH, "run-length"},
+  {XCDF_ENCODING_XOR, "xor"},
+};
+
+struct Fields {
+  XCDFUnsignedIntegerField uint_;
+  XCDFSignedIntegerField sint_;
+  XCDFFloatingPointField fp_;
+  XCDFFloatingPointField full_;
+  XCDFUnsignedIntegerField count_;
+  XCDFFloatingPointField vec_;
+};
+
+void MakeEvents(std::vector<Event>& events,
+                std::vector<uint64_t>& blockStarts) {
+
+  Event e;
+
+  // Constant values
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 300; ++k) {
+    e.uint_ = 7;
+    e.sint_ = -3;
+    e.fp_ = 1.5;
+    e.full_ = 2.25;
+    e.vec_.assign(2, 0.5);
+    events.push_back(e);
+  }
+
+  // Full 64-bit range, NaN and infinite values
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 300; ++k) {
+    e.uint_ = k % 2 ? ~static_cast<uint64_t>(0) - k : k;
+    e.sint_ = k % 2 ? std::numeric_limits<int64_t>::min() + k :
+                      std::numeric_limits<int64_t>::max() - k;
+    e.fp_ = k % 50 == 0 ? NaN : k % 70 == 1 ? -inf : k * 0.1;
+    e.full_ = 1000. + k * 1e-7;
+    e.vec_.clear();
+    for (int j = 0; j < k % 3; ++j) {
+      e.vec_.push_back(k % 7 == 0 && j == 0 ? inf : k * 0.01 + j);
+    }
+    events.push_back(e);
+  }
+
+  // Slowly-varying values
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 2000; ++k) {
+    e.uint_ = 1000000 + 3 * k + k % 2;
+    e.sint_ = -k / 2;
+    e.fp_ = 100. + k * 0.05;
+    e.full_ = 0.5 * k;
+    e.vec_.assign(1 + k % 2, 10. + k * 0.01);
+    events.push_back(e);
+  }
+
+  // Small values with rare outliers
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 1000; ++k) {
+    e.uint_ = k % 300 == 5 ? static_cast<uint64_t>(1) << 40 : k % 16;
+    e.sint_ = k % 300 == 9 ? -1000000 : -(k % 8);
+    e.fp_ = k % 300 == 13 ? 1e6 : (k % 10) * 0.1;
+    e.full_ = k % 300 == 17 ? 1e300 : 0.25 * (k % 4);
+    e.vec_.assign(k % 2, k % 300 == 21 ? 5e5 : 0.01 * (k % 5));
+    events.push_back(e);
+  }
+
+  // More distinct values than a dictionary can index
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 70000; ++k) {
+    e.uint_ = 3 * k + 1;
+    e.sint_ = -7 * k;
+    e.fp_ = k * 0.1;
+    e.full_ = k * 0.5;
+    e.vec_.assign(k % 3, k * 0.01);
+    events.push_back(e);
+  }
+
+  // Mostly zero, with rare changes
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 3000; ++k) {
+    bool change = k % 700 > 690;
+    e.uint_ = change ? k : 0;
+    e.sint_ = change ? -k : 0;
+    e.fp_ = change ? k * 0.1 : 0.;
+    e.full_ = change ? 1. / (k + 1) : 0.;
+    e.vec_.assign(k % 1000 < 500 ? 1 : 0, change ? 0.5 : 0.);
+    events.push_back(e);
+  }
+
+  // Floating point fields are all NaN
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 200; ++k) {
+    e.uint_ = k;
+    e.sint_ = k;
+    e.fp_ = NaN;
+    e.full_ = NaN;
+    e.vec_.assign(k % 3, NaN);
+    events.push_back(e);
+  }
+
+  // Random values
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 5000; ++k) {
+    e.uint_ = rand() % 100000;
+    e.sint_ = rand() % 100000 - 50000;
+    e.fp_ = 1000. * rand() / (RAND_MAX + 1.);
+    e.full_ = rand() / (RAND_MAX + 1.);
+    e.vec_.clear();
+    for (int j = rand() % 4; j > 0; --j) {
+      e.vec_.push_back(rand() / (RAND_MAX + 1.));
+    }
+    events.push_back(e);
+  }
+
+  // Empty vectors
+  blockStarts.push_back(events.size());
+  for (int k = 0; k < 100; ++k) {
+    e.uint_ = 100 - k;
+    e.sint_ = k;
+    e.fp_ = -k * 0.1;
+    e.full_ = k;
+    e.vec_.clear();
+    events.push_back(e);
+  }
+}
+
+Fields AllocateFields(XCDFFile& f,
+                      XCDFFieldEncoding encoding,
+                      bool shuffle,
+                      bool withVector) {
+
+  Fields fields;
+  fields.uint_ = f.AllocateUnsignedIntegerField("uint", 1);
+  fields.sint_ = f.AllocateSignedIntegerField("sint", 1);
+  fields.fp_ = f.AllocateFloatingPointField("fp", fpRes);
+  fields.full_ = f.AllocateFloatingPointField("full", 0.);
+  f.SetFieldEncoding("uint", encoding);
+  f.SetFieldEncoding("sint", encoding);
+  f.SetFieldEncoding("fp", encoding);
+  f.SetFieldEncoding("full", encoding);
+  if (withVector) {
+    fields.count_ = f.AllocateUnsignedIntegerField("count", 1);
+    fields.vec_ = f.AllocateFloatingPointField("vec", vecRes, "count");
+    f.SetFieldEncoding("count", encoding);
+    f.SetFieldEncoding("vec", encoding);
+  }
+  f.SetShuffle(shuffle);
+  f.SetBlockSize(100000);
+  return fields;
+}
+
+Fields GetFields(XCDFFile& f, bool withVector) {
+
+  Fields fields;
+  fields.uint_ = f.GetUnsignedIntegerField("uint");
+  fields.sint_ = f.GetSignedIntegerField("sint");
+  fields.fp_ = f.GetFloatingPointField("fp");
+  fields.full_ = f.GetFloatingPointField("full");
+  if (withVector) {
+    fields.count_ = f.GetUnsignedIntegerField("count");
+    fields.vec_ = f.GetFloatingPointField("vec");
+  }
+  return fields;
+}
+
+// Values are quantized to half the resolution.  Resolution 0 is exact.
+bool Same(double expected, double value, double res) {
+  if (std::isnan(expected) || std::isinf(expected)) {
+    return std::isnan(expected) ? std::isnan(value) : value == expected;
+  }
+  return fabs(value - expected) <= res / 2. + 1e-9 * fabs(expected);
+}
+
+template <typename T>
+void Fail(const std::string& label, const std::string& field,
+          uint64_t k, T expected, T value) {
+  std::cerr << label << ": " << field << ": Expected: " << expected <<
+               " Got: " << value << ".  Entries: " << k << std::endl;
+  exit(1);
+}
+
+// Check the current event of a file against the expected event k
+void CheckEvent(const std::string& label,
+                const Fields& fields,
+                const std::vector<Event>& events,
+                uint64_t k,
+                bool withVector) {
+
+  const Event& e = events[k % events.size()];
+  if (*fields.uint_ != e.uint_) {
+    Fail(label, "uint", k, e.uint_, *fields.uint_);
+  }
+  if (*fields.sint_ != e.sint_) {
+    Fail(label, "sint", k, e.sint_, *fields.sint_);
+  }
+  if (!Same(e.fp_, *fields.fp_, fpRes)) {
+    Fail(label, "fp", k, e.fp_, *fields.fp_);
+  }
+  if (!Same(e.full_, *fields.full_, 0.)) {
+    Fail(label, "full", k, e.full_, *fields.full_);
+  }
+  if (!withVector) {
+    return;
+  }
+  if (*fields.count_ != e.vec_.size() ||
+      fields.vec_.GetSize() != e.vec_.size()) {
+    Fail<uint64_t>(label, "count", k, e.vec_.size(), fields.vec_.GetSize());
+  }
+  for (unsigned j = 0; j < e.vec_.size(); ++j) {
+    if (!Same(e.vec_[j], fields.vec_[j], vecRes)) {
+      Fail(label, "vec", k, e.vec_[j], fields.vec_[j]);
+    }
+  }
+}
+
+// Read a file through, checking it holds nEvents of the expected events
+void CheckFile(const std::string& label,
+               const char* fileName,
+               const std::vector<Event>& events,
+               uint64_t nEvents,
+               bool withVector) {
+
+  XCDFFile f(fileName, "r");
+  Fields fields = GetFields(f, withVector);
+
+  uint64_t k = 0;
+  while (f.Read()) {
+    if (k == nEvents) {
+      std::cerr << label << ": Extra events" << std::endl;
+      exit(1);
+    }
+    CheckEvent(label, fields, events, k++, withVector);
+  }
+  if (k != nEvents || f.GetEventCount() != nEvents) {
+    std::cerr << label << ": Read " << k << " of " << nEvents <<
+                 " entries" << std::endl;
+    exit(1);
+  }
+  f.Close();
+
+  XCDFFile g(fileName, "r");
+  if (g.CheckFrames(true) != nEvents) {
+    std::cerr << label << ": Frame check failed" << std::endl;
+    exit(1);
+  }
+  g.Close();
+}
+
+// Seek to the edges and middle of each block, forwards and backwards
+void CheckSeek(const std::string& label,
+               const char* fileName,
+               const std::vector<Event>& events,
+               const std::vector<uint64_t>& blockStarts) {
+
+  std::vector<uint64_t> positions;
+  for (unsigned i = 0; i < blockStarts.size(); ++i) {
+    positions.push_back(blockStarts[i] + 77);
+    positions.push_back(blockStarts[i]);
+    if (blockStarts[i] > 0) {
+      positions.push_back(blockStarts[i] - 1);
+    }
+  }
+  positions.push_back(events.size() - 1);
+  positions.push_back(0);
+
+  XCDFFile f(fileName, "r");
+  Fields fields = GetFields(f, true);
+  for (unsigned i = 0; i < positions.size(); ++i) {
+    uint64_t k = positions[i];
+    if (!f.Seek(k)) {
+      std::cerr << label << ": Seek to " << k << " failed" << std::endl;
+      exit(1);
+    }
+    CheckEvent(label + " seek", fields, events, k, true);
+    if (k + 1 < events.size()) {
+      if (!f.Read()) {
+        std::cerr << label << ": Read after seek to " << k <<
+                     " failed" << std::endl;
+        exit(1);
+      }
+      CheckEvent(label + " seek", fields, events, k + 1, true);
+    }
+  }
+  f.Close();
+}
+
+// Copy the scalar fields into a new file, block by block if possible
+void SelectFields(const char* inName,
+                  const char* outName,
+                  XCDFFieldEncoding encoding,
+                  bool shuffle) {
+
+  XCDFFile in(inName, "r");
+  XCDFFile out(outName, "w");
+  Fields inFields = GetFields(in, true);
+  Fields outFields = AllocateFields(out, encoding, shuffle, false);
+
+  if (in.IsBlockCopyCompatible(out)) {
+    while (in.CopyBlock(out));
+  } else {
+    while (in.Read()) {
+      outFields.uint_ << *inFields.uint_;
+      outFields.sint_ << *inFields.sint_;
+      outFields.fp_ << *inFields.fp_;
+      outFields.full_ << *inFields.full_;
+      out.Write();
+    }
+  }
+  out.Close();
+  in.Close();
+}
+
+// Concatenate two copies of a file frame by frame
+void Merge(const std::string& label,
+           const char* inName,
+           const char* outName,
+           XCDFFieldEncoding encoding,
+           bool shuffle,
+           bool withVector) {
+
+  XCDFFile out(outName, "w");
+  AllocateFields(out, encoding, shuffle, withVector);
+  for (int i = 0; i < 2; ++i) {
+    XCDFFile in(inName, "r");
+    if (!in.IsFrameCopyCompatible(out)) {
+      std::cerr << label << ": Unable to merge " << inName << std::endl;
+      exit(1);
+    }
+    in.CopyFrames(out);
+    in.Close();
+  }
+  out.Close();
+}
+
+}
+
+int main(int argc, char** argv) {
+
+  std::vector<Event> events;
+  std::vector<uint64_t> blockStarts;
+  MakeEvents(events, blockStarts);
+
+  for (unsigned i = 0; i < sizeof(encodings) / sizeof(encodings[0]); ++i) {
+
+    for (int shuffle = 0; shuffle < 2; ++shuffle) {
+
+      std::string label = encodings[i].name_;
+      if (shuffle) {
+        label += " shuffled";
+      }
+      XCDFFieldEncoding enc = encodings[i].encoding_;
+
+      XCDFFile f("encodingtest.xcd", "w");
+      Fields fields = AllocateFields(f, enc, shuffle, true);
+      unsigned block = 0;
+      for (uint64_t k = 0; k < events.size(); ++k) {
+        if (k > 0 && block < blockStarts.size() && k == blockStarts[block]) {
+          f.StartNewBlock();
+        }
+        if (block < blockStarts.size() && k == blockStarts[block]) {
+          ++block;
+        }
+        const Event& e = events[k];
+        fields.uint_ << e.uint_;
+        fields.sint_ << e.sint_;
+        fields.fp_ << e.fp_;
+        fields.full_ << e.full_;
+        fields.count_ << e.vec_.size();
+        for (unsigned j = 0; j < e.vec_.size(); ++j) {
+          fields.vec_ << e.vec_[j];
+        }
+        f.Write();
+      }
+      f.Close();
+
+      CheckFile(label, "encodingtest.xcd", events, events.size(), true);
+      CheckSeek(label, "encodingtest.xcd", events, blockStarts);
+
+      SelectFields("encodingtest.xcd", "encodingtest-select.xcd",
+                   enc, shuffle);
+      CheckFile(label + " select", "encodingtest-select.xcd",
+                events, events.size(), false);
+
+      Merge(label, "encodingtest.xcd", "encodingtest-merge.xcd",
+            enc, shuffle, true);
+      CheckFile(label + " merge", "encodingtest-merge.xcd",
+                events, 2 * events.size(), true);
+
+      Merge(label, "encodingtest-select.xcd", "encodingtest-merge.xcd",
+            enc, shuffle, false);
+      CheckFile(label + " select merge", "encodingtest-merge.xcd",
+                events, 2 * events.size(), false);
+
+      std::cout << label << ": OK" << std::endl;
+    }
+  }
+
+  std::cout << "Success!" << std::endl;
+}
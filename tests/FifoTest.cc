@@ -0,0 +1,130 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/*
+ *  Read a file through a FIFO, as with process substitution, where the
+ *  input cannot be seeked.  Every event must still be read.
+ */
+
+namespace {
+
+const char* fileName = "fifotest.xcd";
+const char* fifoName = "fifotest.fifo";
+const int nEvents = 100000;
+
+// Copy the file into the FIFO from a child process
+pid_t StartWriter() {
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    std::ifstream in(fileName, std::ifstream::binary);
+    std::ofstream out(fifoName, std::ofstream::binary);
+    out << in.rdbuf();
+    out.close();
+    _exit(out.fail() ? 1 : 0);
+  }
+  return pid;
+}
+
+}
+
+int main(int argc, char** argv) {
+
+  XCDFFile f(fileName, "w");
+  XCDFUnsignedIntegerField field1 =
+                  f.AllocateUnsignedIntegerField("field1", 1);
+  XCDFFloatingPointField field2 =
+                  f.AllocateFloatingPointField("field2", 0.1, "field1");
+  f.SetBlockSize(1000);
+
+  for (int k = 0; k < nEvents; k++) {
+    field1 << k % 4;
+    for (int j = 0; j < k % 4; j++) {
+      field2 << k * 0.5 + j;
+    }
+    f.Write();
+  }
+  f.Close();
+
+  unlink(fifoName);
+  if (mkfifo(fifoName, 0600) != 0) {
+    std::cerr << "Unable to create " << fifoName << std::endl;
+    exit(1);
+  }
+  pid_t writer = StartWriter();
+  if (writer < 0) {
+    std::cerr << "Unable to start writer" << std::endl;
+    exit(1);
+  }
+
+  XCDFFile g(fifoName, "r");
+  field1 = g.GetUnsignedIntegerField("field1");
+  field2 = g.GetFloatingPointField("field2");
+
+  int k = 0;
+  while (g.Read()) {
+    if (*field1 != static_cast<uint64_t>(k % 4) ||
+        field2.GetSize() != static_cast<unsigned>(k % 4)) {
+      std::cerr << "Bad event " << k << std::endl;
+      exit(1);
+    }
+    for (int j = 0; j < k % 4; j++) {
+      if (fabs(field2[j] - (k * 0.5 + j)) > 0.05 + 1e-9) {
+        std::cerr << "field2: Expected: " << k * 0.5 + j << " Got: " <<
+                     field2[j] << ".  Entries: " << k << std::endl;
+        exit(1);
+      }
+    }
+    k++;
+  }
+  g.Close();
+
+  int status = 0;
+  waitpid(writer, &status, 0);
+  unlink(fifoName);
+
+  if (k != nEvents) {
+    std::cerr << "Read " << k << " of " << nEvents << " entries" << std::endl;
+    exit(1);
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::cerr << "Writer failed" << std::endl;
+    exit(1);
+  }
+
+  std::cout << "Success!" << std::endl;
+}
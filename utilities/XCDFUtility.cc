@@ -3,6 +3,10 @@
 #include <xcdf/utility/EventSelectExpression.h>
 #include <xcdf/utility/HistogramFiller.h>
 #include <xcdf/utility/Histogram.h>
+#include <xcdf/utility/Statistics.h>
+#include <xcdf/utility/CSVWriter.h>
+#include <xcdf/utility/EventRange.h>
+#include <xcdf/utility/ThreadRunner.h>
 #include <xcdf/XCDFDefs.h>
 #include <xcdf/config.h>
 
@@ -33,6 +37,10 @@ void Info(std::vector<std::string>& infiles) {
     if ((it->parentName_).size() > maxParentWidth) {
       maxParentWidth = (it->parentName_).size();
     }
+
+    // Get all byte counts before the ranges.  If any needs a full read
+    // of the file, the ranges printed are then exact.
+    f.GetFieldBytes(it->name_);
   }
 
   if (maxNameWidth < 8) {
@@ -89,16 +97,16 @@ void Info(std::vector<std::string>& infiles) {
     switch (it->type_) {
 
       case XCDF_UNSIGNED_INTEGER:
-        std::cout << f.GetUnsignedIntegerFieldRange(it->name_).first << " " <<
-            std::setw(10) << f.GetUnsignedIntegerFieldRange(it->name_).second;
+        std::cout << f.GetUnsignedIntegerFieldBounds(it->name_).first << " " <<
+            std::setw(10) << f.GetUnsignedIntegerFieldBounds(it->name_).second;
         break;
       case XCDF_SIGNED_INTEGER:
-        std::cout << f.GetSignedIntegerFieldRange(it->name_).first << " " <<
-            std::setw(10) << f.GetSignedIntegerFieldRange(it->name_).second;
+        std::cout << f.GetSignedIntegerFieldBounds(it->name_).first << " " <<
+            std::setw(10) << f.GetSignedIntegerFieldBounds(it->name_).second;
         break;
       case XCDF_FLOATING_POINT:
-        std::cout << f.GetFloatingPointFieldRange(it->name_).first << " " <<
-            std::setw(10) << f.GetFloatingPointFieldRange(it->name_).second;
+        std::cout << f.GetFloatingPointFieldBounds(it->name_).first << " " <<
+            std::setw(10) << f.GetFloatingPointFieldBounds(it->name_).second;
         break;
 
     }
@@ -106,6 +114,11 @@ void Info(std::vector<std::string>& infiles) {
     std::cout << std::endl;
   }
 
+  if (f.GlobalRangesAreBounds()) {
+    std::cout << std::endl << "Min and Max are bounds from the block headers"
+              << std::endl;
+  }
+
   // Get the list of hard aliases in the header
   std::set<XCDFAliasDescriptor> headerDescriptors;
   headerDescriptors.insert(f.AliasDescriptorsBegin(), f.AliasDescriptorsEnd());
@@ -214,9 +227,169 @@ void Dump(std::vector<std::string>& infiles) {
   }
 }
 
-void CSV(std::vector<std::string>& infiles) {
+std::set<std::string> ParseCSV(std::string& exp) {
+
+  std::set<std::string> fields;
+
+  char* expPtr = const_cast<char*>(exp.c_str());
+  for (char* tok = strtok(expPtr, ","); tok != NULL;
+                                             tok = strtok(NULL, ",")) {
+
+    std::string str(tok);
+
+    // Trim leading and trailing whitespace
+    size_t endPos = str.find_last_not_of(" \n\r\t");
+    if(endPos != std::string::npos) {
+      str = str.substr(0, endPos+1);
+    }
+
+    size_t startPos = str.find_first_not_of(" \n\r\t");
+    if(startPos != std::string::npos) {
+      str = str.substr(startPos);
+    }
+
+    fields.insert(str);
+  }
+  return fields;
+}
+
+/*
+ *  Format a part of the input into a CSVWriter buffer
+ */
+class CSVFormatTask : public ThreadTask {
+
+  public:
+
+    CSVFormatTask(const EventRangeList& ranges,
+                  const std::set<std::string>& names,
+                  char delimiter) : ranges_(ranges),
+                                    names_(names),
+                                    writer_(delimiter) { }
+
+    void Run() {
+      XCDFFile f;
+      CSVWriter header;
+      std::vector<bool> selected;
+      for (EventRangeList::const_iterator it = ranges_.begin();
+                                          it != ranges_.end(); ++it) {
+        f.Open(it->fileName_, "r");
+        CSVFieldNameVisitor nameVisitor(f, header, names_, selected);
+        f.ApplyFieldVisitor(nameVisitor);
+
+        CSVFieldDataVisitor dataVisitor(writer_, selected);
+        EventRangeReader reader(f, *it);
+        while (reader.Read()) {
+          dataVisitor.Reset();
+          f.ApplyFieldVisitor(dataVisitor);
+          writer_.EndLine();
+        }
+        f.Close();
+      }
+    }
+
+    CSVWriter& GetWriter() {return writer_;}
+
+  private:
+
+    EventRangeList ranges_;
+    std::set<std::string> names_;
+    CSVWriter writer_;
+};
+
+void CSV(std::vector<std::string>& infiles,
+         std::string& fieldList,
+         const std::string& delimiter,
+         unsigned nThreads) {
+
+  if (delimiter.size() != 1) {
+    std::cerr << "CSV delimiter must be a single character" << std::endl;
+    exit(1);
+  }
+
+  std::set<std::string> names;
+  if (fieldList.size() > 0) {
+    std::string specs(fieldList);
+    std::set<std::string> fieldSpecs = ParseCSV(specs);
+    if (fieldSpecs.size() == 0) {
+      std::cerr << "No fields selected" << std::endl;
+      exit(1);
+    }
+
+    // Match against the fields of the first file
+    XCDFFile f;
+    if (infiles.size() > 0) {
+      f.Open(infiles[0], "r");
+    } else {
+      f.Open(std::cin);
+    }
+    MatchFieldsVisitor matchFieldsVisitor(fieldSpecs);
+    f.ApplyFieldVisitor(matchFieldsVisitor);
+    names = matchFieldsVisitor.GetMatches();
+    if (names.size() == 0) {
+      XCDFFatal("No fields match \"" << fieldList << "\"");
+    }
+    if (infiles.size() > 0) {
+      f.Close();
+    } else {
+
+      // Can't reopen stdin: write it out from here
+      CSVWriter writer(delimiter[0]);
+      std::vector<bool> selected;
+      CSVFieldNameVisitor nameVisitor(f, writer, names, selected);
+      f.ApplyFieldVisitor(nameVisitor);
+      writer.EndLine();
+      CSVFieldDataVisitor dataVisitor(writer, selected);
+      while (f.Read()) {
+        dataVisitor.Reset();
+        f.ApplyFieldVisitor(dataVisitor);
+        writer.EndLine();
+        if (writer.IsFull()) {
+          writer.Flush(STDOUT_FILENO);
+        }
+      }
+      writer.Flush(STDOUT_FILENO);
+      return;
+    }
+  }
+
+  std::cout.flush();
+  CSVWriter writer(delimiter[0]);
+
+  // Format contiguous parts of the input on each thread, and write them
+  // out in input order.  Parts are kept small to bound the memory used.
+  if (nThreads > 1 && infiles.size() > 0) {
+
+    XCDFFile f;
+    f.Open(infiles[0], "r");
+    std::vector<bool> selected;
+    CSVFieldNameVisitor nameVisitor(f, writer, names, selected);
+    f.ApplyFieldVisitor(nameVisitor);
+    writer.EndLine();
+    writer.Flush(STDOUT_FILENO);
+    f.Close();
+
+    std::vector<EventRangeList> parts =
+                           PartitionEvents(infiles, 64 * nThreads);
+    for (unsigned first = 0; first < parts.size(); first += nThreads) {
+
+      TaskList<CSVFormatTask> tasks;
+      for (unsigned i = first; i < first + nThreads &&
+                               i < parts.size(); ++i) {
+        if (parts[i].size() > 0) {
+          tasks.Add(new CSVFormatTask(parts[i], names, delimiter[0]));
+        }
+      }
+      tasks.Run();
+
+      for (unsigned i = 0; i < tasks.Size(); ++i) {
+        tasks[i].GetWriter().Flush(STDOUT_FILENO);
+      }
+    }
+    return;
+  }
 
   XCDFFile f;
+  std::vector<bool> selected;
   for (unsigned i = 0; i <= infiles.size(); ++i) {
 
     if (i == infiles.size()) {
@@ -230,26 +403,92 @@ void CSV(std::vector<std::string>& infiles) {
       f.Open(infiles[i], "r");
     }
 
+    // Only the header of the first file is written
+    CSVWriter header;
+    CSVFieldNameVisitor nameVisitor(f, i == 0 ? writer : header,
+                                    names, selected);
+    f.ApplyFieldVisitor(nameVisitor);
     if (i == 0) {
-      PrintFieldNameVisitor printFieldNameVisitor(f);
-      f.ApplyFieldVisitor(printFieldNameVisitor);
-      std::cout << std::endl;
+      writer.EndLine();
     }
 
-    PrintFieldDataVisitor printFieldDataVisitor;
+    CSVFieldDataVisitor dataVisitor(writer, selected);
     while (f.Read()) {
 
-      printFieldDataVisitor.Reset();
-      f.ApplyFieldVisitor(printFieldDataVisitor);
-      std::cout << std::endl;
+      dataVisitor.Reset();
+      f.ApplyFieldVisitor(dataVisitor);
+      writer.EndLine();
+      if (writer.IsFull()) {
+        writer.Flush(STDOUT_FILENO);
+      }
     }
 
     f.Close();
   }
+  writer.Flush(STDOUT_FILENO);
 }
 
+/*
+ *  Counts the events satisfying an expression in a list of event ranges
+ */
+class CountTask : public ThreadTask {
+
+  public:
+
+    CountTask(const std::string& exp,
+              const EventRangeList& ranges) : exp_(exp),
+                                              ranges_(ranges),
+                                              count_(0) { }
+
+    void Run() {
+      XCDFFile f;
+      for (EventRangeList::const_iterator it = ranges_.begin();
+                                          it != ranges_.end(); ++it) {
+        f.Open(it->fileName_, "r");
+        EventSelectExpression expression(exp_, f);
+        EventRangeReader reader(f, *it);
+        while (reader.Read()) {
+          if (expression.SelectEvent()) {
+            ++count_;
+          }
+        }
+        f.Close();
+      }
+    }
+
+    uint64_t GetCount() const {return count_;}
+
+  private:
+
+    std::string exp_;
+    EventRangeList ranges_;
+    uint64_t count_;
+};
+
 void Count(std::vector<std::string>& infiles,
-           std::string& exp) {
+           std::string& exp,
+           unsigned nThreads) {
+
+  // Count on each thread over a part of the input and sum the counts
+  if (nThreads > 1 && infiles.size() > 0 && exp.compare("")) {
+
+    std::vector<EventRangeList> parts = PartitionEvents(infiles, nThreads);
+    TaskList<CountTask> tasks;
+    for (std::vector<EventRangeList>::const_iterator
+                          it = parts.begin(); it != parts.end(); ++it) {
+      if (it->size() > 0) {
+        tasks.Add(new CountTask(exp, *it));
+      }
+    }
+    tasks.Run();
+
+    uint64_t count = 0;
+    for (unsigned i = 0; i < tasks.Size(); ++i) {
+      count += tasks[i].GetCount();
+    }
+    std::cout << count << std::endl;
+    return;
+  }
 
   uint64_t count = 0;
   XCDFFile f;
@@ -285,52 +524,89 @@ void Count(std::vector<std::string>& infiles,
   std::cout << count << std::endl;
 }
 
-void Check(std::vector<std::string>& infiles) {
-
-  XCDFFile f;
-  for (unsigned i = 0; i <= infiles.size(); ++i) {
+/*
+ *  Check files taken in turn from a list shared by all threads, so
+ *  that large and small files balance across the threads.  Failures
+ *  are recorded per file.
+ */
+class CheckTask : public ThreadTask {
+
+  public:
+
+    CheckTask(const std::vector<std::string>& infiles,
+              bool inflate,
+              unsigned& next,
+              std::vector<std::string>& errors) : infiles_(infiles),
+                                                  inflate_(inflate),
+                                                  next_(next),
+                                                  errors_(errors) { }
+
+    void Run() {
+      for (;;) {
+        unsigned i = __sync_fetch_and_add(&next_, 1);
+        if (i >= infiles_.size()) {
+          return;
+        }
 
-    if (i == infiles.size()) {
-      if (infiles.size() == 0) {
-        //read from stdin
-        f.Open(std::cin);
-      } else {
-        continue;
+        try {
+          XCDFFile f;
+          f.Open(infiles_[i], "r");
+          f.CheckFrames(inflate_);
+          f.Close();
+        } catch (XCDFException& e) {
+          errors_[i] = e.GetMessage();
+        }
       }
-    } else {
-      f.Open(infiles[i], "r");
     }
 
-    // Allow internal checksum verification to detect errors
-    while (f.Read()) { /* Do nothing */ }
-    f.Close();
-  }
-}
+  private:
 
-std::set<std::string> ParseCSV(std::string& exp) {
+    const std::vector<std::string>& infiles_;
+    bool inflate_;
+    unsigned& next_;
+    std::vector<std::string>& errors_;
+};
 
-  std::set<std::string> fields;
+void Check(std::vector<std::string>& infiles,
+           bool inflate,
+           unsigned nThreads) {
 
-  char* expPtr = const_cast<char*>(exp.c_str());
-  for (char* tok = strtok(expPtr, ","); tok != NULL;
-                                             tok = strtok(NULL, ",")) {
+  // Frame checksums, ordering and the block table are checked without
+  // decoding any events
+  if (infiles.size() == 0) {
+    XCDFFile f;
+    f.Open(std::cin);
+    f.CheckFrames(inflate);
+    f.Close();
+    return;
+  }
 
-    std::string str(tok);
+  if (nThreads > infiles.size()) {
+    nThreads = infiles.size();
+  }
 
-    // Trim leading and trailing whitespace
-    size_t endPos = str.find_last_not_of(" \n\r\t");
-    if(endPos != std::string::npos) {
-      str = str.substr(0, endPos+1);
-    }
+  unsigned next = 0;
+  std::vector<std::string> errors(infiles.size());
+  std::vector<CheckTask> tasks(nThreads,
+                               CheckTask(infiles, inflate, next, errors));
+  std::vector<ThreadTask*> threadTasks;
+  for (unsigned i = 0; i < tasks.size(); ++i) {
+    threadTasks.push_back(&tasks[i]);
+  }
+  RunThreads(threadTasks);
 
-    size_t startPos = str.find_first_not_of(" \n\r\t");
-    if(startPos != std::string::npos) {
-      str = str.substr(startPos);
+  unsigned nFailed = 0;
+  for (unsigned i = 0; i < infiles.size(); ++i) {
+    if (!errors[i].empty()) {
+      std::cerr << "Check failed: " << infiles[i] << ": " <<
+                   errors[i] << std::endl;
+      nFailed++;
     }
+  }
 
-    fields.insert(str);
+  if (nFailed > 0) {
+    XCDFThrow(nFailed << " of " << infiles.size() << " files failed check");
   }
-  return fields;
 }
 
 void CopyComments(XCDFFile& destination,
@@ -362,6 +638,26 @@ void CopyAliases(XCDFFile& destination,
   }
 }
 
+/*
+ *  Copy the remaining events of source into destination.  When both
+ *  files have the same fields, the compressed block frames are copied
+ *  directly and only the block table is rebuilt.
+ */
+void CopyEvents(XCDFFile& destination,
+                XCDFFile& source,
+                FieldCopyBuffer& buf) {
+
+  if (source.IsFrameCopyCompatible(destination)) {
+    source.CopyFrames(destination);
+    return;
+  }
+
+  while (source.Read()) {
+    buf.CopyData();
+    destination.Write();
+  }
+}
+
 void SelectFields(std::vector<std::string>& infiles,
                   std::ostream& out,
                   std::string& exp,
@@ -412,11 +708,17 @@ void SelectFields(std::vector<std::string>& infiles,
     SelectFieldVisitor selectFieldVisitor(f, fields, buf);
     f.ApplyFieldVisitor(selectFieldVisitor);
 
-    while (f.Read()) {
+    // Copy the encoded block data directly when the output fields line
+    // up with the input fields, skipping decoding and re-encoding
+    if (f.IsBlockCopyCompatible(outFile)) {
+      while (f.CopyBlock(outFile));
+    } else {
+      while (f.Read()) {
 
-      // Copy the data
-      buf.CopyData();
-      outFile.Write();
+        // Copy the data
+        buf.CopyData();
+        outFile.Write();
+      }
     }
 
     CopyComments(outFile, f);
@@ -426,14 +728,127 @@ void SelectFields(std::vector<std::string>& infiles,
   outFile.Close();
 }
 
+/*
+ *  Writes the events satisfying an expression in a list of event ranges
+ *  to an XCDF file held in memory
+ */
+class SelectTask : public ThreadTask {
+
+  public:
+
+    SelectTask(const std::string& exp,
+               const EventRangeList& ranges) : exp_(exp),
+                                               ranges_(ranges) { }
+
+    void Run() {
+      XCDFFile outFile(static_cast<std::ostream&>(output_));
+      FieldCopyBuffer buf(outFile);
+      XCDFFile f;
+      for (EventRangeList::const_iterator it = ranges_.begin();
+                                          it != ranges_.end(); ++it) {
+        f.Open(it->fileName_, "r");
+
+        std::set<std::string> fields;
+        GetFieldNamesVisitor getFieldNamesVisitor(fields);
+        f.ApplyFieldVisitor(getFieldNamesVisitor);
+        SelectFieldVisitor selectFieldVisitor(f, fields, buf);
+        f.ApplyFieldVisitor(selectFieldVisitor);
+
+        EventSelectExpression expression(exp_, f);
+        EventRangeReader reader(f, *it);
+        while (reader.Read()) {
+          if (expression.SelectEvent()) {
+            buf.CopyData();
+            outFile.Write();
+          }
+        }
+        f.Close();
+      }
+      outFile.Close();
+    }
+
+    std::istream& GetOutput() {return output_;}
+
+  private:
+
+    std::string exp_;
+    EventRangeList ranges_;
+    std::stringstream output_;
+};
+
+/*
+ *  Select on several threads.  Each thread writes the selected events of
+ *  one part of the input to memory, and the parts are then copied to the
+ *  output in input order.  The parts are copied event by event rather than
+ *  by frame so the output blocks, and therefore the stored values, are the
+ *  same as a serial select.  A few parts per thread are done at a time to
+ *  bound the memory used.
+ */
+void SelectParallel(std::vector<std::string>& infiles,
+                    XCDFFile& outFile,
+                    std::string& exp,
+                    unsigned nThreads) {
+
+  FieldCopyBuffer buf(outFile);
+  std::set<std::string> fields;
+  XCDFFile f;
+
+  // The output fields and aliases come from the first file
+  f.Open(infiles[0], "r");
+  GetFieldNamesVisitor getFieldNamesVisitor(fields);
+  f.ApplyFieldVisitor(getFieldNamesVisitor);
+  SelectFieldVisitor selectFieldVisitor(f, fields, buf);
+  f.ApplyFieldVisitor(selectFieldVisitor);
+  CopyAliases(outFile, f);
+  f.Close();
+
+  std::vector<EventRangeList> parts = PartitionEvents(infiles, 16 * nThreads);
+  for (unsigned first = 0; first < parts.size(); first += nThreads) {
+
+    TaskList<SelectTask> tasks;
+    for (unsigned i = first; i < first + nThreads &&
+                             i < parts.size(); ++i) {
+      if (parts[i].size() > 0) {
+        tasks.Add(new SelectTask(exp, parts[i]));
+      }
+    }
+    tasks.Run();
+
+    for (unsigned i = 0; i < tasks.Size(); ++i) {
+      XCDFFile part(tasks[i].GetOutput());
+      SelectFieldVisitor partVisitor(part, fields, buf);
+      part.ApplyFieldVisitor(partVisitor);
+      while (part.Read()) {
+        buf.CopyData();
+        outFile.Write();
+      }
+      part.Close();
+    }
+  }
+
+  for (unsigned i = 0; i < infiles.size(); ++i) {
+    f.Open(infiles[i], "r");
+    CopyComments(outFile, f);
+    CopyAliases(outFile, f);
+    f.Close();
+  }
+}
+
 void Select(std::vector<std::string>& infiles,
             std::ostream& out,
             std::string& exp,
-            std::string& concatArgs) {
+            std::string& concatArgs,
+            unsigned nThreads) {
 
   XCDFFile outFile(out);
   outFile.AddComment(concatArgs);
 
+  if (nThreads > 1 && infiles.size() > 0) {
+    SelectParallel(infiles, outFile, exp, nThreads);
+    outFile.Close();
+    return;
+  }
+
   FieldCopyBuffer buf(outFile);
 
   // Spin through the files and copy the data
@@ -483,6 +898,71 @@ void Select(std::vector<std::string>& infiles,
   outFile.Close();
 }
 
+/*
+ *  Copy all events, storing the fields matching exp with the given
+ *  encoding and the remaining fields plain, and optionally shuffling
+ *  the block data
+ */
+void Encode(std::vector<std::string>& infiles,
+            std::ostream& out,
+            std::string& exp,
+            XCDFFieldEncoding encoding,
+            bool shuffle,
+            std::string& concatArgs) {
+
+  XCDFFile outFile(out);
+  outFile.AddComment(concatArgs);
+  outFile.SetShuffle(shuffle);
+  std::set<std::string> fieldSpecs = ParseCSV(exp);
+
+  FieldCopyBuffer buf(outFile);
+
+  // Spin through the files and copy the data
+  XCDFFile f;
+  for (unsigned i = 0; i <= infiles.size(); ++i) {
+
+    if (i == infiles.size()) {
+      if (infiles.size() == 0) {
+        //read from stdin
+        f.Open(std::cin);
+      } else {
+        continue;
+      }
+    } else {
+      f.Open(infiles[i], "r");
+    }
+
+    // Get the names of all the fields
+    std::set<std::string> fields;
+    GetFieldNamesVisitor getFieldNamesVisitor(fields);
+    f.ApplyFieldVisitor(getFieldNamesVisitor);
+
+    // Load the fields into the buffer for copying
+    bool allocate = outFile.GetNFields() == 0;
+    SelectFieldVisitor selectFieldVisitor(f, fields, buf);
+    f.ApplyFieldVisitor(selectFieldVisitor);
+
+    // Choose the encodings when the output fields are first allocated
+    if (allocate) {
+      MatchFieldsVisitor match(fieldSpecs);
+      f.ApplyFieldVisitor(match);
+      const std::set<std::string>& encoded = match.GetMatches();
+      for (std::set<std::string>::const_iterator it = fields.begin();
+                                                 it != fields.end(); ++it) {
+        outFile.SetFieldEncoding(*it, encoded.find(*it) == encoded.end() ?
+                                      XCDF_ENCODING_PLAIN : encoding);
+      }
+    }
+
+    CopyAliases(outFile, f);
+    CopyEvents(outFile, f, buf);
+    CopyComments(outFile, f);
+    f.Close();
+  }
+
+  outFile.Close();
+}
+
 void Compare(const std::string& fileName1,
              const std::string& fileName2) {
 
@@ -603,12 +1083,7 @@ void RemoveComments(std::vector<std::string>& infiles,
   f.ApplyFieldVisitor(selectFieldVisitor);
 
   CopyAliases(outFile, f);
-  while (f.Read()) {
-
-    // Copy the data if true
-    buf.CopyData();
-    outFile.Write();
-  }
+  CopyEvents(outFile, f, buf);
   CopyAliases(outFile, f);
   outFile.Close();
 }
@@ -661,10 +1136,7 @@ void RemoveAlias(std::vector<std::string>& infiles,
     // Need to copy at beginning to ensure all known aliases are
     // placed into the header of the new file if at all possible
     CopyAliases(outFile, f, name);
-    while (f.Read()) {
-      buf.CopyData();
-      outFile.Write();
-    }
+    CopyEvents(outFile, f, buf);
 
     CopyComments(outFile, f);
     // Copy any aliases unavailable at beginning
@@ -721,10 +1193,7 @@ void AddAlias(std::vector<std::string>& infiles,
     // Need to copy at beginning to ensure all known aliases are
     // placed into the header of the new file if at all possible
     CopyAliases(outFile, f);
-    while (f.Read()) {
-      buf.CopyData();
-      outFile.Write();
-    }
+    CopyEvents(outFile, f, buf);
 
     CopyComments(outFile, f);
     // Copy any aliases unavailable at beginning
@@ -735,50 +1204,14 @@ void AddAlias(std::vector<std::string>& infiles,
   outFile.Close();
 }
 
-void AddComment(std::vector<std::string>& infiles,
-                std::ostream& out,
-                const std::string& comment) {
-
-  XCDFFile f;
-  if (infiles.size() == 0) {
-    f.Open(std::cin);
-  } else if (infiles.size() == 1) {
-    f.Open(infiles[0], "r");
-  } else {
-    std::cerr << "Only one input file is allowed for add-comment."
-                                              " Quitting" << std::endl;
-    exit(1);
-  }
+void Merge(std::vector<std::string>& infiles,
+           std::ostream& out) {
 
+  // Write the input files as one file with a single block table
   XCDFFile outFile(out);
+  FieldCopyBuffer buf(outFile);
 
-  // Get the names of all the fields
-  std::set<std::string> fields;
-  GetFieldNamesVisitor getFieldNamesVisitor(fields);
-  f.ApplyFieldVisitor(getFieldNamesVisitor);
-
-  // Load the fields into the buffer for copying
-  FieldCopyBuffer buf(outFile);
-  SelectFieldVisitor selectFieldVisitor(f, fields, buf);
-  f.ApplyFieldVisitor(selectFieldVisitor);
-
-  CopyAliases(outFile, f);
-  while (f.Read()) {
-
-    // Copy the data if true
-    buf.CopyData();
-    outFile.Write();
-  }
-
-  CopyComments(outFile, f);
-  outFile.AddComment(comment);
-  CopyAliases(outFile, f);
-  outFile.Close();
-}
-
-void Comments(std::vector<std::string>& infiles,
-              std::ostream& out) {
-
+  // Spin through the files and copy the data
   XCDFFile f;
   for (unsigned i = 0; i <= infiles.size(); ++i) {
 
@@ -793,47 +1226,75 @@ void Comments(std::vector<std::string>& infiles,
       f.Open(infiles[i], "r");
     }
 
-    f.LoadComments();
-    for (std::vector<std::string>::const_iterator
-                                   it = f.CommentsBegin();
-                                   it != f.CommentsEnd(); ++it) {
+    // Get the names of all the fields
+    std::set<std::string> fields;
+    GetFieldNamesVisitor getFieldNamesVisitor(fields);
+    f.ApplyFieldVisitor(getFieldNamesVisitor);
 
-      out << *it << std::endl;
-    }
+    // Load the fields into the buffer for copying
+    SelectFieldVisitor selectFieldVisitor(f, fields, buf);
+    f.ApplyFieldVisitor(selectFieldVisitor);
+
+    // Need to copy at beginning to ensure all known aliases are
+    // placed into the header of the new file if at all possible
+    CopyAliases(outFile, f);
+    CopyEvents(outFile, f, buf);
+
+    CopyComments(outFile, f);
+    // Copy any aliases unavailable at beginning
+    CopyAliases(outFile, f);
+    f.Close();
   }
+
+  outFile.Close();
 }
 
-template <typename Histogram, typename FillPolicy>
-void FillHistogram(std::vector<std::string>& infiles,
-                   Histogram& h, FillPolicy& fill) {
+void AddComment(std::vector<std::string>& infiles,
+                std::ostream& out,
+                const std::string& comment) {
 
   XCDFFile f;
-  for (unsigned i = 0; i <= infiles.size(); ++i) {
+  if (infiles.size() == 0) {
+    f.Open(std::cin);
+  } else if (infiles.size() == 1) {
+    f.Open(infiles[0], "r");
+  } else {
+    std::cerr << "Only one input file is allowed for add-comment."
+                                              " Quitting" << std::endl;
+    exit(1);
+  }
 
-    if (i == infiles.size()) {
-      if (infiles.size() == 0) {
-        //read from stdin
-        f.Open(std::cin);
-      } else {
-        continue;
-      }
-    } else {
-      f.Open(infiles[i], "r");
-    }
+  XCDFFile outFile(out);
 
-    fill.Fill(h, f);
-  }
+  // Get the names of all the fields
+  std::set<std::string> fields;
+  GetFieldNamesVisitor getFieldNamesVisitor(fields);
+  f.ApplyFieldVisitor(getFieldNamesVisitor);
+
+  // Load the fields into the buffer for copying
+  FieldCopyBuffer buf(outFile);
+  SelectFieldVisitor selectFieldVisitor(f, fields, buf);
+  f.ApplyFieldVisitor(selectFieldVisitor);
+
+  CopyAliases(outFile, f);
+  CopyEvents(outFile, f, buf);
+
+  CopyComments(outFile, f);
+  outFile.AddComment(comment);
+  CopyAliases(outFile, f);
+  outFile.Close();
 }
 
-void CheckRange(std::vector<std::string>& infiles,
-                RangeChecker& rc) {
+void Comments(std::vector<std::string>& infiles,
+              std::ostream& out) {
 
   XCDFFile f;
   for (unsigned i = 0; i <= infiles.size(); ++i) {
 
     if (i == infiles.size()) {
       if (infiles.size() == 0) {
-        XCDFFatal("Cannot fill variable range histogram from stdin")
+        //read from stdin
+        f.Open(std::cin);
       } else {
         continue;
       }
@@ -841,7 +1302,13 @@ void CheckRange(std::vector<std::string>& infiles,
       f.Open(infiles[i], "r");
     }
 
-    rc.Fill(f);
+    f.LoadComments();
+    for (std::vector<std::string>::const_iterator
+                                   it = f.CommentsBegin();
+                                   it != f.CommentsEnd(); ++it) {
+
+      out << *it << std::endl;
+    }
   }
 }
 
@@ -895,8 +1362,34 @@ void ProcessExpression(const std::string& exp,
   }
 }
 
-void CreateHistogram(std::vector<std::string>& infiles,
-                     std::string& exp) {
+struct HistogramSpec {
+
+  HistogramSpec() : is2D(false),
+                    hasRange(false),
+                    nbinsX(0),
+                    nbinsY(0),
+                    minX(0.),
+                    maxX(0.),
+                    minY(0.),
+                    maxY(0.),
+                    weightExpr("1."),
+                    storage("dense") { }
+
+  bool is2D;
+  bool hasRange;
+  unsigned nbinsX;
+  unsigned nbinsY;
+  double minX;
+  double maxX;
+  double minY;
+  double maxY;
+  std::string exprX;
+  std::string exprY;
+  std::string weightExpr;
+  std::string storage;
+};
+
+bool ParseHistogram(std::string& exp, HistogramSpec& spec) {
 
   // Parse CSV expression
   std::vector<std::string> args;
@@ -905,59 +1398,45 @@ void CreateHistogram(std::vector<std::string>& infiles,
   if (!(args.size() == 2 || args.size() == 3 ||
         args.size() == 4 || args.size() == 5)) {
     std::cerr << "Invalid histogram args: " << exp << std::endl;
-    return;
+    return false;
   }
 
-  unsigned nbins;
-  double min, max;
-  std::string expr;
-  std::string weightExpr = "1.";
   bool fail = false;
-  fail |= Extract(args[0], nbins);
+  fail |= Extract(args[0], spec.nbinsX);
   if (args.size() == 4 || args.size() == 5) {
-    fail |= Extract(args[1], min);
-    fail |= Extract(args[2], max);
+    fail |= Extract(args[1], spec.minX);
+    fail |= Extract(args[2], spec.maxX);
     if (fail) {
       std::cerr << "Invalid histogram args: " << exp << std::endl;
-      return;
+      return false;
     }
-    if (nbins == 0) {
+    if (spec.nbinsX == 0) {
       std::cerr << "Number of bins must be greater than zero" << std::endl;
-      return;
+      return false;
     }
-    if (min > max) {
+    if (spec.minX > spec.maxX) {
       std::cerr << "Histogram range min must be less than max" << std::endl;
-      return;
+      return false;
     }
-    expr = args[3];
+    spec.exprX = args[3];
     if (args.size() == 5) {
-      weightExpr = args[4];
+      spec.weightExpr = args[4];
     }
+    spec.hasRange = true;
   } else {
-    expr = args[1];
+    spec.exprX = args[1];
     if (args.size() == 3) {
-      weightExpr = args[2];
+      spec.weightExpr = args[2];
     }
     if (fail) {
       std::cerr << "Invalid histogram args: " << exp << std::endl;
-      return;
+      return false;
     }
-    RangeChecker rc(expr);
-    CheckRange(infiles, rc);
-    min = rc.GetMin();
-    max = rc.GetMax();
-
-    FixBins(min, max, nbins);
   }
-
-  Histogram1D h(nbins, min, max);
-  Filler1D fill(expr, weightExpr);
-  FillHistogram(infiles, h, fill);
-  std::cout << h;
+  return true;
 }
 
-void CreateHistogram2D(std::vector<std::string>& infiles,
-                       std::string& exp) {
+bool ParseHistogram2D(std::string& exp, HistogramSpec& spec) {
 
   // Parse CSV expression
   std::vector<std::string> args;
@@ -966,71 +1445,571 @@ void CreateHistogram2D(std::vector<std::string>& infiles,
   if (!(args.size() == 4 || args.size() == 5 ||
         args.size() == 8 || args.size() == 9)) {
     std::cerr << "Invalid histogram args: " << exp << std::endl;
-    return;
+    return false;
   }
 
-  unsigned nbinsX, nbinsY;
-  double minX, maxX, minY, maxY;
-  std::string exprX, exprY;
-  std::string weightExpr = "1.";
+  spec.is2D = true;
   bool fail = false;
-  fail |= Extract(args[0], nbinsX);
+  fail |= Extract(args[0], spec.nbinsX);
   if (args.size() == 8 || args.size() == 9) {
-    fail |= Extract(args[1], minX);
-    fail |= Extract(args[2], maxX);
-    exprX = args[3];
-    fail |= Extract(args[4], nbinsY);
-    fail |= Extract(args[5], minY);
-    fail |= Extract(args[6], maxY);
-    exprY = args[7];
+    fail |= Extract(args[1], spec.minX);
+    fail |= Extract(args[2], spec.maxX);
+    spec.exprX = args[3];
+    fail |= Extract(args[4], spec.nbinsY);
+    fail |= Extract(args[5], spec.minY);
+    fail |= Extract(args[6], spec.maxY);
+    spec.exprY = args[7];
     if (args.size() == 9) {
-      weightExpr = args[8];
+      spec.weightExpr = args[8];
     }
     if (fail) {
       std::cerr << "Invalid histogram args: " << exp << std::endl;
-      return;
+      return false;
     }
-    if (nbinsX == 0 || nbinsY == 0) {
+    if (spec.nbinsX == 0 || spec.nbinsY == 0) {
       std::cerr << "Number of bins must be greater than zero" << std::endl;
-      return;
+      return false;
     }
-    if (minX > maxX || minY > maxY) {
+    if (spec.minX > spec.maxX || spec.minY > spec.maxY) {
       std::cerr << "Histogram range min must be less than max" << std::endl;
-      return;
+      return false;
     }
+    spec.hasRange = true;
   } else {
-    exprX = args[1];
-    fail |= Extract(args[2], nbinsY);
-    exprY = args[3];
+    spec.exprX = args[1];
+    fail |= Extract(args[2], spec.nbinsY);
+    spec.exprY = args[3];
     if (args.size() == 5) {
-      weightExpr = args[4];
+      spec.weightExpr = args[4];
     }
     if (fail) {
       std::cerr << "Invalid histogram args: " << exp << std::endl;
-      return;
+      return false;
     }
-    if (nbinsX == 0 || nbinsY == 0) {
+    if (spec.nbinsX == 0 || spec.nbinsY == 0) {
       std::cerr << "Number of bins must be greater than zero" << std::endl;
-      return;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ParseHistograms(std::vector<std::pair<unsigned, std::string> >& exps,
+                     std::vector<HistogramSpec>& specs) {
+
+  // Each argument may hold several histogram expressions separated by ';'
+  for (std::vector<std::pair<unsigned, std::string> >::iterator
+                            it = exps.begin(); it != exps.end(); ++it) {
+
+    size_t start = 0;
+    while (start <= it->second.size()) {
+      size_t end = it->second.find(';', start);
+      if (end == std::string::npos) {
+        end = it->second.size();
+      }
+      std::string exp = it->second.substr(start, end - start);
+      start = end + 1;
+      if (exp.find_first_not_of(" \n\r\t") == std::string::npos) {
+        continue;
+      }
+
+      HistogramSpec spec;
+      bool ok = it->first == 2 ? ParseHistogram2D(exp, spec) :
+                                 ParseHistogram(exp, spec);
+      if (!ok) {
+        return false;
+      }
+      specs.push_back(spec);
+    }
+  }
+  return specs.size() > 0;
+}
+
+RangeChecker GetRangeChecker(const HistogramSpec& spec) {
+
+  std::vector<std::string> exprs(1, spec.exprX);
+  if (spec.is2D) {
+    exprs.push_back(spec.exprY);
+  }
+  return RangeChecker(exprs);
+}
+
+void SetRange(HistogramSpec& spec, RangeChecker& rc) {
+
+  spec.minX = rc.GetMin(0);
+  spec.maxX = rc.GetMax(0);
+  FixBins(spec.minX, spec.maxX, spec.nbinsX);
+  if (spec.is2D) {
+    spec.minY = rc.GetMin(1);
+    spec.maxY = rc.GetMax(1);
+    FixBins(spec.minY, spec.maxY, spec.nbinsY);
+  }
+  spec.hasRange = true;
+}
+
+void CheckRanges(std::vector<std::string>& infiles,
+                 std::vector<HistogramSpec>& specs) {
+
+  // Histograms without a given range take the range from the field
+  // globals where it can be bounded, which needs no pass through the
+  // events.  Whatever is left is buffered during the fill pass.
+  if (infiles.size() == 0) {
+    return;
+  }
+
+  std::vector<RangeChecker> checkers;
+  std::vector<bool> useGlobals(specs.size(), false);
+  bool anyGlobals = false;
+  for (unsigned i = 0; i < specs.size(); ++i) {
+    checkers.push_back(GetRangeChecker(specs[i]));
+    useGlobals[i] = !specs[i].hasRange;
+    anyGlobals |= useGlobals[i];
+  }
+
+  if (!anyGlobals) {
+    return;
+  }
+
+  XCDFFile f;
+  for (unsigned i = 0; i < infiles.size(); ++i) {
+    f.Open(infiles[i], "r");
+    for (unsigned j = 0; j < specs.size(); ++j) {
+      if (useGlobals[j]) {
+        useGlobals[j] = checkers[j].FillFromGlobals(f);
+      }
     }
-    std::vector<std::string> exprs;
-    exprs.push_back(exprX);
-    exprs.push_back(exprY);
-    RangeChecker rc(exprs);
-    CheckRange(infiles, rc);
-    minX = rc.GetMin(0);
-    maxX = rc.GetMax(0);
-    minY = rc.GetMin(1);
-    maxY = rc.GetMax(1);
+    f.Close();
+  }
 
-    FixBins(minX, maxX, nbinsX);
-    FixBins(minY, maxY, nbinsY);
+  for (unsigned i = 0; i < specs.size(); ++i) {
+    if (useGlobals[i]) {
+      SetRange(specs[i], checkers[i]);
+    }
   }
+}
+
+bool ValidHistogramStorage(const std::string& storage) {
+  return !storage.compare("dense") || !storage.compare("interleaved") ||
+         !storage.compare("sparse") || !storage.compare("atomic");
+}
+
+/*
+ *  A 2D histogram with any of the bin storage backends in Histogram.h
+ */
+class Histogram2DHolder {
+
+  public:
+
+    virtual ~Histogram2DHolder() { }
+
+    virtual BoundFillerPtr Bind(const Filler2D& fill,
+                                const XCDFFile& f) = 0;
+    virtual void Replay(BufferedHistogram2D& buffer) = 0;
+    virtual void Add(const Histogram2DHolder& h) = 0;
+    virtual void Print(std::ostream& out) const = 0;
+};
+
+typedef XCDFPtr<Histogram2DHolder> Histogram2DHolderPtr;
 
-  Histogram2D h(nbinsX, minX, maxX, nbinsY, minY, maxY);
-  Filler2D fill(exprX, exprY, weightExpr);
-  FillHistogram(infiles, h, fill);
-  std::cout << h;
+template <typename Storage>
+class Histogram2DHolderImpl : public Histogram2DHolder {
+
+  public:
+
+    Histogram2DHolderImpl(const HistogramSpec& s) : h_(s.nbinsX, s.minX,
+                                                       s.maxX, s.nbinsY,
+                                                       s.minY, s.maxY) { }
+
+    BoundFillerPtr Bind(const Filler2D& fill, const XCDFFile& f) {
+      return fill.Bind(h_, f);
+    }
+
+    void Replay(BufferedHistogram2D& buffer) {buffer.Replay(h_);}
+
+    // Only holders of the same spec are ever added
+    void Add(const Histogram2DHolder& h) {
+      h_.Add(static_cast<const Histogram2DHolderImpl&>(h).h_);
+    }
+
+    void Print(std::ostream& out) const {out << h_;}
+
+  private:
+
+    BasicHistogram2D<Storage> h_;
+};
+
+Histogram2DHolderPtr CreateHistogram2D(const HistogramSpec& s) {
+
+  if (!s.storage.compare("interleaved")) {
+    return Histogram2DHolderPtr(
+             new Histogram2DHolderImpl<InterleavedHistogramStorage>(s));
+  } else if (!s.storage.compare("sparse")) {
+    return Histogram2DHolderPtr(
+             new Histogram2DHolderImpl<SparseHistogramStorage>(s));
+  } else if (!s.storage.compare("atomic")) {
+    return Histogram2DHolderPtr(
+             new Histogram2DHolderImpl<AtomicHistogramStorage>(s));
+  }
+  return Histogram2DHolderPtr(
+           new Histogram2DHolderImpl<DenseHistogramStorage>(s));
+}
+
+/*
+ *  The histograms of a list of specifications, filled together.  Those
+ *  without a known range are buffered until Merge() can determine the
+ *  range from all of the fills.
+ */
+class HistogramSet {
+
+  public:
+
+    HistogramSet(const std::vector<HistogramSpec>& specs) :
+                                        specs_(specs),
+                                        h1_(specs.size()),
+                                        h2_(specs.size()),
+                                        b1_(specs.size()),
+                                        b2_(specs.size()) {
+
+      for (unsigned i = 0; i < specs_.size(); ++i) {
+        const HistogramSpec& s = specs_[i];
+        checkers_.push_back(GetRangeChecker(s));
+        if (!s.is2D && s.hasRange) {
+          h1_[i] = xcdf_shared(new Histogram1D(s.nbinsX, s.minX, s.maxX));
+        } else if (!s.is2D) {
+          b1_[i] = xcdf_shared(new BufferedHistogram1D());
+        } else if (s.hasRange) {
+          h2_[i] = CreateHistogram2D(s);
+        } else {
+          b2_[i] = xcdf_shared(new BufferedHistogram2D());
+        }
+      }
+    }
+
+    void Fill(XCDFFile& f) {
+
+      std::vector<BoundFillerPtr> fillers;
+      Bind(f, fillers);
+      while (f.Read()) {
+        Fill(fillers);
+      }
+    }
+
+    void Fill(XCDFFile& f, const EventRange& range) {
+
+      std::vector<BoundFillerPtr> fillers;
+      Bind(f, fillers);
+      EventRangeReader reader(f, range);
+      while (reader.Read()) {
+        Fill(fillers);
+      }
+    }
+
+    // Add the fills of sets with the same specifications into this
+    // set, in order, then replay the buffered fills
+    void Merge(std::vector<HistogramSet*>& parts) {
+
+      for (unsigned i = 0; i < specs_.size(); ++i) {
+
+        HistogramSpec& s = specs_[i];
+        if (s.hasRange) {
+          for (std::vector<HistogramSet*>::iterator
+                            it = parts.begin(); it != parts.end(); ++it) {
+            if (*it == this) {
+              continue;
+            }
+            if (s.is2D) {
+              // Shared atomic histograms already hold every fill
+              if (&*h2_[i] != &*(*it)->h2_[i]) {
+                h2_[i]->Add(*(*it)->h2_[i]);
+              }
+            } else {
+              h1_[i]->Add(*(*it)->h1_[i]);
+            }
+          }
+          continue;
+        }
+
+        // Buffered: find the range over all of the parts, then replay
+        for (std::vector<HistogramSet*>::iterator
+                            it = parts.begin(); it != parts.end(); ++it) {
+          if (*it != this) {
+            checkers_[i].Add((*it)->checkers_[i]);
+          }
+        }
+        SetRange(s, checkers_[i]);
+
+        if (!s.is2D) {
+          h1_[i] = xcdf_shared(new Histogram1D(s.nbinsX, s.minX, s.maxX));
+          for (std::vector<HistogramSet*>::iterator
+                            it = parts.begin(); it != parts.end(); ++it) {
+            (*it)->b1_[i]->Replay(*h1_[i]);
+          }
+        } else {
+          h2_[i] = CreateHistogram2D(s);
+          for (std::vector<HistogramSet*>::iterator
+                            it = parts.begin(); it != parts.end(); ++it) {
+            h2_[i]->Replay(*(*it)->b2_[i]);
+          }
+        }
+      }
+
+      for (std::vector<HistogramSet*>::iterator
+                            it = parts.begin(); it != parts.end(); ++it) {
+        (*it)->b1_.assign(specs_.size(), XCDFPtr<BufferedHistogram1D>());
+        (*it)->b2_.assign(specs_.size(), XCDFPtr<BufferedHistogram2D>());
+      }
+    }
+
+    void Merge() {
+      std::vector<HistogramSet*> parts(1, this);
+      Merge(parts);
+    }
+
+    // Fill the atomic 2D histograms of another set directly instead of
+    // filling a copy of them.  Call before filling either set.
+    void Share(HistogramSet& set) {
+      for (unsigned i = 0; i < specs_.size(); ++i) {
+        const HistogramSpec& s = specs_[i];
+        if (s.is2D && s.hasRange && !s.storage.compare("atomic")) {
+          h2_[i] = set.h2_[i];
+        }
+      }
+    }
+
+    void Print(std::ostream& out) const {
+
+      // Histogram output changes the stream precision.  Reset it so each
+      // histogram prints as it would on its own.
+      std::streamsize precision = out.precision();
+      for (unsigned i = 0; i < specs_.size(); ++i) {
+        out.precision(precision);
+        if (specs_[i].is2D) {
+          h2_[i]->Print(out);
+        } else {
+          out << *h1_[i];
+        }
+      }
+    }
+
+  private:
+
+    std::vector<HistogramSpec> specs_;
+    std::vector<XCDFPtr<Histogram1D> > h1_;
+    std::vector<Histogram2DHolderPtr> h2_;
+    std::vector<XCDFPtr<BufferedHistogram1D> > b1_;
+    std::vector<XCDFPtr<BufferedHistogram2D> > b2_;
+    std::vector<RangeChecker> checkers_;
+
+    void Bind(const XCDFFile& f, std::vector<BoundFillerPtr>& fillers) {
+
+      for (unsigned i = 0; i < specs_.size(); ++i) {
+        const HistogramSpec& s = specs_[i];
+        if (!s.is2D) {
+          Filler1D fill(s.exprX, s.weightExpr);
+          fillers.push_back(h1_[i].IsNull() ? fill.Bind(*b1_[i], f) :
+                                              fill.Bind(*h1_[i], f));
+        } else {
+          Filler2D fill(s.exprX, s.exprY, s.weightExpr);
+          fillers.push_back(h2_[i].IsNull() ? fill.Bind(*b2_[i], f) :
+                                              h2_[i]->Bind(fill, f));
+        }
+        if (!s.hasRange) {
+          fillers.push_back(BoundFillerPtr(new RangeFiller(checkers_[i], f)));
+        }
+      }
+    }
+
+    void Fill(std::vector<BoundFillerPtr>& fillers) {
+      for (std::vector<BoundFillerPtr>::iterator it = fillers.begin();
+                                                 it != fillers.end(); ++it) {
+        (*it)->Fill();
+      }
+    }
+
+    // Disallow copy: the fill buffers are not shared
+    HistogramSet(const HistogramSet& set);
+    HistogramSet& operator=(const HistogramSet& set);
+};
+
+/*
+ *  Fills a HistogramSet from a list of event ranges on its own thread
+ */
+class HistogramFillTask : public ThreadTask {
+
+  public:
+
+    HistogramFillTask(const std::vector<HistogramSpec>& specs,
+                      const EventRangeList& ranges) : set_(specs),
+                                                      ranges_(ranges) { }
+
+    void Run() {
+      XCDFFile f;
+      for (EventRangeList::const_iterator it = ranges_.begin();
+                                          it != ranges_.end(); ++it) {
+        f.Open(it->fileName_, "r");
+        set_.Fill(f, *it);
+        f.Close();
+      }
+    }
+
+    HistogramSet& GetHistogramSet() {return set_;}
+
+  private:
+
+    HistogramSet set_;
+    EventRangeList ranges_;
+};
+
+void CreateHistograms(std::vector<std::string>& infiles,
+                      std::vector<std::pair<unsigned, std::string> >& exps,
+                      unsigned nThreads,
+                      const std::string& storage) {
+
+  std::vector<HistogramSpec> specs;
+  if (!ParseHistograms(exps, specs)) {
+    return;
+  }
+
+  for (unsigned i = 0; i < specs.size(); ++i) {
+    specs[i].storage = storage;
+  }
+
+  CheckRanges(infiles, specs);
+
+  // Parallel fill: each thread fills its own copy of the histograms
+  // from a contiguous part of the input, and the copies are merged
+  // in input order.
+  if (nThreads > 1 && infiles.size() > 0) {
+
+    std::vector<EventRangeList> parts = PartitionEvents(infiles, nThreads);
+    TaskList<HistogramFillTask> tasks;
+    std::vector<HistogramSet*> sets;
+    for (std::vector<EventRangeList>::const_iterator
+                          it = parts.begin(); it != parts.end(); ++it) {
+      if (it->size() > 0) {
+        tasks.Add(new HistogramFillTask(specs, *it));
+        sets.push_back(&tasks[tasks.Size() - 1].GetHistogramSet());
+        sets.back()->Share(*sets[0]);
+      }
+    }
+    tasks.Run();
+
+    sets[0]->Merge(sets);
+    sets[0]->Print(std::cout);
+    return;
+  }
+
+  // Fill everything in a single pass through the data
+  HistogramSet set(specs);
+  XCDFFile f;
+  for (unsigned i = 0; i <= infiles.size(); ++i) {
+
+    if (i == infiles.size()) {
+      if (infiles.size() == 0) {
+        //read from stdin
+        f.Open(std::cin);
+      } else {
+        continue;
+      }
+    } else {
+      f.Open(infiles[i], "r");
+    }
+
+    set.Fill(f);
+  }
+
+  set.Merge();
+  set.Print(std::cout);
+}
+
+/*
+ *  Fills ExpressionStatistics from a list of event ranges on its own thread
+ */
+class StatisticsFillTask : public ThreadTask {
+
+  public:
+
+    StatisticsFillTask(const std::vector<std::string>& exprs,
+                       const EventRangeList& ranges) : stats_(exprs),
+                                                       ranges_(ranges) { }
+
+    void Run() {
+      XCDFFile f;
+      for (EventRangeList::const_iterator it = ranges_.begin();
+                                          it != ranges_.end(); ++it) {
+        f.Open(it->fileName_, "r");
+        std::vector<NumericalExpression<double> > nes;
+        for (unsigned i = 0; i < stats_.GetNExpressions(); ++i) {
+          nes.push_back(NumericalExpression<double>(
+                                    stats_.GetExpressions()[i], f));
+        }
+        EventRangeReader reader(f, *it);
+        while (reader.Read()) {
+          stats_.FillEvent(nes);
+        }
+        f.Close();
+      }
+    }
+
+    ExpressionStatistics& GetStatistics() {return stats_;}
+
+  private:
+
+    ExpressionStatistics stats_;
+    EventRangeList ranges_;
+};
+
+void Stats(std::vector<std::string>& infiles,
+           const std::string& exp,
+           unsigned nThreads) {
+
+  std::vector<std::string> exprs;
+  ProcessExpression(exp, exprs);
+  if (exprs.size() == 0) {
+    std::cerr << "Invalid stats expression: " << exp << std::endl;
+    return;
+  }
+
+  // Each thread sketches a contiguous part of the input, and the
+  // sketches are merged in input order
+  if (nThreads > 1 && infiles.size() > 0) {
+
+    std::vector<EventRangeList> parts = PartitionEvents(infiles, nThreads);
+    TaskList<StatisticsFillTask> tasks;
+    for (std::vector<EventRangeList>::const_iterator
+                          it = parts.begin(); it != parts.end(); ++it) {
+      if (it->size() > 0) {
+        tasks.Add(new StatisticsFillTask(exprs, *it));
+      }
+    }
+    tasks.Run();
+
+    for (unsigned i = 1; i < tasks.Size(); ++i) {
+      tasks[0].GetStatistics().Add(tasks[i].GetStatistics());
+    }
+    std::cout << tasks[0].GetStatistics();
+    return;
+  }
+
+  ExpressionStatistics stats(exprs);
+  XCDFFile f;
+  for (unsigned i = 0; i <= infiles.size(); ++i) {
+
+    if (i == infiles.size()) {
+      if (infiles.size() == 0) {
+        //read from stdin
+        f.Open(std::cin);
+      } else {
+        continue;
+      }
+    } else {
+      f.Open(infiles[i], "r");
+    }
+
+    stats.Fill(f);
+  }
+
+  std::cout << stats;
 }
 
 void Paste(std::vector<std::string>& infiles,
@@ -1134,14 +2113,27 @@ void PrintUsage() {
 
     "    dump     Output data event-by-event in a human-readable format.\n\n" <<
 
-    "    count    {-e expression} Count the number of events in the file.\n" <<
-    "             If optional expression is supplied, count only the\n" <<
-    "             events that satisfy the expression.\n\n" <<
-
-    "    csv      Output data into comma-separated-value format.\n\n" <<
-
-    "    check    Check if input is a valid XCDF file and check internal\n" <<
-    "             data checksums\n\n" <<
+    "    count    {-e expression} {-j nthreads} Count the number of events\n" <<
+    "             in the file.  If optional expression is supplied, count\n" <<
+    "             only the events that satisfy the expression, using\n" <<
+    "             nthreads threads if given.\n\n" <<
+
+    "    csv      {-f \"field1, field2, ...\"} {-d delimiter} {-j nthreads}\n" <<
+    "             {infiles}:\n\n" <<
+    "                    Output data into comma-separated-value format.\n" <<
+    "                    {-f} selects the fields to write, allowing a\n" <<
+    "                    wildcard \'*\' as for select-fields, and {-d}\n" <<
+    "                    sets the delimiter, e.g. a tab.  With\n" <<
+    "                    {-j nthreads}, input files are split by block\n" <<
+    "                    and formatted on nthreads threads, keeping the\n" <<
+    "                    output in input order.\n\n" <<
+
+    "    check    {-i} {-j nthreads} {infiles}:\n\n" <<
+    "                    Check if input is a valid XCDF file: verify the\n" <<
+    "                    internal data checksums, frame ordering and block\n" <<
+    "                    table without decoding events.  With {-i}, block\n" <<
+    "                    data is also test-inflated.  With {-j nthreads},\n" <<
+    "                    input files are checked on nthreads threads.\n\n" <<
 
     "    select-fields \"field1, field2, ...\" {-o outfile} {infiles}:\n\n" <<
 
@@ -1151,7 +2143,8 @@ void PrintUsage() {
     "                    A wildcard \'*\' character is allowed in matching\n" <<
     "                    field names.\n\n" <<
 
-    "    select \"boolean expression\" {-o outfile} {infiles}:\n\n" <<
+    "    select \"boolean expression\" {-o outfile} {-j nthreads}\n" <<
+    "           {infiles}:\n\n" <<
 
     "                    Copy events satisfying the given boolean\n" <<
     "                    expression into a new XCDF file at the path\n" <<
@@ -1160,7 +2153,34 @@ void PrintUsage() {
     "                    e.g.: \"field1 == 0\" to select all events\n" <<
     "                    where the value of field1 is zero.  The variable\n" <<
     "                    \"currentEventNumber\" refers to the current\n" <<
-    "                    event in the file.\n\n" <<
+    "                    event in the file.  With {-j nthreads}, input\n" <<
+    "                    files are split by block and selected on nthreads\n" <<
+    "                    threads, keeping the events in input order.\n\n" <<
+
+    "    encode \"field1, field2, ...\" {-o outfile} {-e encoding} {-s}\n" <<
+    "           {infiles}:\n\n" <<
+
+    "                    Copy all fields into a new XCDF file, storing the\n" <<
+    "                    given fields with the given encoding and the others\n" <<
+    "                    plain.  \"delta\" (default) stores the difference of\n" <<
+    "                    each value from the one before it in the blocks\n" <<
+    "                    where that takes fewer bits, as for monotonic or\n" <<
+    "                    slowly-varying fields, and the others plain.\n" <<
+    "                    \"mini-block\" packs each group of 128 values with\n" <<
+    "                    its own min and bit width, writing rare outliers\n" <<
+    "                    as exceptions.  \"dictionary\" stores the distinct\n" <<
+    "                    values of each block once and packs the index of\n" <<
+    "                    each value, for fields with few distinct values.\n" <<
+    "                    \"run-length\" stores each run of equal values once,\n" <<
+    "                    for mostly-zero or mostly-constant fields.\n" <<
+    "                    \"xor\" stores full-precision floating point values\n" <<
+    "                    as the XOR with the previous value, and keeps NaN\n" <<
+    "                    and infinite values from widening the block.\n" <<
+    "                    With {-s}, the block data is shuffled before\n" <<
+    "                    compression, so the same bits of every event are\n" <<
+    "                    stored together.\n" <<
+    "                    A wildcard \'*\' character is allowed in matching\n" <<
+    "                    field names.\n\n" <<
 
     "    paste {-d delimeter} {-c existingfile} {-o outfile} {infile}:\n\n" <<
 
@@ -1172,6 +2192,12 @@ void PrintUsage() {
 
     "    recover {-o outfile} {infiles} Recover a corrupt XCDF file.\n\n" <<
 
+    "    merge {-o outfile} {infiles}:\n\n" <<
+
+    "                    Combine the input files into one XCDF file with a\n" <<
+    "                    single block table.  Blocks of files with the same\n" <<
+    "                    fields are copied without decompressing them.\n\n" <<
+
     "    add-alias name \"expression\" {-o outfile} {infiles}:\n\n" <<
 
     "                    Add an alias to \"infile\" consisting of a numerical\n" <<
@@ -1193,7 +2219,9 @@ void PrintUsage() {
     "                    not specified, the removal is done in-place if possible.\n" <<
     "                    Only aliases added in-place may be removed in-place.\n\n" <<
 
-    "    histogram \"histogram expression\" {infiles}:\n\n" <<
+    "    histogram \"histogram expression\" {-1d \"expression\"}\n" <<
+    "              {-2d \"expression\"} {-j nthreads} {-s storage}\n" <<
+    "              {infiles}:\n\n" <<
     "                    Create a histogram from the selected files according to\n" <<
     "                    the specified expression.  Valid expressions are of the form\n" <<
     "                    \"nbins, min, max, expr\" or \"nbins, expr\", dynamically\n" <<
@@ -1202,15 +2230,32 @@ void PrintUsage() {
     "                    An optional expression may be appended\n" <<
     "                    to weight the entry, e.g. \"100, 0, 1, field1, field2\" would\n" <<
     "                    create a histogram of field1 with 100 bins from 0 to 1,\n" <<
-    "                    weighting each entry by the value of field2.\n\n" <<
-
-    "    histogram2d \"histogram expression\" {infiles}:\n\n" <<
+    "                    weighting each entry by the value of field2.\n" <<
+    "                    Several histograms separated by ';' and any number of\n" <<
+    "                    additional 1D (-1d) or 2D (-2d) histogram expressions\n" <<
+    "                    are filled in a single pass through the data.\n" <<
+    "                    With {-j nthreads}, input files are split by block\n" <<
+    "                    and filled on nthreads threads.\n\n" <<
+    "                    {-s storage} selects how 2D histogram bins are stored:\n" <<
+    "                    \"dense\" (default), \"interleaved\" weights, \"sparse\"\n" <<
+    "                    for mostly empty histograms, or \"atomic\", filled by\n" <<
+    "                    all threads at once when used with {-j nthreads}.\n\n" <<
+
+    "    histogram2d \"histogram expression\" {-1d \"expression\"}\n" <<
+    "                {-2d \"expression\"} {-j nthreads} {-s storage}\n" <<
+    "                {infiles}:\n\n" <<
     "                    Create a 2D histogram from the selected files according to\n" <<
     "                    the specified expression.  Valid expressions are of the form\n" <<
     "                    \"nbinsX, minX, maxX, exprX, nbinsY, minY, maxY, exprY\" or\n" <<
     "                    \"nbinsX, exprX, nbinsY, exprY\", dynamically determining min\n" <<
     "                    and max.  An optional expression may be appended to weight the\n" <<
-    "                    entry.\n\n" <<
+    "                    entry.  Multiple histograms are given as for \"histogram\".\n\n" <<
+
+    "    stats \"expr1, expr2, ...\" {-j nthreads} {infiles}:\n\n" <<
+    "                    Print the count, mean, standard deviation, range\n" <<
+    "                    and approximate quantiles of each expression in a\n" <<
+    "                    single pass.  With {-j nthreads}, input files are\n" <<
+    "                    split by block and read on nthreads threads.\n\n" <<
 
     "    comments {infiles} Display all comments from an XCDF file\n\n" <<
 
@@ -1249,27 +2294,44 @@ int do_main(int argc, char** argv) {
   std::vector<std::string> infiles;
   std::string copyFile = "";
   std::string delimeter = ",";
+  std::vector<std::pair<unsigned, std::string> > histExps;
+  unsigned nThreads = 1;
+  std::string storage = "dense";
+  XCDFFieldEncoding encoding = XCDF_ENCODING_DELTA;
+  bool shuffle = false;
   int currentArg = 2;
 
   if (!verb.compare("count")) {
 
-    if (currentArg < argc) {
+    while (currentArg < argc) {
+
       std::string out(argv[currentArg]);
+      if (out.compare("-e") && out.compare("-j")) {
+        break;
+      }
+
+      if (++currentArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
       if (!out.compare("-e")) {
 
-        if (++currentArg == argc) {
+        // Use the user-defined cut expression to count
+        exp = std::string(argv[currentArg++]);
+      } else {
+        std::string arg(argv[currentArg++]);
+        if (Extract(arg, nThreads) || nThreads == 0) {
           PrintUsage();
           exit(1);
         }
-
-        // Use the user-defined cut expression to count
-        exp = std::string(argv[currentArg++]);
       }
     }
   }
 
   if (!verb.compare("recover") || 
-      !verb.compare("remove-comments")) {
+      !verb.compare("remove-comments") ||
+      !verb.compare("merge")) {
 
     if (currentArg < argc) {
 
@@ -1295,11 +2357,133 @@ int do_main(int argc, char** argv) {
       exit(1);
     }
 
+    histExps.push_back(std::make_pair(verb.compare("histogram2d") ? 1u : 2u,
+                                      std::string(argv[currentArg++])));
+
+    // Additional histograms to fill in the same pass
+    while (currentArg < argc) {
+
+      std::string out(argv[currentArg]);
+      if (out.compare("-1d") && out.compare("-2d") &&
+          out.compare("-j") && out.compare("-s")) {
+        break;
+      }
+
+      if (++currentArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
+      if (!out.compare("-j")) {
+        std::string arg(argv[currentArg++]);
+        if (Extract(arg, nThreads) || nThreads == 0) {
+          PrintUsage();
+          exit(1);
+        }
+        continue;
+      }
+
+      if (!out.compare("-s")) {
+        storage = std::string(argv[currentArg++]);
+        if (!ValidHistogramStorage(storage)) {
+          PrintUsage();
+          exit(1);
+        }
+        continue;
+      }
+
+      histExps.push_back(std::make_pair(out.compare("-2d") ? 1u : 2u,
+                                        std::string(argv[currentArg++])));
+    }
+  }
+
+  if (!verb.compare("csv")) {
+
+    while (currentArg < argc) {
+
+      std::string out(argv[currentArg]);
+      if (out.compare("-f") && out.compare("-d") && out.compare("-j")) {
+        break;
+      }
+
+      if (++currentArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
+      if (!out.compare("-f")) {
+        exp = std::string(argv[currentArg++]);
+      } else if (!out.compare("-d")) {
+        delimeter = std::string(argv[currentArg++]);
+      } else {
+        std::string arg(argv[currentArg++]);
+        if (Extract(arg, nThreads) || nThreads == 0) {
+          PrintUsage();
+          exit(1);
+        }
+      }
+    }
+  }
+
+  bool inflate = false;
+  if (!verb.compare("check")) {
+
+    while (currentArg < argc) {
+
+      std::string out(argv[currentArg]);
+      if (!out.compare("-i")) {
+        inflate = true;
+        currentArg++;
+        continue;
+      }
+
+      if (out.compare("-j")) {
+        break;
+      }
+
+      if (++currentArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
+      std::string arg(argv[currentArg++]);
+      if (Extract(arg, nThreads) || nThreads == 0) {
+        PrintUsage();
+        exit(1);
+      }
+    }
+  }
+
+  if (!verb.compare("stats")) {
+
+    if (argc < 3) {
+      PrintUsage();
+      exit(1);
+    }
     exp = std::string(argv[currentArg++]);
+
+    if (currentArg < argc) {
+
+      std::string out(argv[currentArg]);
+      if (!out.compare("-j")) {
+
+        if (++currentArg == argc) {
+          PrintUsage();
+          exit(1);
+        }
+
+        std::string arg(argv[currentArg++]);
+        if (Extract(arg, nThreads) || nThreads == 0) {
+          PrintUsage();
+          exit(1);
+        }
+      }
+    }
   }
 
   if (!verb.compare("select") ||
       !verb.compare("select-fields") ||
+      !verb.compare("encode") ||
       !verb.compare("add-comment") ||
       !verb.compare("remove-alias")) {
 
@@ -1325,6 +2509,61 @@ int do_main(int argc, char** argv) {
     }
   }
 
+  if (!verb.compare("select") && currentArg < argc) {
+
+    std::string out(argv[currentArg]);
+    if (!out.compare("-j")) {
+
+      if (++currentArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
+      std::string arg(argv[currentArg++]);
+      if (Extract(arg, nThreads) || nThreads == 0) {
+        PrintUsage();
+        exit(1);
+      }
+    }
+  }
+
+  if (!verb.compare("encode") && currentArg < argc) {
+
+    std::string out(argv[currentArg]);
+    if (!out.compare("-e")) {
+
+      if (++currentArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
+      std::string arg(argv[currentArg++]);
+      if (!arg.compare("delta")) {
+        encoding = XCDF_ENCODING_DELTA;
+      } else if (!arg.compare("mini-block")) {
+        encoding = XCDF_ENCODING_MINI_BLOCK;
+      } else if (!arg.compare("dictionary")) {
+        encoding = XCDF_ENCODING_DICTIONARY;
+      } else if (!arg.compare("run-length")) {
+        encoding = XCDF_ENCODING_RUN_LENGTH;
+      } else if (!arg.compare("xor")) {
+        encoding = XCDF_ENCODING_XOR;
+      } else {
+        PrintUsage();
+        exit(1);
+      }
+    }
+  }
+
+  if (!verb.compare("encode") && currentArg < argc) {
+
+    std::string out(argv[currentArg]);
+    if (!out.compare("-s")) {
+      shuffle = true;
+      currentArg++;
+    }
+  }
+
   if (!verb.compare("add-alias")) {
 
     if (argc < 4) {
@@ -1422,21 +2661,25 @@ int do_main(int argc, char** argv) {
   }
 
   else if (!verb.compare("count")) {
-    Count(infiles, exp);
+    Count(infiles, exp, nThreads);
   }
 
   else if (!verb.compare("csv")) {
-    CSV(infiles);
+    CSV(infiles, exp, delimeter, nThreads);
   }
 
   else if (!verb.compare("check")) {
-    Check(infiles);
+    Check(infiles, inflate, nThreads);
   }
 
   else if (!verb.compare("remove-comments")) {
     RemoveComments(infiles, *outstream);
   }
 
+  else if (!verb.compare("merge")) {
+    Merge(infiles, *outstream);
+  }
+
   else if (!verb.compare("add-comment")) {
     AddComment(infiles, *outstream, exp);
   }
@@ -1450,7 +2693,11 @@ int do_main(int argc, char** argv) {
   }
 
   else if (!verb.compare("select")) {
-    Select(infiles, *outstream, exp, concatArgs);
+    Select(infiles, *outstream, exp, concatArgs, nThreads);
+  }
+
+  else if (!verb.compare("encode")) {
+    Encode(infiles, *outstream, exp, encoding, shuffle, concatArgs);
   }
 
   else if (!verb.compare("paste")) {
@@ -1465,12 +2712,13 @@ int do_main(int argc, char** argv) {
     PrintVersion();
   }
 
-  else if (!verb.compare("histogram")) {
-    CreateHistogram(infiles, exp);
+  else if (!verb.compare("histogram") ||
+           !verb.compare("histogram2d")) {
+    CreateHistograms(infiles, histExps, nThreads, storage);
   }
 
-  else if (!verb.compare("histogram2d")) {
-    CreateHistogram2D(infiles, exp);
+  else if (!verb.compare("stats")) {
+    Stats(infiles, exp, nThreads);
   }
 
   else if (!verb.compare("compare")) {